@@ -50,6 +50,9 @@ using namespace std;
 
 typedef basic_string<GGen_Char> GGen_String;
 
+/* Maximum number of threads accepted by SetThreadCount */
+#define GGEN_MAX_THREAD_COUNT 1024
+
 enum GGen_Message_Level{
 	GGEN_MESSAGE = 0,
 	GGEN_NOTICE = 1,
@@ -99,7 +102,7 @@ public:
 
 	vector<GGen_ScriptArg> args;
 
-	unsigned short output_width, output_height;
+	unsigned int output_width, output_height;
 
 	unsigned max_progress, current_progress;
 
@@ -126,12 +129,21 @@ public:
 	virtual short* Generate() = 0;
     virtual void Reset();
 	
-	void SetMaxMapSize(unsigned short size);
+	void SetMaxMapSize(unsigned int size);
 	void SetMaxMapCount(unsigned short count);
+	void SetThreadCount(unsigned short count);
+	void SetDeferredEvaluation(bool enabled);
+	void SetBufferPooling(bool enabled);
+	void SetFileBackedMaps(bool enabled);
 
 	/* Constraint getters and progress methods must be static to be exported as globals to Squirrel */
-	static unsigned short GetMaxMapSize();
+	static unsigned int GetMaxMapSize();
 	static unsigned short GetMaxMapCount();
+	static unsigned short GetThreadCount();
+	static bool GetDeferredEvaluation();
+	static bool GetBufferPooling();
+	static bool GetFileBackedMaps();
+	static void GetBufferPoolStats(unsigned long long* hits, unsigned long long* misses, unsigned long long* peak_bytes, unsigned long long* mapped);
 
 	void SetSeed(unsigned seed);
 };
@@ -101,6 +101,10 @@ struct GGen_Params{
 	bool overlay_as_copy;
 	int grid_size;
 	bool split_range;
+	int thread_count;
+	bool lazy_evaluation;
+	bool no_buffer_pool;
+	bool file_backed_maps;
 	
 	vector<GGen_String> script_args;
 	
@@ -122,7 +126,11 @@ struct GGen_Params{
 		disable_secondary_maps(false),
 		overlay_as_copy(false),
 		grid_size(0),
-		split_range(false)
+		split_range(false),
+		thread_count(0),
+		lazy_evaluation(false),
+		no_buffer_pool(false),
+		file_backed_maps(false)
 	{}
 };
 
@@ -202,14 +210,17 @@ bool Save(const short* data, unsigned int width, unsigned int height, const GGen
 		GGen_Cout << GGen_Const_String("Saving map \"") << *name << GGen_Const_String("\" as \"") << path_out << GGen_Const_String("\"...\n") << flush;
 	}
 	
+	// count of tiles (might not fit into 32 bits)
+	size_t length = (size_t) width * height;
+
 	// is scaling wanted?
 	if(_params.no_rescaling == false){
-		short* new_data = new short[width * height];
+		short* new_data = new short[length];
 		
 		// calculate the extremes
 		int max = - 2 << 14;
 		int min = 2  << 14;
-		for(unsigned i = 0; i < width * height; i++){
+		for(size_t i = 0; i < length; i++){
 			if(data[i] > max) max = data[i];
 			if(data[i] < min) min = data[i];
 		}
@@ -232,14 +243,14 @@ bool Save(const short* data, unsigned int width, unsigned int height, const GGen
 		if(max - min > 0){
 			if(_params.ignore_zero) max = max - min;
 			
-			for(unsigned i = 0; i < width * height; i++){
+			for(size_t i = 0; i < length; i++){
 				if(_params.ignore_zero) new_data[i] = (short) format_min + (data[i] - min) * (short) format_max / max;
 				else if(format_min < 0 || (format_min == 0 && data[i] > 0)) new_data[i] = (short) ((double) data[i] * ratio);
 				else new_data[i] = 0;
 			}
 		
 			if(_params.split_range && format->min == 0){
-				for(unsigned int i = 0; i < width * height; i++){
+				for(size_t i = 0; i < length; i++){
 					new_data[i] = new_data[i] += (short) ((format->max + 1) / 2);
 				}
 			}
@@ -271,7 +282,7 @@ bool Save(const short* data, unsigned int width, unsigned int height, const GGen
 			if(_params.overlay_file == GGen_Const_String("") || !enable_overlay){
 				for(unsigned int i = 0; i < height; i++){
 					for(unsigned int j = 0; j < width; j++){
-						output(j,i)->Red = output(j,i)->Green = output(j,i)->Blue = (ebmpBYTE) data[j + width * i];
+						output(j,i)->Red = output(j,i)->Green = output(j,i)->Blue = (ebmpBYTE) data[j + (size_t) width * i];
 					}		
 				}
 			}
@@ -286,7 +297,7 @@ bool Save(const short* data, unsigned int width, unsigned int height, const GGen
 							continue;
 						}
 					
-						int xInOverlay = data[j + width * i];
+						int xInOverlay = data[j + (size_t) width * i];
 					
 					if(overlay.TellWidth() == 511) xInOverlay += 255;
 				
@@ -312,7 +323,7 @@ bool Save(const short* data, unsigned int width, unsigned int height, const GGen
 			out.write((char*) &iWidth, sizeof(iWidth));
 			out.write((char*) &iHeight, sizeof(iHeight));
 			
-			out.write((char*) data, 2 * width * height);
+			out.write((char*) data, 2 * length);
 		}
 		
 		out.close();
@@ -328,7 +339,7 @@ bool Save(const short* data, unsigned int width, unsigned int height, const GGen
 			
 			for(unsigned y = 0; y < height; y++){
 				for(unsigned x = 0; x < width; x++){
-					out << data[x + width * y];
+					out << data[x + (size_t) width * y];
 					
 					if(x < width - 1) out << " ";
 				}
@@ -376,6 +387,7 @@ int main(int argc,char * argv[]){
 	args.AddStringArg(GGen_Const_String('d'), GGen_Const_String("output-directory"), GGen_Const_String("Directory where secondary maps will be saved. Set to \"../temp/\" by default."), GGen_Const_String("DIRECTORY"), &_params.output_directory);
 	args.AddStringArg(GGen_Const_String('v'), GGen_Const_String("overlay"), GGen_Const_String("Overlay file to be mapped on the output. This file must be a Windows Bitmap file one pixel high and either 256 or 511 pixels wide."), GGen_Const_String("FILE"), &_params.overlay_file);
 	
+	args.AddIntArg(GGen_Const_String('t'), GGen_Const_String("threads"), GGen_Const_String("Number of threads used to generate the map. 1 disables parallel execution, 0 (default) uses one thread per processor core."), GGen_Const_String("COUNT"), &_params.thread_count);
 	args.AddIntArg(GGen_Const_String('s'), GGen_Const_String("seed"), GGen_Const_String("Pseudo-random generator seed. Maps generated with same seed, map script, arguments and generator version are always the same."), GGen_Const_String("SEED"), &_params.random_seed);
 	
 	args.AddBoolArg(GGen_Const_String('a'), GGen_Const_String("all-random"), GGen_Const_String("All unset script arguments are generated randomly."), &_params.all_random);
@@ -389,6 +401,9 @@ int main(int argc,char * argv[]){
 	args.AddBoolArg(GGen_Const_String('D'), GGen_Const_String("disable-secondary-maps"), GGen_Const_String("All secondary maps will be immediately discarded, ReturnAs calls will be effectively skipped."), &_params.disable_secondary_maps);
 	args.AddBoolArg(GGen_Const_String('V'), GGen_Const_String("overlay-as-copy"), GGen_Const_String("Color files with overlays will be saved as copies."), &_params.overlay_as_copy);
 	args.AddIntArg( GGen_Const_String('g'), GGen_Const_String("grid"), GGen_Const_String("Renders a grid onto the overlay file."), GGen_Const_String("SIZE"), &_params.grid_size);
+	args.AddBoolArg(GGen_Const_String('l'), GGen_Const_String("lazy-evaluation"), GGen_Const_String("Simple per-tile operations (Add, Multiply, Clamp...) are collected and evaluated together in one pass over the map once their result is needed. The results are the same."), &_params.lazy_evaluation);
+	args.AddBoolArg(GGen_Const_String('B'), GGen_Const_String("no-buffer-pool"), GGen_Const_String("Map arrays released during the generation will be freed right away instead of being reused by later map operations."), &_params.no_buffer_pool);
+	args.AddBoolArg(GGen_Const_String('F'), GGen_Const_String("file-backed-maps"), GGen_Const_String("Large map arrays will be placed into temporary files (in TMPDIR or TMP), so maps which do not fit into the memory can be paged out to disk."), &_params.file_backed_maps);
 	args.AddBoolArg(GGen_Const_String('h'), GGen_Const_String("split-range"), GGen_Const_String("Splits the value range of a file format, which doesn't support negative values, so lower half of the range covers negaive values and upper half covers positive values. Value \"(max + 1) / 2\" will be treated as zero."), &_params.split_range);
 	
 	
@@ -496,6 +511,23 @@ int main(int argc,char * argv[]){
 	ggen->SetReturnCallback(ReturnHandler);
 	ggen->SetProgressCallback(ProgressHandler);
 
+	if(_params.thread_count < 0){
+		cout << "Thread count must not be negative!\n" << flush;
+		delete ggen;
+		return -1;
+	}
+
+	if(_params.thread_count > GGEN_MAX_THREAD_COUNT){
+		cout << "Thread count must not be greater than " << GGEN_MAX_THREAD_COUNT << "!\n" << flush;
+		delete ggen;
+		return -1;
+	}
+
+	ggen->SetThreadCount(_params.thread_count);
+	ggen->SetDeferredEvaluation(_params.lazy_evaluation);
+	ggen->SetBufferPooling(!_params.no_buffer_pool);
+	ggen->SetFileBackedMaps(_params.file_backed_maps);
+
 	// pump the script into the engine and compile it
 	if(!ggen->SetScript(GGen_String(preparedScript))){
 		cout << "Compilation failed!\n" << flush;
@@ -528,8 +560,9 @@ int main(int argc,char * argv[]){
 		_params.random_seed = (int) time(0);
 	}
 
-	// let the std c++ generator use our seed
+	// let both the std c++ generator and the map generator use our seed
 	srand(_params.random_seed);
+	ggen->SetSeed(_params.random_seed);
 
 	// param list mode
 	if(_params.param_list_mode){
@@ -636,6 +669,13 @@ int main(int argc,char * argv[]){
 	
 	assert(data != NULL);
 
+	unsigned long long pool_hits, pool_misses, pool_peak_bytes, pool_mapped;
+	ggen->GetBufferPoolStats(&pool_hits, &pool_misses, &pool_peak_bytes, &pool_mapped);
+
+	cout << "Map arrays: " << pool_hits << " reused, " << pool_misses << " allocated";
+	if(_params.file_backed_maps) cout << " (" << pool_mapped << " in temporary files)";
+	cout << ", peak " << (pool_peak_bytes + 1048575) / 1048576 << " MB\n" << flush;
+
 	GGen_String compatible_file_name(_params.output_file.length(), GGen_Const_String(' '));
 	copy(_params.output_file.begin(), _params.output_file.end(), compatible_file_name.begin());
 
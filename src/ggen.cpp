@@ -24,6 +24,9 @@
 #include "ggen_amplitudes.h"
 #include "ggen_data_1d.h"
 #include "ggen_data_2d.h"
+#include "ggen_threadpool.h"
+#include "ggen_bufferpool.h"
+#include "ggen_random.h"
 
 #include "ggen.h"
 
@@ -36,8 +39,9 @@ GGen::GGen(){
 
 	this->status = GGEN_NO_SCRIPT;
 
-	/* Default map constraints to max values (given int is unsigned, -1 overflows to its max value) */	
-	this->max_map_size = -1;
+	/* Default map constraints to max values (given int is unsigned, -1 overflows to its max value). The map size
+	is limited to the largest value scripts can hold in their signed 32 bit integers. */	
+	this->max_map_size = 0x7FFFFFFF;
 	this->max_map_count = -1;
 
 	this->message_callback = NULL;
@@ -48,6 +52,9 @@ GGen::GGen(){
 }
 
 GGen::~GGen(){
+	GGen_ThreadPool::Shutdown();
+	GGen_BufferPool::Clear();
+
 	GGen::instance = NULL;
 }
 
@@ -127,10 +134,62 @@ uint16 GGen::GetMaxMapCount(){
 	return GGen::GetInstance()->max_map_count;
 }
 
+void GGen::SetThreadCount(uint16 count){
+	GGen_Script_Assert(GGen::GetInstance()->GetStatus() != GGEN_GENERATING);
+	GGen_Script_Assert(count <= GGEN_MAX_THREAD_COUNT);
+
+	GGen_ThreadPool::SetThreadCount(count);
+}
+
+uint16 GGen::GetThreadCount(){
+	return GGen_ThreadPool::GetThreadCount();
+}
+
+void GGen::SetDeferredEvaluation(bool enabled){
+	GGen_Script_Assert(GGen::GetInstance()->GetStatus() != GGEN_GENERATING);
+
+	GGen_Data_2D::SetDeferredEvaluation(enabled);
+}
+
+bool GGen::GetDeferredEvaluation(){
+	return GGen_Data_2D::GetDeferredEvaluation();
+}
+
+void GGen::SetBufferPooling(bool enabled){
+	GGen_Script_Assert(GGen::GetInstance()->GetStatus() != GGEN_GENERATING);
+
+	GGen_BufferPool::SetEnabled(enabled);
+}
+
+bool GGen::GetBufferPooling(){
+	return GGen_BufferPool::GetEnabled();
+}
+
+void GGen::SetFileBackedMaps(bool enabled){
+	GGen_Script_Assert(GGen::GetInstance()->GetStatus() != GGEN_GENERATING);
+
+	GGen_BufferPool::SetFileBacked(enabled);
+}
+
+bool GGen::GetFileBackedMaps(){
+	return GGen_BufferPool::GetFileBacked();
+}
+
+void GGen::GetBufferPoolStats(uint64* hits, uint64* misses, uint64* peak_bytes, uint64* mapped){
+	GGen_BufferPool_Stats stats = GGen_BufferPool::GetStats();
+
+	*hits = stats.hits;
+	*misses = stats.misses;
+	*peak_bytes = stats.peak_bytes;
+	*mapped = stats.mapped;
+}
+
 void GGen::SetSeed(unsigned seed){
 	GGen_Script_Assert(GGen::GetInstance()->GetStatus() != GGEN_GENERATING);
 	GGen_Script_Assert(GGen::GetInstance()->GetStatus() != GGEN_LOADING_MAP_INFO);
 
+	/* The map operations use own generator, the std c++ one is still used by the scripts */
+	GGen_RandomStream::SetSeed(seed);
 	srand(seed);
 }
 
@@ -25,7 +25,7 @@
 /**
  * @mainpage GeoGen - API Reference
  * <p>This reference contains listings of all GeoGen objects, functions and constants available from within of map scripts.</p>
- * <p>In addition to these functions, you can use several native Squirrel functions and whole <a href="http://squirrel-lang.org/doc/sqstdlib2.html#d0e1519" target="blank">sqstdmath library</a></p>.
+ * <p>In addition to these functions, you can use several native Squirrel functions and whole <a href="http://squirrel-lang.org/doc/sqstdlib2.html#d0e1519" target="blank">sqstdmath library</a> and the blob class of the sqstdblob library (GGen_Data_2D bulk transfer methods accept blobs of 16 bit heights and 32 bit coordinates)</p>.
  * <hr>
  * <h2>Contents</h2>
  * <ul>
@@ -64,7 +64,7 @@ public:
 
 	vector<GGen_ScriptArg> args;
 
-	uint16 output_width, output_height;
+	GGen_Size output_width, output_height;
 
 	uint32 max_progress, current_progress;
 
@@ -96,6 +96,25 @@ public:
 	void SetMaxMapSize(GGen_Size size);
 	void SetMaxMapCount(uint16 count);
 
+	/* Number of threads used by the map operations (1 = serial execution, 0 = one thread per hardware core) */
+	void SetThreadCount(uint16 count);
+	static uint16 GetThreadCount();
+
+	/* Simple per-tile map operations are collected and evaluated together once their result is needed */
+	void SetDeferredEvaluation(bool enabled);
+	static bool GetDeferredEvaluation();
+
+	/* Map arrays released during the generation are kept and reused by later map operations */
+	void SetBufferPooling(bool enabled);
+	static bool GetBufferPooling();
+
+	/* Large map arrays are placed into temporary files, so maps which do not fit into the memory can be paged out to disk */
+	void SetFileBackedMaps(bool enabled);
+	static bool GetFileBackedMaps();
+
+	/* Buffer pool counters of the last generation (reused arrays, newly allocated arrays, most bytes in map arrays at once and arrays placed into files) */
+	static void GetBufferPoolStats(uint64* hits, uint64* misses, uint64* peak_bytes, uint64* mapped);
+
 	/* Constraint getters and progress methods must be static to be exported as globals to Squirrel */
 	static GGen_Size GetMaxMapSize();
 	static uint16 GetMaxMapCount();
@@ -42,7 +42,7 @@ GGen_Amplitudes::GGen_Amplitudes(GGen_Size max_feature_size)
 
 void GGen_Amplitudes::AddAmplitude(uint16 feature_size, uint16 amplitude)
 {
-	GGen_Script_Assert(GGen_log2(feature_size) < this->length);
+	GGen_Script_Assert((GGen_Size) GGen_log2(feature_size) < this->length);
 
 	this->data[GGen_log2(feature_size)] = amplitude;
 }
\ No newline at end of file
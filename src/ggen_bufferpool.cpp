@@ -0,0 +1,322 @@
+/*
+
+    This file is part of GeoGen.
+
+    GeoGen is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    GeoGen is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GeoGen.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <map>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <assert.h>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <stdlib.h>
+	#include <string.h>
+	#include <unistd.h>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+#endif
+
+#include "ggen_support.h"
+#include "ggen_bufferpool.h"
+
+/* An array in use */
+struct GGen_BufferPool_Used{
+	/* Rounded length */
+	uint64 bucket;
+
+	/* Mapped from a temporary file */
+	bool mapped;
+
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+};
+
+/* Released arrays by their (rounded) length */
+static map<uint64, vector<GGen_Height*> > GGen_BufferPool_idle;
+
+/* Arrays in use */
+static unordered_map<GGen_Height*, GGen_BufferPool_Used> GGen_BufferPool_used;
+
+static uint64 GGen_BufferPool_idle_bytes = 0;
+static bool GGen_BufferPool_enabled = true;
+static bool GGen_BufferPool_file_backed = false;
+static GGen_BufferPool_Stats GGen_BufferPool_stats = {0, 0, 0, 0, 0};
+static mutex GGen_BufferPool_mutex;
+
+/* Rounds the length up to one of eight steps between two powers of two (wasting at most 1/8 of the array). */
+static uint64 GGen_BufferPool_Bucket(uint64 length){
+	uint64 step = 1;
+
+	while (step * 16 <= length) step *= 2;
+
+	return (length + step - 1) / step * step;
+}
+
+/* Maps a deleted temporary file of the given size, returns NULL if the file could not be created or mapped. */
+static GGen_Height* GGen_BufferPool_Map(uint64 bytes, GGen_BufferPool_Used* used){
+#ifdef _WIN32
+	char directory[MAX_PATH + 1];
+	char path[MAX_PATH + 1];
+
+	if (GetTempPathA(sizeof(directory), directory) == 0 || GetTempFileNameA(directory, "ggn", 0, path) == 0) return NULL;
+
+	/* The file is deleted as soon as the last handle to it is closed */
+	used->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+
+	if (used->file == INVALID_HANDLE_VALUE) {
+		DeleteFileA(path);
+		return NULL;
+	}
+
+	used->mapping = CreateFileMappingA(used->file, NULL, PAGE_READWRITE, (DWORD) (bytes >> 32), (DWORD) bytes, NULL);
+
+	if (used->mapping == NULL) {
+		CloseHandle(used->file);
+		return NULL;
+	}
+
+	void* buffer = MapViewOfFile(used->mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T) bytes);
+
+	if (buffer == NULL) {
+		CloseHandle(used->mapping);
+		CloseHandle(used->file);
+		return NULL;
+	}
+
+	return (GGen_Height*) buffer;
+#else
+	/* The file is closed right after mapping, there are no handles to keep */
+	(void) used;
+
+	const char* directory = getenv("TMPDIR");
+
+	if (directory == NULL || directory[0] == '\0') directory = "/tmp";
+
+	vector<char> path(directory, directory + strlen(directory));
+	const char* name = "/geogen-XXXXXX";
+	path.insert(path.end(), name, name + strlen(name) + 1);
+
+	int file = mkstemp(&path[0]);
+
+	if (file < 0) return NULL;
+
+	/* The file disappears with the mapping, even if the process crashes */
+	unlink(&path[0]);
+
+	bool sized = ftruncate(file, (off_t) bytes) == 0;
+
+#ifdef __linux__
+	/* Reserve the disk space now, running out of it while writing into the mapping would kill the process */
+	sized = sized && posix_fallocate(file, 0, (off_t) bytes) == 0;
+#endif
+
+	void* buffer = sized ? mmap(NULL, (size_t) bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0) : MAP_FAILED;
+
+	close(file);
+
+	if (buffer == MAP_FAILED) return NULL;
+
+	return (GGen_Height*) buffer;
+#endif
+}
+
+/* Unmaps an array mapped by GGen_BufferPool_Map, which deletes its file. */
+static void GGen_BufferPool_Unmap(GGen_Height* buffer, uint64 bytes, GGen_BufferPool_Used* used){
+#ifdef _WIN32
+	(void) bytes;
+
+	UnmapViewOfFile(buffer);
+	CloseHandle(used->mapping);
+	CloseHandle(used->file);
+#else
+	(void) used;
+
+	munmap(buffer, (size_t) bytes);
+#endif
+}
+
+GGen_Height* GGen_BufferPool::Allocate(GGen_TotalSize length){
+	uint64 bucket = GGen_BufferPool_Bucket(MAX(length, 1));
+
+	GGen_BufferPool_Used used;
+	used.bucket = bucket;
+	used.mapped = false;
+
+	GGen_Height* buffer = NULL;
+	bool file_backed;
+
+	{
+		lock_guard<mutex> lock(GGen_BufferPool_mutex);
+
+		file_backed = GGen_BufferPool_file_backed;
+	}
+
+	if (file_backed && bucket * sizeof(GGen_Height) >= GGEN_BUFFER_POOL_MIN_MAPPED_BYTES) {
+		/* Creating and reserving the file can take long, so it is done without holding the lock. Fall back to the
+		memory if the file cannot be created. */
+		buffer = GGen_BufferPool_Map(bucket * sizeof(GGen_Height), &used);
+		used.mapped = buffer != NULL;
+	}
+
+	lock_guard<mutex> lock(GGen_BufferPool_mutex);
+
+	map<uint64, vector<GGen_Height*> >::iterator idle = GGen_BufferPool_idle.find(bucket);
+
+	if (buffer != NULL) {
+		GGen_BufferPool_stats.mapped++;
+		GGen_BufferPool_stats.misses++;
+		GGen_BufferPool_stats.bytes += bucket * sizeof(GGen_Height);
+		GGen_BufferPool_stats.peak_bytes = MAX(GGen_BufferPool_stats.peak_bytes, GGen_BufferPool_stats.bytes);
+	}
+	else if (idle != GGen_BufferPool_idle.end() && !idle->second.empty()) {
+		buffer = idle->second.back();
+		idle->second.pop_back();
+
+		GGen_BufferPool_idle_bytes -= bucket * sizeof(GGen_Height);
+		GGen_BufferPool_stats.hits++;
+	}
+	else {
+		buffer = new GGen_Height[(size_t) bucket];
+
+		if (buffer == NULL) return NULL;
+
+		GGen_BufferPool_stats.misses++;
+		GGen_BufferPool_stats.bytes += bucket * sizeof(GGen_Height);
+		GGen_BufferPool_stats.peak_bytes = MAX(GGen_BufferPool_stats.peak_bytes, GGen_BufferPool_stats.bytes);
+	}
+
+	GGen_BufferPool_used[buffer] = used;
+
+	return buffer;
+}
+
+void GGen_BufferPool::Release(GGen_Height* buffer){
+	if (buffer == NULL) return;
+
+	unique_lock<mutex> lock(GGen_BufferPool_mutex);
+
+	unordered_map<GGen_Height*, GGen_BufferPool_Used>::iterator used = GGen_BufferPool_used.find(buffer);
+
+	assert(used != GGen_BufferPool_used.end());
+
+	GGen_BufferPool_Used entry = used->second;
+	uint64 bucket = entry.bucket;
+	GGen_BufferPool_used.erase(used);
+
+	if (entry.mapped) {
+		GGen_BufferPool_stats.bytes -= bucket * sizeof(GGen_Height);
+
+		/* Unmapping might write the pages back, don't block other threads meanwhile */
+		lock.unlock();
+
+		GGen_BufferPool_Unmap(buffer, bucket * sizeof(GGen_Height), &entry);
+	}
+	else if (GGen_BufferPool_enabled && GGen_BufferPool_idle_bytes + bucket * sizeof(GGen_Height) <= GGEN_BUFFER_POOL_MAX_IDLE_BYTES) {
+		GGen_BufferPool_idle[bucket].push_back(buffer);
+		GGen_BufferPool_idle_bytes += bucket * sizeof(GGen_Height);
+	}
+	else {
+		delete [] buffer;
+
+		GGen_BufferPool_stats.bytes -= bucket * sizeof(GGen_Height);
+	}
+}
+
+void GGen_BufferPool::Clear(){
+	lock_guard<mutex> lock(GGen_BufferPool_mutex);
+
+	for (map<uint64, vector<GGen_Height*> >::iterator i = GGen_BufferPool_idle.begin(); i != GGen_BufferPool_idle.end(); i++) {
+		for (size_t j = 0; j < i->second.size(); j++) {
+			delete [] i->second[j];
+		}
+	}
+
+	GGen_BufferPool_idle.clear();
+
+	GGen_BufferPool_stats.bytes -= GGen_BufferPool_idle_bytes;
+	GGen_BufferPool_idle_bytes = 0;
+}
+
+void GGen_BufferPool::SetEnabled(bool enabled){
+	if (!enabled) {
+		GGen_BufferPool::Clear();
+	}
+
+	lock_guard<mutex> lock(GGen_BufferPool_mutex);
+
+	GGen_BufferPool_enabled = enabled;
+}
+
+bool GGen_BufferPool::GetEnabled(){
+	return GGen_BufferPool_enabled;
+}
+
+void GGen_BufferPool::SetFileBacked(bool enabled){
+	/* Released memory arrays would be reused instead of the files */
+	GGen_BufferPool::Clear();
+
+	lock_guard<mutex> lock(GGen_BufferPool_mutex);
+
+	GGen_BufferPool_file_backed = enabled;
+}
+
+bool GGen_BufferPool::GetFileBacked(){
+	return GGen_BufferPool_file_backed;
+}
+
+void GGen_BufferPool::SetSequentialAccess(GGen_Height* buffer, bool sequential){
+	/* Views of file mappings on Windows have no such hint */
+#ifndef _WIN32
+	if (buffer == NULL) return;
+
+	uint64 bucket;
+
+	{
+		lock_guard<mutex> lock(GGen_BufferPool_mutex);
+
+		unordered_map<GGen_Height*, GGen_BufferPool_Used>::iterator used = GGen_BufferPool_used.find(buffer);
+
+		if (used == GGen_BufferPool_used.end() || !used->second.mapped) return;
+
+		bucket = used->second.bucket;
+	}
+
+	madvise(buffer, (size_t) (bucket * sizeof(GGen_Height)), sequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+#endif
+}
+
+GGen_BufferPool_Stats GGen_BufferPool::GetStats(){
+	lock_guard<mutex> lock(GGen_BufferPool_mutex);
+
+	return GGen_BufferPool_stats;
+}
+
+void GGen_BufferPool::ResetStats(){
+	lock_guard<mutex> lock(GGen_BufferPool_mutex);
+
+	GGen_BufferPool_stats.hits = 0;
+	GGen_BufferPool_stats.misses = 0;
+	GGen_BufferPool_stats.mapped = 0;
+	GGen_BufferPool_stats.peak_bytes = GGen_BufferPool_stats.bytes;
+}
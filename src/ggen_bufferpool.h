@@ -0,0 +1,128 @@
+/*
+
+    This file is part of GeoGen.
+
+    GeoGen is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    GeoGen is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GeoGen.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/**
+ * @file ggen_bufferpool.h GGen_BufferPool keeps released map arrays so later map operations can reuse them.
+ **/
+
+#pragma once
+
+#include "ggen_support.h"
+
+/**
+ * Most bytes the pool keeps in released arrays, further released arrays are deleted right away.
+ **/
+#define GGEN_BUFFER_POOL_MAX_IDLE_BYTES (512 * 1024 * 1024ULL)
+
+/**
+ * Smallest array (in bytes) placed into a temporary file when file backed arrays are enabled, smaller arrays stay in memory.
+ **/
+#define GGEN_BUFFER_POOL_MIN_MAPPED_BYTES (1024 * 1024ULL)
+
+/**
+ * @internal Counters of the buffer pool.
+ **/
+struct GGen_BufferPool_Stats{
+	/* Allocations served by a released array */
+	uint64 hits;
+
+	/* Allocations which had to allocate a new array */
+	uint64 misses;
+
+	/* Bytes in arrays currently held by the pool (both used and released ones) */
+	uint64 bytes;
+
+	/* Most bytes held by the pool at once */
+	uint64 peak_bytes;
+
+	/* Allocations placed into temporary files */
+	uint64 mapped;
+};
+
+/**
+ * @internal Process-wide pool of height arrays. Arrays are grouped into buckets by size (the requested length is rounded
+ * up to one of eight steps between two powers of two), so an array released by one map operation can be reused by the
+ * next one allocating a similar length. The released arrays are kept until the end of the generation (up to
+ * GGEN_BUFFER_POOL_MAX_IDLE_BYTES), when GGen_Squirrel::Generate releases them all.
+ *
+ * With file backed arrays enabled, large arrays are mapped from deleted temporary files in the system temporary directory
+ * (TMPDIR, or TMP on Windows) instead, so the operating system can page maps which do not fit into the memory out to disk.
+ * Such arrays are not kept for reuse, their pages are dropped together with the file when released.
+ **/
+class GGen_BufferPool{
+	public:
+		/**
+		 * Returns an array of at least the given length. The content of the array is undefined.
+		 * @param length Number of items.
+		 * @return The array (must be returned through Release).
+		 **/
+		static GGen_Height* Allocate(GGen_TotalSize length);
+
+		/**
+		 * Returns an array obtained from Allocate to the pool.
+		 * @param buffer The array (or NULL).
+		 **/
+		static void Release(GGen_Height* buffer);
+
+		/**
+		 * Deletes all released arrays kept by the pool.
+		 **/
+		static void Clear();
+
+		/**
+		 * Enables or disables reusing of the released arrays (arrays are deleted right away when disabled).
+		 * @param enabled True to enable the pool.
+		 **/
+		static void SetEnabled(bool enabled);
+
+		/**
+		 * Returns true if the released arrays are reused.
+		 **/
+		static bool GetEnabled();
+
+		/**
+		 * Enables or disables placing large arrays into temporary files.
+		 * @param enabled True to place arrays of at least GGEN_BUFFER_POOL_MIN_MAPPED_BYTES into temporary files.
+		 **/
+		static void SetFileBacked(bool enabled);
+
+		/**
+		 * Returns true if large arrays are placed into temporary files.
+		 **/
+		static bool GetFileBacked();
+
+		/**
+		 * Tells the system whether an array is about to be accessed from start to end. Arrays in temporary files are
+		 * mapped for random access by default (most kernels walk columns or jump around), sequential access makes the
+		 * system read ahead and drop the pages behind. Arrays in memory are not affected.
+		 * @param buffer The array (obtained from Allocate).
+		 * @param sequential True before a sequential pass, false after it.
+		 **/
+		static void SetSequentialAccess(GGen_Height* buffer, bool sequential);
+
+		/**
+		 * Returns the pool counters.
+		 **/
+		static GGen_BufferPool_Stats GetStats();
+
+		/**
+		 * Resets the hit, miss and mapping counters. The peak is reset to the current size of the pool.
+		 **/
+		static void ResetStats();
+};
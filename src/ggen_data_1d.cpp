@@ -20,9 +20,11 @@
 #include <cstring>
 
 #include "ggen_support.h"
+#include "ggen_random.h"
 #include "ggen_amplitudes.h"
 #include "ggen_data_1d.h"
 #include "ggen.h"
+#include "ggen_threadpool.h"
 
 GGen_Data_1D::GGen_Data_1D(GGen_Size length, GGen_Height value)
 {
@@ -47,6 +49,30 @@ GGen_Data_1D::~GGen_Data_1D()
 	delete [] this->data;
 }
 
+GGen_CompiledProfile::GGen_CompiledProfile(GGen_Data_1D* profile, GGen_Size scale_to_length)
+{
+	GGen_Script_Assert(profile != NULL);
+	GGen_Script_Assert(scale_to_length >= GGEN_MIN_MAP_SIZE);
+
+	this->length = scale_to_length;
+
+	/* Allocate the array */
+	this->values = new GGen_Height[this->length];
+
+	GGen_Script_Assert(this->values != NULL);
+
+	GGen_ParallelFor(0, this->length, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			this->values[i] = profile->GetValueInterpolated((GGen_Coord) i, this->length);
+		}
+	});
+}
+
+GGen_CompiledProfile::~GGen_CompiledProfile()
+{
+	delete [] this->values;
+}
+
 GGen_Data_1D* GGen_Data_1D::Clone()
 {
 	GGen_Data_1D* victim = new GGen_Data_1D(this->length, 0);
@@ -157,7 +183,7 @@ void GGen_Data_1D::AddArray(GGen_Data_1D* addend)
 void GGen_Data_1D::AddTo(GGen_Data_1D* addend, GGen_CoordOffset offset)
 {
 	GGen_Script_Assert(addend != NULL);
-	GGen_Script_Assert(offset > -this->length);
+	GGen_Script_Assert(offset > -(GGen_CoordOffset) this->length);
 	GGen_Script_Assert(offset < this->length);
 
 	/* Walk through the items where the array and the addend with offset intersect */
@@ -274,7 +300,7 @@ void GGen_Data_1D::ResizeCanvas(GGen_Size new_length, GGen_CoordOffset new_zero)
 	GGen_Script_Assert(new_length <= GGen::GetMaxMapSize());
 	GGen_Script_Assert(new_length >= GGEN_MIN_MAP_SIZE);
 	GGen_Script_Assert(new_zero <= GGen::GetMaxMapSize());
-	GGen_Script_Assert(new_zero >= -GGen::GetMaxMapSize());
+	GGen_Script_Assert(new_zero >= -(GGen_CoordOffset) GGen::GetMaxMapSize());
 
 	/* Allocate the new array */
 	GGen_Height* new_data = new GGen_Height[new_length];
@@ -342,9 +368,9 @@ GGen_Height GGen_Data_1D::Max()
 void GGen_Data_1D::Shift(GGen_CoordOffset distance, GGen_Overflow_Mode mode)
 {
 	GGen_Script_Assert(distance < this->length);
-	GGen_Script_Assert(distance > -this->length);
+	GGen_Script_Assert(distance > -(GGen_CoordOffset) this->length);
 
-	GGen_Script_Assert(distance < this->length && distance != 0 && distance > -this->length);
+	GGen_Script_Assert(distance < this->length && distance != 0 && distance > -(GGen_CoordOffset) this->length);
 	
 	/* Cycle mode */
 	if (mode == GGEN_CYCLE) {
@@ -356,7 +382,7 @@ void GGen_Data_1D::Shift(GGen_CoordOffset distance, GGen_Overflow_Mode mode)
 		/* Fill the new array with shifted data */
 		for (GGen_Coord i = 0; i < this->length; i++) {
 			/* Some values can be just plainly shifted */
-			if ((distance > 0 && i < this->length - distance) || (distance < 0 && (signed) i >= -distance)) {
+			if ((distance > 0 && i < this->length - distance) || (distance < 0 && (GGen_CoordOffset) i >= -distance)) {
 				new_data[i + distance] = this->data[i];
 			}
 			/* Some must go through the right "border" */
@@ -535,15 +561,15 @@ void GGen_Data_1D::Gradient(GGen_Coord from, GGen_Coord to, GGen_Height from_val
 	
 	for (GGen_Coord i = 0; i < this->length; i++) {
 		/* Calculate current distance from "from" and "to" */
-		GGen_Distance distance_from = (GGen_Distance) ABS(i - from);
-		GGen_Distance distance_to = (GGen_Distance) ABS(i - to);
+		GGen_Distance distance_from = (GGen_Distance) ABS((GGen_CoordOffset) i - from);
+		GGen_Distance distance_to = (GGen_Distance) ABS((GGen_CoordOffset) i - to);
 
 		if (distance_from > max_distance) {
 			this->data[i] = fill_flat ? to_value: this->data[i];
 		} else if (distance_to > max_distance) {
 			this->data[i] = fill_flat ? from_value : this->data[i];
 		} else {
-			this->data[i] = base + (GGen_Height) (offset * (signed) distance_to / (signed) max_distance);
+			this->data[i] = base + (GGen_Height) (offset * (GGen_ExtExtHeight) distance_to / (GGen_ExtExtHeight) max_distance);
 		}
 	}
 }
@@ -565,6 +591,8 @@ void GGen_Data_1D::Noise(GGen_Size min_feature_size, GGen_Size max_feature_size,
 
 	this->Fill(0);
 
+	GGen_RandomStream random = GGen_RandomStream::ForOperation();
+
 	for (GGen_Size wave_length = max_feature_size; wave_length >= 1; wave_length /= 2) {
 		frequency = GGen_log2(wave_length);
 		amplitude = amplitudes->data[frequency];
@@ -572,7 +600,7 @@ void GGen_Data_1D::Noise(GGen_Size min_feature_size, GGen_Size max_feature_size,
 		if (wave_length < min_feature_size) break;
 
 		for (GGen_Coord i = 0; i < this->length; i += wave_length) {
-			new_data[i] = GGen_Random<GGen_Height>(-amplitude, amplitude);
+			new_data[i] = random.At<GGen_Height>(-amplitude, amplitude, i, wave_length);
 		}
 
 		if (wave_length > 1) {
@@ -611,10 +639,10 @@ void GGen_Data_1D::Smooth(GGen_Distance radius)
 	GGen_Script_Assert(new_data != NULL);
 
 	/* Calculate size of the filter window */
-	GGen_Size window_size = radius * 2 + 1;
+	GGen_ExtHeight window_size = (GGen_ExtHeight) radius * 2 + 1;
 
 	/* Prefill the window with value of the left edge + n leftmost values (where n is radius) */
-	GGen_ExtHeight window_value = this->data[0] * radius;
+	GGen_ExtHeight window_value = this->data[0] * (GGen_ExtHeight) radius;
 
 	for (GGen_Distance i = 0; i < radius; i++) {
 		window_value += this->data[i];
@@ -651,21 +679,37 @@ void GGen_Data_1D::Flood(double water_amount)
 	/* Calculate how many tiles should be flooded in total */
 	GGen_Index target = (GGen_Index) (water_amount * (double) this->length);
 	
+	/* Count the tiles of each value in one pass */
+	GGen_Index* counts = new GGen_Index[GGEN_HISTOGRAM_SIZE];
+
+	GGen_Script_Assert(counts != NULL);
+
+	memset(counts, 0, GGEN_HISTOGRAM_SIZE * sizeof(GGen_Index));
+
+	for (GGen_Coord i = 0; i < this->length; i++) {
+		counts[this->data[i] - GGEN_INVALID_HEIGHT]++;
+	}
+
+	GGen_Index lowest = 0;
+	while (lowest < GGEN_HISTOGRAM_SIZE - 1 && counts[lowest] == 0) lowest++;
+
+	GGen_Index highest = GGEN_HISTOGRAM_SIZE - 1;
+	while (highest > 0 && counts[highest] == 0) highest--;
+
 	GGen_Index last_amount = 0;
 
-	GGen_Height level = this->Min();
-	GGen_Height max = this->Max();
+	/* The same limits as Min() and Max() would return */
+	GGen_Height level = (GGen_Height) MIN((GGen_ExtHeight) lowest + GGEN_INVALID_HEIGHT, GGEN_MAX_HEIGHT);
+	GGen_Height max = (GGen_Height) MAX((GGen_ExtHeight) highest + GGEN_INVALID_HEIGHT, GGEN_MIN_HEIGHT);
+
+	/* Amount of tiles higher than or equal to the current level (all tiles are above the lowest value) */
+	GGen_Index amount = 0;
+	for (GGen_ExtHeight value = level; value <= GGEN_MAX_HEIGHT; value++) {
+		amount += counts[value - GGEN_INVALID_HEIGHT];
+	}
 
 	/* Go through the array values from bottom up and try to find the best fit to target water amount */
 	while (level < max) {
-		/* Calculate the amount of waters above current level */
-		GGen_Index amount = 0;
-		for (GGen_Coord i = 0; i < this->length; i++) {
-			if (this->data[i] >= level) {
-				amount++;
-			}
-		}
-
 		/* Is current level higher than the target? */
 		if (amount <= target) {
 			/* Find if this level fits better than the previous (the closest fit applies) */
@@ -679,9 +723,14 @@ void GGen_Data_1D::Flood(double water_amount)
 
 		last_amount = amount;
 
+		/* Tiles of the current level will be under the next level */
+		amount -= counts[level - GGEN_INVALID_HEIGHT];
+
 		level++;
 	}
 
+	delete [] counts;
+
 	/* Shift the heights so given portion of the array is under zero */
 	this->Add(-level);
 }
@@ -286,4 +286,35 @@ class GGen_Data_1D{
 		 * @note Point's coordinates are calculated as [value index, value].
 		 **/
 		GGen_Path* ToPath(uint16 point_count);
+};
+
+/**
+ * @internal Profile resampled to a fixed length in advance. Reading one of its values is a single array access, so
+ * loops which would otherwise call GGen_Data_1D::GetValueInterpolated for every tile compile the profile once instead.
+ **/
+class GGen_CompiledProfile{
+	protected:
+		GGen_Height* values;
+		GGen_Size length;
+
+		/* The object owns its buffer, so it can't be copied */
+		GGen_CompiledProfile(const GGen_CompiledProfile& victim);
+		GGen_CompiledProfile& operator=(const GGen_CompiledProfile& victim);
+
+	public:
+		/**
+		 * Resamples the profile. Value at index x is equal to profile->GetValueInterpolated(x, scale_to_length).
+		 * @param profile The profile.
+		 * @param scale_to_length Number of the values.
+		 **/
+		GGen_CompiledProfile(GGen_Data_1D* profile, GGen_Size scale_to_length);
+
+		~GGen_CompiledProfile();
+
+		/**
+		 * Returns the value at given index (without bounds checking).
+		 **/
+		inline GGen_Height operator[](GGen_Coord x) const{
+			return this->values[x];
+		}
 };
\ No newline at end of file
@@ -24,18 +24,31 @@
 #include <cstring>
 #include <cmath>
 #include <stack>
+#include <algorithm>
 
 #include "ggen.h"
 #include "ggen_support.h"
 #include "ggen_amplitudes.h"
 #include "ggen_data_1d.h"
 #include "ggen_data_2d.h"
+#include "ggen_mask_2d.h"
 #include "ggen_path.h"
 #include "ggen_erosionsimulator.h"
+#include "ggen_expression.h"
+#include "ggen_threadpool.h"
+#include "ggen_bufferpool.h"
+#include "ggen_random.h"
 #include <assert.h>
 
+/* SSE2 is always available on x86-64 (and on x86 when the compiler targets it) */
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define GGEN_SSE2
+	#include <emmintrin.h>
+#endif
+
 uint16 GGen_Data_2D::num_instances = 0;
 set<GGen_Data_2D*> GGen_Data_2D::instances;
+bool GGen_Data_2D::deferred_evaluation = false;
 
 GGen_Data_2D::GGen_Data_2D(GGen_Size width, GGen_Size height, GGen_Height value)
 {
@@ -50,35 +63,65 @@ GGen_Data_2D::GGen_Data_2D(GGen_Size width, GGen_Size height, GGen_Height value)
 
 	GGen_Data_2D::instances.insert(this);
 
-	this->length = width * height;
+	this->length = (GGen_Index) width * height;
 	this->width = width;
 	this->height = height;
 
 	/* Allocate the array */
-	this->data = new GGen_Height[this->length];
+	this->data = GGen_BufferPool::Allocate(this->length);
+	this->data_references = NULL;
 
 	GGen_Script_Assert(this->data != NULL);
 
+	/* Fill makes the statistics valid */
 	this->Fill(value);
 }
 
+GGen_Data_2D::GGen_Data_2D(GGen_Data_2D* original)
+{
+	GGen_Script_Assert(GGen::GetInstance()->GetStatus() != GGEN_LOADING_MAP_INFO);
+
+	GGen_Script_Assert(GGen_Data_2D::num_instances < GGen::GetMaxMapCount());
+	GGen_Data_2D::num_instances++;
+
+	GGen_Data_2D::instances.insert(this);
+
+	this->length = original->length;
+	this->width = original->width;
+	this->height = original->height;
+
+	/* Share the array with the original, the first write to either of them copies it */
+	if (original->data_references == NULL) {
+		original->data_references = new uint32(1);
+	}
+
+	this->data = original->data;
+	this->data_references = original->data_references;
+	(*this->data_references)++;
+
+	this->stats_valid = original->stats_valid;
+	this->stats_min = original->stats_min;
+	this->stats_max = original->stats_max;
+}
+
 GGen_Data_2D* GGen_Data_2D::Clone()
 {
-	GGen_Data_2D* victim = new GGen_Data_2D(this->width, this->height, 0);
-	
-	/* Copy the data */
-	memcpy(victim->data, this->data, sizeof(GGen_Height) * this->length);
+	this->FlushOperations();
 
-	return victim;
+	return new GGen_Data_2D(this);
 }
 
 GGen_Data_2D::~GGen_Data_2D()
 {
 	assert(GGen_Data_2D::instances.find(this) != GGen_Data_2D::instances.end());
 
+	/* Maps with operations reading this map must evaluate them while the data still exist */
+	this->FlushDependents();
+	this->DiscardOperations();
+
 	GGen_Data_2D::num_instances--;
 	GGen_Data_2D::instances.erase(this);
-	delete [] this->data;
+	this->ReleaseData();
 }
 
 GGen_Size GGen_Data_2D::GetWidth()
@@ -103,8 +146,10 @@ GGen_Distance GGen_Data_2D::GetMaxDistance(){
 GGen_Height GGen_Data_2D::GetValue(GGen_Coord x, GGen_Coord y)
 {
 	GGen_Script_Assert(x < this->width && y < this->height);
+
+	this->FlushOperations();
 	
-	return this->data[x + this->width * y];
+	return this->data[x + (GGen_Index) this->width * y];
 }
 
 GGen_Height GGen_Data_2D::GetValueInterpolated(GGen_Coord x, GGen_Coord y, GGen_Size scale_to_width, GGen_Size scale_to_height)
@@ -116,9 +161,11 @@ GGen_Height GGen_Data_2D::GetValueInterpolated(GGen_Coord x, GGen_Coord y, GGen_
 	GGen_Script_Assert(scale_to_height >= GGEN_MIN_MAP_SIZE);
 	GGen_Script_Assert(scale_to_height <= GGen::GetMaxMapSize());
 
+	this->FlushOperations();
+
 	/* No interpolation needed if the sizes are equal */
 	if (scale_to_width == width && scale_to_height == height) {
-		return data[x + width * y];
+		return data[x + (GGen_Index) width * y];
 	}
 
 	GGen_Height value_y_left, value_y_right;	
@@ -137,14 +184,14 @@ GGen_Height GGen_Data_2D::GetValueInterpolated(GGen_Coord x, GGen_Coord y, GGen_
 	/* Calculate the interpolated value for vertical axis using bilinear interpolation algorithm */
 	if (scale_to_height > this->height) {
 		if (remainder_y == 0) {
-			value_y_left = this->data[base_x + this->width * base_y];
-			value_y_right = this->data[base_x + 1 + this->width * base_y];
+			value_y_left = this->data[base_x + (GGen_Index) this->width * base_y];
+			value_y_right = this->data[base_x + 1 + (GGen_Index) this->width * base_y];
 		} else {
-			value_y_left = (GGen_Height) ((double) this->data[(GGen_Coord) base_x + this->width * base_y] * (1 - remainder_y) + (double) this->data[base_x + this->width * (base_y + 1)] * (remainder_y));
-			value_y_right = (GGen_Height) ((double) this->data[(GGen_Coord) base_x + 1 + this->width * base_y] * (1 - remainder_y) + (double)this-> data[base_x + 1 + this->width * (base_y + 1)] * (remainder_y));
+			value_y_left = (GGen_Height) ((double) this->data[(GGen_Coord) base_x + (GGen_Index) this->width * base_y] * (1 - remainder_y) + (double) this->data[base_x + (GGen_Index) this->width * (base_y + 1)] * (remainder_y));
+			value_y_right = (GGen_Height) ((double) this->data[(GGen_Coord) base_x + 1 + (GGen_Index) this->width * base_y] * (1 - remainder_y) + (double)this-> data[base_x + 1 + (GGen_Index) this->width * (base_y + 1)] * (remainder_y));
 		}
 	} else {
-		value_y_left = value_y_right = (GGen_Height) this->data[(GGen_Coord) base_x + this->width * base_y];
+		value_y_left = value_y_right = (GGen_Height) this->data[(GGen_Coord) base_x + (GGen_Index) this->width * base_y];
 	}
 
 	/* Calculate the interpolated value for horizontal axis */
@@ -153,15 +200,31 @@ GGen_Height GGen_Data_2D::GetValueInterpolated(GGen_Coord x, GGen_Coord y, GGen_
 
 		return (GGen_Height) ((double) value_y_left * (1 - remainder_x) + (double) value_y_right * (remainder_x));
 	} else {
-		return ((GGen_Height) this->data[(GGen_Coord) base_x + width * base_y] + value_y_left) /2;
+		return ((GGen_Height) this->data[(GGen_Coord) base_x + (GGen_Index) width * base_y] + value_y_left) /2;
 	}
 }
 
 void GGen_Data_2D::SetValue(GGen_Coord x, GGen_Coord y, GGen_Height value)
 {
 	GGen_Script_Assert(x < this->width && y < this->height);
+
+	this->FlushOperations();
+	this->FlushDependents();
+	this->Unshare(true);
+
+	if (this->stats_valid) {
+		GGen_Height old_value = this->data[x + (GGen_Index) this->width * y];
+
+		if ((old_value == this->stats_min && value > old_value) || (old_value == this->stats_max && value < old_value)) {
+			/* One of the extremes might have been overwritten */
+			this->stats_valid = false;
+		} else {
+			this->stats_min = MIN(this->stats_min, value);
+			this->stats_max = MAX(this->stats_max, value);
+		}
+	}
 	
-	this->data[x + this->width * y] = value;
+	this->data[x + (GGen_Index) this->width * y] = value;
 }
 
 void GGen_Data_2D::SetValueInRect(GGen_Coord x1, GGen_Coord y1, GGen_Coord x2, GGen_Coord y2, GGen_Height value)
@@ -169,59 +232,269 @@ void GGen_Data_2D::SetValueInRect(GGen_Coord x1, GGen_Coord y1, GGen_Coord x2, G
 	GGen_Script_Assert(x2 < this->width && y2 < this->height);
 	GGen_Script_Assert(x1 <= x2 && y1 <= y2);
 
+	this->PrepareWrite();
+
 	for (GGen_Coord y = y1; y <= y2; y++) {
 		for (GGen_Coord x = x1; x <= x2; x++) {
-			this->data[x + this->width * y] = value;
+			this->data[x + (GGen_Index) this->width * y] = value;
 		}
 	}
 
 }
 
-void GGen_Data_2D::ScaleTo(GGen_Size new_width, GGen_Size new_height, bool scale_values)
+void GGen_Data_2D::GetRegion(GGen_Coord x, GGen_Coord y, GGen_Size width, GGen_Size height, GGen_Height* output)
+{
+	GGen_Script_Assert(width > 0 && height > 0);
+	GGen_Script_Assert(output != NULL);
+	GGen_Script_Assert((GGen_Index) x + width <= this->width && (GGen_Index) y + height <= this->height);
+
+	this->FlushOperations();
+
+	for (GGen_Size row = 0; row < height; row++) {
+		memcpy(output + row * (GGen_Index) width, this->data + x + (y + row) * (GGen_Index) this->width, sizeof(GGen_Height) * width);
+	}
+}
+
+void GGen_Data_2D::SetRegion(GGen_Coord x, GGen_Coord y, GGen_Size width, GGen_Size height, const GGen_Height* values)
+{
+	GGen_Script_Assert(width > 0 && height > 0);
+	GGen_Script_Assert(values != NULL);
+	GGen_Script_Assert((GGen_Index) x + width <= this->width && (GGen_Index) y + height <= this->height);
+
+	this->PrepareWrite();
+
+	for (GGen_Size row = 0; row < height; row++) {
+		memcpy(this->data + x + (y + row) * (GGen_Index) this->width, values + row * (GGen_Index) width, sizeof(GGen_Height) * width);
+	}
+}
+
+void GGen_Data_2D::GetRow(GGen_Coord y, GGen_Height* output)
+{
+	GGen_Script_Assert(y < this->height);
+
+	this->GetRegion(0, y, this->width, 1, output);
+}
+
+void GGen_Data_2D::SetRow(GGen_Coord y, const GGen_Height* values)
+{
+	GGen_Script_Assert(y < this->height);
+
+	this->SetRegion(0, y, this->width, 1, values);
+}
+
+void GGen_Data_2D::GetValues(const GGen_Coord* xs, const GGen_Coord* ys, GGen_Index count, GGen_Height* output)
+{
+	GGen_Script_Assert(count == 0 || (xs != NULL && ys != NULL && output != NULL));
+
+	for (GGen_Index i = 0; i < count; i++) {
+		GGen_Script_Assert(xs[i] < this->width && ys[i] < this->height);
+	}
+
+	this->FlushOperations();
+
+	for (GGen_Index i = 0; i < count; i++) {
+		output[i] = this->data[xs[i] + ys[i] * (GGen_Index) this->width];
+	}
+}
+
+// Weight of a sample in given distance (in source tiles) from the resampled position.
+double ScaleTo_Kernel(GGen_Scaling_Filter filter, double distance){
+	const double pi = 3.14159265358979;
+	double x = ABS(distance);
+
+	switch (filter) {
+		case GGEN_BOX:
+			/* Half-open, so exactly one sample is picked when the tiles are not shrunk */
+			return distance >= -0.5 && distance < 0.5 ? 1 : 0;
+		case GGEN_BILINEAR:
+			return x < 1 ? 1 - x : 0;
+		case GGEN_BICUBIC:
+			/* Catmull-Rom spline */
+			if (x < 1) return 1.5 * x * x * x - 2.5 * x * x + 1;
+			if (x < 2) return -0.5 * x * x * x + 2.5 * x * x - 4 * x + 2;
+			return 0;
+		case GGEN_LANCZOS:
+			if (x < 1e-9) return 1;
+			if (x < 3) return 3 * sin(pi * x) * sin(pi * x / 3) / (pi * pi * x * x);
+			return 0;
+	}
+
+	return 0;
+}
+
+// Radius of the filter kernel (in source tiles).
+double ScaleTo_KernelRadius(GGen_Scaling_Filter filter){
+	switch (filter) {
+		case GGEN_BOX: return 0.5;
+		case GGEN_BILINEAR: return 1;
+		case GGEN_BICUBIC: return 2;
+		case GGEN_LANCZOS: return 3;
+	}
+
+	return 1;
+}
+
+// Precomputed samples for each target tile along one axis. Samples of target tile i are stored at positions
+// <start[i], start[i + 1]).
+struct ScaleTo_Taps{
+	vector<GGen_Index> start;
+	vector<GGen_Coord> source;
+	vector<float> weight;
+
+	ScaleTo_Taps(GGen_Size source_size, GGen_Size target_size, GGen_Scaling_Filter filter){
+		/* The first and the last tiles of both sizes are aligned */
+		double ratio = (double) (source_size - 1) / (double) (target_size - 1);
+
+		/* When shrinking, the kernel is stretched over all source tiles covered by one target tile */
+		double stretch = MAX(ratio, 1.0);
+		double radius = ScaleTo_KernelRadius(filter) * stretch;
+
+		for (GGen_Size i = 0; i < target_size; i++) {
+			double center = i * ratio;
+
+			this->start.push_back((GGen_Index) this->source.size());
+
+			GGen_CoordOffset first = (GGen_CoordOffset) ceil(center - radius);
+			GGen_CoordOffset last = (GGen_CoordOffset) floor(center + radius);
+			double sum = 0;
+
+			GGen_Index first_tap = (GGen_Index) this->source.size();
+
+			for (GGen_CoordOffset j = first; j <= last; j++) {
+				double weight = ScaleTo_Kernel(filter, (j - center) / stretch);
+
+				if (weight == 0) continue;
+
+				/* Samples outside of the map are replaced by the edge */
+				GGen_Coord source = (GGen_Coord) MAX(MIN(j, (GGen_CoordOffset) source_size - 1), 0);
+
+				/* Merge with the previous tap if it samples the same tile */
+				if (this->source.size() > first_tap && this->source.back() == source) {
+					this->weight.back() += (float) weight;
+				} else {
+					this->source.push_back(source);
+					this->weight.push_back((float) weight);
+				}
+
+				sum += weight;
+			}
+
+			/* Normalize the weights */
+			for (GGen_Index j = first_tap; j < this->source.size(); j++) {
+				this->weight[j] = (float) (this->weight[j] / sum);
+			}
+		}
+
+		this->start.push_back((GGen_Index) this->source.size());
+	}
+};
+
+void GGen_Data_2D::ScaleToFiltered(GGen_Size new_width, GGen_Size new_height, bool scale_values, GGen_Scaling_Filter filter)
 {
 	GGen_Script_Assert(new_width >= GGEN_MIN_MAP_SIZE);
 	GGen_Script_Assert(new_width <= GGen::GetMaxMapSize());
 	GGen_Script_Assert(new_height >= GGEN_MIN_MAP_SIZE);
 	GGen_Script_Assert(new_height <= GGen::GetMaxMapSize());
 
+	this->PrepareReplace();
+
 	/* Pick the ratio for values as arithmetic average of horizontal and vertical ratios */
 	double ratio = ((double) new_width / (double) this->width + (double) new_height / (double) this->height) / 2.0;
 
+	ScaleTo_Taps horizontal(this->width, new_width, filter);
+	ScaleTo_Taps vertical(this->height, new_height, filter);
+
+	/* Horizontally resampled rows of the original map */
+	float* rows = new float[(GGen_TotalSize) new_width * this->height];
+
 	/* Allocate the new array */
-	GGen_Height* new_data = new GGen_Height[new_width * new_height];
+	GGen_Height* new_data = GGen_BufferPool::Allocate((GGen_Index) new_width * new_height);
 
-	GGen_Script_Assert(new_data != NULL);
+	GGen_Script_Assert(rows != NULL && new_data != NULL);
+
+	/* Pass 1: resample the rows */
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			GGen_Height* source = this->data + y * (GGen_Index) this->width;
+			float* target = rows + y * (GGen_Index) new_width;
+
+			for (GGen_Coord x = 0; x < new_width; x++) {
+				float value = 0;
 
-	/* Fill the new array */
-	for (GGen_Coord y = 0; y < new_height; y++) {
-		for (GGen_Coord x = 0; x < new_width; x++) {
-			new_data[x + y * new_width] = scale_values ? (GGen_Height) ((double) this->GetValueInterpolated(x , y, new_width, new_height) * ratio) : this->GetValueInterpolated(x , y, new_width, new_height);
+				for (GGen_Index i = horizontal.start[x]; i < horizontal.start[x + 1]; i++) {
+					value += horizontal.weight[i] * source[horizontal.source[i]];
+				}
+
+				target[x] = value;
+			}
 		}
-	}
+	});
+
+	/* Pass 2: resample the columns (whole rows are accumulated at once, so the map is read in row order) */
+	GGen_ParallelFor(0, new_height, [&](GGen_Index from, GGen_Index to){
+		float* sum = new float[new_width];
+
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			memset(sum, 0, new_width * sizeof(float));
+
+			for (GGen_Index i = vertical.start[y]; i < vertical.start[y + 1]; i++) {
+				float* source = rows + vertical.source[i] * (GGen_Index) new_width;
+				float weight = vertical.weight[i];
+				GGen_Coord x = 0;
+
+#ifdef GGEN_SSE2
+				__m128 weights = _mm_set1_ps(weight);
+
+				for (; x + 4 <= new_width; x += 4) {
+					_mm_storeu_ps(sum + x, _mm_add_ps(_mm_loadu_ps(sum + x), _mm_mul_ps(weights, _mm_loadu_ps(source + x))));
+				}
+#endif
+
+				for (; x < new_width; x++) {
+					sum[x] += weight * source[x];
+				}
+			}
+
+			for (GGen_Coord x = 0; x < new_width; x++) {
+				double value = scale_values ? sum[x] * ratio : sum[x];
+
+				new_data[x + y * (GGen_Index) new_width] = (GGen_Height) MAX(MIN(floor(value + 0.5), (double) GGEN_MAX_HEIGHT), (double) GGEN_MIN_HEIGHT);
+			}
+		}
+
+		delete [] sum;
+	});
+
+	delete [] rows;
 
 	/* Relink and delete the original array data */
-	delete [] this->data;
-	this->data = new_data;
+	this->ReplaceData(new_data);
 	this->width = new_width;
 	this->height = new_height;
-	this->length = new_width * new_height;
+	this->length = (GGen_Index) new_width * new_height;
+}
+
+void GGen_Data_2D::ScaleTo(GGen_Size new_width, GGen_Size new_height, bool scale_values)
+{
+	this->ScaleToFiltered(new_width, new_height, scale_values, GGEN_BILINEAR);
 }
 
 void GGen_Data_2D::ScaleValuesTo(GGen_Height new_min, GGen_Height new_max)
 {
 	GGen_Script_Assert(new_max > new_min);
 
-	GGen_ExtHeight min = this->Min();
-	GGen_ExtHeight max = this->Max() - min;
+	GGen_Height old_min, old_max;
+	this->MinMax(&old_min, &old_max);
 
-	GGen_ExtHeight ext_new_min = new_min;
-	GGen_ExtHeight ext_new_max = (GGen_ExtHeight) new_max - ext_new_min;
+	if (old_max == old_min) return;
 
-	if (max == 0) return;
+	GGen_Data_2D_Operation operation(GGEN_OPERATION_SCALE_VALUES);
+	operation.from_min = old_min;
+	operation.from_range = (GGen_ExtHeight) old_max - old_min;
+	operation.to_min = new_min;
+	operation.to_range = (GGen_ExtHeight) new_max - new_min;
 
-	for (GGen_Index i = 0; i < this->length; i++) {
-		this->data[i] = (GGen_Height) (ext_new_min + ((GGen_ExtHeight) this->data[i] - min) * ext_new_max / max);
-	}
+	this->ApplyOperation(operation);
 }
 
 void GGen_Data_2D::Scale(double ratio, bool scale_values)
@@ -236,44 +509,51 @@ void GGen_Data_2D::ResizeCanvas(GGen_Size new_width, GGen_Size new_height, GGen_
 	GGen_Script_Assert(new_height >= GGEN_MIN_MAP_SIZE);
 	GGen_Script_Assert(new_height <= GGen::GetMaxMapSize());
 	GGen_Script_Assert(new_zero_x <= GGen::GetMaxMapSize());
-	GGen_Script_Assert(new_zero_x >= -GGen::GetMaxMapSize());
+	GGen_Script_Assert(new_zero_x >= -(GGen_CoordOffset) GGen::GetMaxMapSize());
 	GGen_Script_Assert(new_zero_y <= GGen::GetMaxMapSize());
-	GGen_Script_Assert(new_zero_y >= -GGen::GetMaxMapSize());
+	GGen_Script_Assert(new_zero_y >= -(GGen_CoordOffset) GGen::GetMaxMapSize());
 	
+	this->PrepareReplace();
+
 	/* Allocate the new array */
-	GGen_Height* new_data = new GGen_Height[new_width * new_height];
+	GGen_Height* new_data = GGen_BufferPool::Allocate((GGen_Index) new_width * new_height);
 
 	GGen_Script_Assert(new_data != NULL);
 
-	for (GGen_Coord y = 0; y < new_height; y++) {
-		for (GGen_Coord x = 0; x < new_width; x++) {
-			if (y + new_zero_y >= 0 && y + new_zero_y < this->height && x + new_zero_x >= 0 && x + new_zero_x < this->width) {
-				new_data[x + y * new_width] = this->data[x + new_zero_x + (y + new_zero_y) * this->width];
-			} else {
-				new_data[x + y * new_width] = 0;
+	GGen_ParallelFor(0, new_height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			for (GGen_Coord x = 0; x < new_width; x++) {
+				if (y + new_zero_y >= 0 && y + new_zero_y < this->height && x + new_zero_x >= 0 && x + new_zero_x < this->width) {
+					new_data[x + y * (GGen_Index) new_width] = this->data[x + new_zero_x + (y + new_zero_y) * (GGen_Index) this->width];
+				} else {
+					new_data[x + y * (GGen_Index) new_width] = 0;
+				}
 			}
 		}
-	}
+	});
 
 	/* Relink and delete the original array data */
-	delete [] this->data;
-	this->data = new_data;
-	this->length = new_width * new_height;
+	this->ReplaceData(new_data);
+	this->length = (GGen_Index) new_width * new_height;
 	this->width = new_width;
 	this->height = new_height;
 }
 
 void GGen_Data_2D::Fill(GGen_Height value)
 {
-	for (GGen_Index i = 0; i < this->length; i++) {
-		this->data[i] = value;
-	}
+	GGen_Data_2D_Operation operation(GGEN_OPERATION_FILL);
+	operation.value = value;
+
+	this->ApplyOperation(operation);
 }
 
 void GGen_Data_2D::FillMasked(GGen_Height value, GGen_Data_2D* mask, bool relative)
 {
 	GGen_Script_Assert(mask != NULL);
 
+	this->PrepareWrite();
+	mask->FlushOperations();
+
 	GGen_ExtHeight max = GGEN_UNRELATIVE_CAP;
 
 	if(relative){
@@ -282,19 +562,22 @@ void GGen_Data_2D::FillMasked(GGen_Height value, GGen_Data_2D* mask, bool relati
 
 	if(max == 0) return;
 
-	for (GGen_Coord y = 0; y < this->height; y++) {
-		for (GGen_Coord x = 0; x < this->width; x++)	{
-			GGen_Height maskValue = mask->GetValueInterpolated(x, y, this->width, this->height);
-			this->data[x + y * width] = maskValue * value + (max - maskValue) * this->data[x + y * width];
-		}
-	}	
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			for (GGen_Coord x = 0; x < this->width; x++)	{
+				GGen_Height maskValue = mask->GetValueInterpolated(x, y, this->width, this->height);
+				this->data[x + y * (GGen_Index) width] = maskValue * value + (max - maskValue) * this->data[x + y * (GGen_Index) width];
+			}
+		}	
+	});
 }
 
 void GGen_Data_2D::Add(GGen_Height value)
 {
-	for (GGen_Index i = 0; i < this->length; i++) {
-		this->data[i] += value;
-	}
+	GGen_Data_2D_Operation operation(GGEN_OPERATION_ADD);
+	operation.value = value;
+
+	this->ApplyOperation(operation);
 }
 
 
@@ -302,37 +585,52 @@ void GGen_Data_2D::AddMap(GGen_Data_2D* addend)
 {
 	GGen_Script_Assert(addend != NULL);
 
+	if (addend->width == this->width && addend->height == this->height) {
+		/* The addend doesn't need to be scaled, so the tiles can be just added one by one */
+		GGen_Data_2D_Operation operation(GGEN_OPERATION_ADD_MAP);
+		operation.map = addend;
+
+		this->ApplyOperation(operation);
+		return;
+	}
+
+	this->PrepareWrite();
+	addend->FlushOperations();
+
 	/* Scale the addend as necessary */
-	for (GGen_Coord y = 0; y < this->height; y++) {
-		for (GGen_Coord x = 0; x < this->width; x++)	{
-			data[x + y * this->width] += addend->GetValueInterpolated(x, y , this->width, this->height);
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			for (GGen_Coord x = 0; x < this->width; x++)	{
+				data[x + y * (GGen_Index) this->width] += addend->GetValueInterpolated(x, y , this->width, this->height);
+			}
 		}
-	}
+	});
 }
 
 void GGen_Data_2D::ReplaceValue(GGen_Height needle, GGen_Height replace)
 {
-	for (GGen_Coord y = 0; y < this->height; y++) {
-		for (GGen_Coord x = 0; x < this->width; x++)	{
-			if (this->data[x + y * this->width] == needle) {
-				this->data[x + y * this->width] = replace;
-			}
-		}
-	}
+	GGen_Data_2D_Operation operation(GGEN_OPERATION_REPLACE_VALUE);
+	operation.value = needle;
+	operation.replacement = replace;
+
+	this->ApplyOperation(operation);
 }
 
 void GGen_Data_2D::AddTo(GGen_Data_2D* addend, GGen_CoordOffset offset_x, GGen_CoordOffset offset_y)
 {
 	GGen_Script_Assert(addend != NULL);
-	GGen_Script_Assert(offset_x > -this->width);
+	GGen_Script_Assert(offset_x > -(GGen_CoordOffset) this->width);
 	GGen_Script_Assert(offset_x < this->width);
-	GGen_Script_Assert(offset_y > -this->height);
+	GGen_Script_Assert(offset_y > -(GGen_CoordOffset) this->height);
 	GGen_Script_Assert(offset_y < this->height);
 
+	this->PrepareWrite();
+	addend->FlushOperations();
+
 	/* Walk through the items where the array and the addend with offset intersect */
 	for (GGen_Coord y = MAX(0, offset_y); y < MIN(this->height, offset_y + addend->height); y++) {
 		for (GGen_Coord x = MAX(0, offset_x); x < MIN(this->width, offset_x + addend->width); x++) {
-			this->data[x + y * this->width] += addend->data[(x - offset_x) + (y - offset_y) * addend->width];
+			this->data[x + y * (GGen_Index) this->width] += addend->data[(x - offset_x) + (y - offset_y) * addend->width];
 		}
 	}
 }
@@ -342,6 +640,10 @@ void GGen_Data_2D::AddMapMasked(GGen_Data_2D* addend, GGen_Data_2D* mask, bool r
 	GGen_Script_Assert(addend != NULL);
 	GGen_Script_Assert(mask != NULL);
 	
+	this->PrepareWrite();
+	addend->FlushOperations();
+	mask->FlushOperations();
+
 	GGen_ExtHeight max = GGEN_UNRELATIVE_CAP;
 
 	if (relative){
@@ -350,17 +652,22 @@ void GGen_Data_2D::AddMapMasked(GGen_Data_2D* addend, GGen_Data_2D* mask, bool r
 	
 	if (max == 0) return;
 
-	for (GGen_Coord y = 0; y < this->height; y++) {
-		for (GGen_Coord x = 0; x < this->width; x++) {
-			this->data[x + y * this->width] += (GGen_ExtHeight) addend->GetValueInterpolated(x, y, this->width, this->height) * (GGen_ExtHeight) mask->GetValueInterpolated(x, y, this->width, this->height) / max;
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			for (GGen_Coord x = 0; x < this->width; x++) {
+				this->data[x + y * (GGen_Index) this->width] += (GGen_ExtHeight) addend->GetValueInterpolated(x, y, this->width, this->height) * (GGen_ExtHeight) mask->GetValueInterpolated(x, y, this->width, this->height) / max;
+			}
 		}
-	}
+	});
 }
 
 void GGen_Data_2D::AddMasked(GGen_Height value, GGen_Data_2D* mask, bool relative)
 {
 	GGen_Script_Assert(mask != NULL);
 
+	this->PrepareWrite();
+	mask->FlushOperations();
+
 	GGen_ExtHeight max = GGEN_UNRELATIVE_CAP;
 
 	if(relative){
@@ -369,18 +676,21 @@ void GGen_Data_2D::AddMasked(GGen_Height value, GGen_Data_2D* mask, bool relativ
 
 	if(max == 0) return;
 
-	for (GGen_Coord y = 0; y < this->height; y++) {
-		for (GGen_Coord x = 0; x < this->width; x++)	{
-			this->data[x + y * width] += (GGen_ExtHeight) value * (GGen_ExtHeight) mask->GetValueInterpolated(x, y, this->width, this->height) / max;
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			for (GGen_Coord x = 0; x < this->width; x++)	{
+				this->data[x + y * (GGen_Index) width] += (GGen_ExtHeight) value * (GGen_ExtHeight) mask->GetValueInterpolated(x, y, this->width, this->height) / max;
+			}
 		}
-	}
+	});
 }
 
 void GGen_Data_2D::Multiply(double factor)
 {
-	for (GGen_Index i = 0; i < this->length; i++) {
-		this->data[i] = (GGen_Coord) (factor * (double) this->data[i]);
-	}
+	GGen_Data_2D_Operation operation(GGEN_OPERATION_MULTIPLY);
+	operation.factor = factor;
+
+	this->ApplyOperation(operation);
 }
 
 
@@ -388,171 +698,760 @@ void GGen_Data_2D::MultiplyMap(GGen_Data_2D* factor)
 {
 	GGen_Script_Assert(factor != NULL);
 
+	this->PrepareWrite();
+	factor->FlushOperations();
+
 	/* Scale the factor as necessary */
-	for (GGen_Coord y = 0; y < this->height; y++) {
-		for (GGen_Coord x = 0; x < this->width; x++)	{
-			this->data[x + y * this->width] *= factor->GetValueInterpolated(x, y , this->width, this->height);
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			for (GGen_Coord x = 0; x < this->width; x++)	{
+				this->data[x + y * (GGen_Index) this->width] *= factor->GetValueInterpolated(x, y , this->width, this->height);
+			}
 		}
-	}
+	});
 }
 
 void GGen_Data_2D::Invert()
 {
-	for (GGen_Index i = 0; i < length; i++) {
-		this->data[i] = -this->data[i];
-	}
+	this->ApplyOperation(GGen_Data_2D_Operation(GGEN_OPERATION_INVERT));
 }
 
 
 GGen_Height GGen_Data_2D::Min()
 {
-	GGen_Height temp = GGEN_MAX_HEIGHT;
-
-	for (GGen_Index i = 0; i < this->length; i++) {
-		temp = temp > this->data[i] ? this->data[i] : temp;
-	}
+	GGen_Height min, max;
+	this->MinMax(&min, &max);
 
-	return temp;
+	return min;
 }
 
 GGen_Height GGen_Data_2D::Max()
 {
-	GGen_Height temp = GGEN_MIN_HEIGHT;
-
-	for (GGen_Index i = 0; i < this->length; i++) {
-		temp = temp < this->data[i] ? this->data[i] : temp;
-	}
+	GGen_Height min, max;
+	this->MinMax(&min, &max);
 
-	return temp;
+	return max;
 }
 
-void GGen_Data_2D::Clamp(GGen_Height min, GGen_Height max)
+void GGen_Data_2D::MinMax(GGen_Height* min, GGen_Height* max)
 {
-	GGen_Script_Assert(max > min);
+	/* Evaluating the waiting operations updates the statistics too */
+	if (!this->stats_valid) {
+		this->FlushOperations();
+	}
 
-	for (GGen_Index i = 0; i < this->length; i++) {
-		if (this->data[i] > max) {
-			this->data[i] = max;
-		} else if (data[i] < min) {
-			this->data[i] = min;
+	if (!this->stats_valid) {
+		/* Each block of the map is scanned for both extremes at once, the blocks are merged afterwards */
+		GGen_Index num_blocks = MIN((GGen_Index) GGen_ThreadPool::GetThreadCount(), (GGen_Index) this->height);
+		GGen_Height* block_min = new GGen_Height[num_blocks];
+		GGen_Height* block_max = new GGen_Height[num_blocks];
+
+		GGen_Script_Assert(block_min != NULL && block_max != NULL);
+
+		GGen_ParallelFor(0, num_blocks, [&](GGen_Index from, GGen_Index to){
+			for (GGen_Index block = from; block < to; block++) {
+				GGen_Index i = (GGen_Index) ((uint64) this->length * block / num_blocks);
+				GGen_Index last = (GGen_Index) ((uint64) this->length * (block + 1) / num_blocks);
+
+				/* The same limits as the empty map would have */
+				GGen_Height current_min = GGEN_MAX_HEIGHT;
+				GGen_Height current_max = GGEN_MIN_HEIGHT;
+
+				#ifdef GGEN_SSE2
+				__m128i min_lanes = _mm_set1_epi16(GGEN_MAX_HEIGHT);
+				__m128i max_lanes = _mm_set1_epi16(GGEN_MIN_HEIGHT);
+
+				for (; i + 8 <= last; i += 8) {
+					__m128i values = _mm_loadu_si128((const __m128i*) (this->data + i));
+					min_lanes = _mm_min_epi16(min_lanes, values);
+					max_lanes = _mm_max_epi16(max_lanes, values);
+				}
+
+				GGen_Height lanes[8];
+				_mm_storeu_si128((__m128i*) lanes, min_lanes);
+				for (int lane = 0; lane < 8; lane++) current_min = MIN(current_min, lanes[lane]);
+
+				_mm_storeu_si128((__m128i*) lanes, max_lanes);
+				for (int lane = 0; lane < 8; lane++) current_max = MAX(current_max, lanes[lane]);
+				#endif
+
+				for (; i < last; i++) {
+					current_min = MIN(current_min, this->data[i]);
+					current_max = MAX(current_max, this->data[i]);
+				}
+
+				block_min[block] = current_min;
+				block_max[block] = current_max;
+			}
+		});
+
+		this->stats_min = GGEN_MAX_HEIGHT;
+		this->stats_max = GGEN_MIN_HEIGHT;
+
+		for (GGen_Index block = 0; block < num_blocks; block++) {
+			this->stats_min = MIN(this->stats_min, block_min[block]);
+			this->stats_max = MAX(this->stats_max, block_max[block]);
 		}
+
+		delete [] block_min;
+		delete [] block_max;
+
+		this->stats_valid = true;
 	}
+
+	*min = this->stats_min;
+	*max = this->stats_max;
 }
 
-void GGen_Data_2D::CropValues(GGen_Height min, GGen_Height max)
+void GGen_Data_2D::PrepareWrite()
 {
-	GGen_Script_Assert(max > min);
+	this->FlushOperations();
+	this->FlushDependents();
+	this->Unshare(true);
 
-	for (GGen_Index i = 0; i < this->length; i++) {
-		if (this->data[i] > max) {
-			this->data[i] = 0;
-		} else if (data[i] < min) {
-			this->data[i] = 0;
-		}
-	}
+	this->stats_valid = false;
 }
 
-void GGen_Data_2D::Union(GGen_Data_2D* victim)
+void GGen_Data_2D::PrepareReplace()
 {
-	GGen_Script_Assert(victim != NULL);
+	this->FlushOperations();
+	this->FlushDependents();
 
-	for (GGen_Coord y = 0; y < this->height; y++) {
-		for (GGen_Coord x = 0; x < this->width; x++) {	
-			this->data[x + y * width] = MAX(this->data[x + y * this->width], victim->GetValueInterpolated(x, y, this->width, this->height));
-		}
-	}
+	this->stats_valid = false;
 }
 
-void GGen_Data_2D::UnionTo(GGen_Data_2D* victim, GGen_CoordOffset offset_x, GGen_CoordOffset offset_y)
+void GGen_Data_2D::Unshare(bool keep_values)
 {
-	GGen_Script_Assert(victim != NULL);
-	GGen_Script_Assert(offset_x > -this->width);
-	GGen_Script_Assert(offset_x < this->width);
-	GGen_Script_Assert(offset_y > -this->height);
-	GGen_Script_Assert(offset_y < this->height);
+	if (this->data_references == NULL) return;
 
-	/* Walk through the items where the array and the victim with offset intersect */
-	for (GGen_Coord y = MAX(0, offset_y); y < MIN(this->height, offset_y + victim->height); y++) {
-		for (GGen_Coord x = MAX(0, offset_x); x < MIN(this->width, offset_x + victim->width); x++) {
-			this->data[x + y * width] = MAX(victim->data[(x - offset_x) + (y - offset_y) * victim->width], this->data[x + y * this->width]);
+	if (*this->data_references > 1) {
+		GGen_Height* new_data = GGen_BufferPool::Allocate(this->length);
+
+		GGen_Script_Assert(new_data != NULL);
+
+		if (keep_values) {
+			memcpy(new_data, this->data, sizeof(GGen_Height) * this->length);
 		}
+
+		(*this->data_references)--;
+		this->data = new_data;
+	}
+	else {
+		delete this->data_references;
 	}
+
+	this->data_references = NULL;
 }
 
-void GGen_Data_2D::Intersection(GGen_Data_2D* victim)
+void GGen_Data_2D::ReleaseData()
 {
-	GGen_Script_Assert(victim != NULL);
-
-	for(GGen_Coord y = 0; y < this->height; y++) {
-		for(GGen_Coord x = 0; x < this->width; x++) {	
-			this->data[x + y * this->width] = MIN(this->data[x + y * this->width], victim->GetValueInterpolated(x, y, this->width, this->height));
-		}
+	if (this->data_references == NULL || --(*this->data_references) == 0) {
+		GGen_BufferPool::Release(this->data);
+		delete this->data_references;
 	}
+
+	this->data_references = NULL;
 }
 
-void GGen_Data_2D::IntersectionTo(GGen_Data_2D* victim, GGen_CoordOffset offset_x, GGen_CoordOffset offset_y)
+void GGen_Data_2D::ReplaceData(GGen_Height* new_data)
 {
-	GGen_Script_Assert(victim != NULL);
-	GGen_Script_Assert(offset_x > -this->width);
-	GGen_Script_Assert(offset_x < this->width);
-	GGen_Script_Assert(offset_y > -this->height);
-	GGen_Script_Assert(offset_y < this->height);
-
-	/* Walk through the items where the array and the addend with offset intersect */
-	for (GGen_Coord y = MAX(0, offset_y); y < MIN(this->height, offset_y + victim->height); y++) {
-		for (GGen_Coord x = MAX(0, offset_x); x < MIN(this->width, offset_x + victim->width); x++) {
-			this->data[x + y * width] = MIN(victim->data[(x - offset_x) + (y - offset_y) * victim->width], this->data[x + y * this->width]);
-		}
-	}
+	this->ReleaseData();
+	this->data = new_data;
 }
 
-void GGen_Data_2D::Combine(GGen_Data_2D* victim, GGen_Data_2D* mask, bool relative)
+void GGen_Data_2D::FlushOperations()
 {
-	GGen_Script_Assert(victim != NULL);
-	GGen_Script_Assert(mask != NULL);
+	if (this->operations.empty()) return;
 
-	GGen_Height max = GGEN_UNRELATIVE_CAP;
+	/* The maps reading this map must see the values from before these operations */
+	this->FlushDependents();
 
-	if(relative){
-		max = mask->Max();
-	}
+	vector<GGen_Data_2D_Operation> operations;
+	operations.swap(this->operations);
 
-	if(max == 0) return;
-	
-	for (GGen_Coord y = 0; y < this->height; y++) {
-		for (GGen_Coord x = 0; x < this->width; x++) {	
-			this->data[x + y * this->width] = 
-				(GGen_ExtHeight) this->data[x + y * this->width] * (GGen_ExtHeight) mask->GetValueInterpolated(x, y, this->width, this->height) / max + 
-				(GGen_ExtHeight) victim->GetValueInterpolated(x, y, this->width, this->height) * (GGen_ExtHeight) (max - mask->GetValueInterpolated(x, y, this->width, this->height))/ max;
+	/* A leading fill overwrites all values, a shared array does not have to be copied */
+	this->Unshare(operations[0].type != GGEN_OPERATION_FILL);
+
+	this->RunOperations(&operations[0], operations.size());
+
+	for (size_t i = 0; i < operations.size(); i++) {
+		if (operations[i].map != NULL) {
+			operations[i].map->dependents.erase(this);
 		}
 	}
 }
 
-void GGen_Data_2D::Abs()
+void GGen_Data_2D::FlushDependents()
 {
-	for (GGen_Index i = 0; i < this->length; i++) {
-		if (this->data[i] < 0) {
-			this->data[i] = -this->data[i];
-		}
+	/* Each dependent unregisters itself once its operations are evaluated */
+	while (!this->dependents.empty()) {
+		(*this->dependents.begin())->FlushOperations();
 	}
 }
 
-void GGen_Data_2D::Project(GGen_Data_1D* profile, GGen_Direction direction)
+void GGen_Data_2D::DiscardOperations()
 {
-	GGen_Script_Assert(profile != NULL);
-
-	if (direction == GGEN_HORIZONTAL) {
-		for(GGen_Coord y = 0; y < this->height; y++) {
-			for(GGen_Coord x = 0; x < this->width; x++) {		
-				this->data[x + y * this->width] = profile->GetValueInterpolated(y, this->height);
-			}
+	for (size_t i = 0; i < this->operations.size(); i++) {
+		if (this->operations[i].map != NULL) {
+			this->operations[i].map->dependents.erase(this);
 		}
-	} else {
-		for (GGen_Coord y = 0; y < this->height; y++) {
-			for (GGen_Coord x = 0; x < this->width; x++) {		
-				this->data[x + y * this->width] = profile->GetValueInterpolated(x, this->width);
+	}
+
+	this->operations.clear();
+}
+
+void GGen_Data_2D::SetDeferredEvaluation(bool enabled)
+{
+	GGen_Data_2D::deferred_evaluation = enabled;
+}
+
+bool GGen_Data_2D::GetDeferredEvaluation()
+{
+	return GGen_Data_2D::deferred_evaluation;
+}
+
+void GGen_Data_2D::ApplyOperation(const GGen_Data_2D_Operation& operation)
+{
+	if (!GGen_Data_2D::deferred_evaluation) {
+		/* The addend must be up to date */
+		if (operation.map != NULL) {
+			operation.map->FlushOperations();
+		}
+
+		if (operation.type == GGEN_OPERATION_FILL) {
+			this->PrepareReplace();
+			this->Unshare(false);
+		}
+		else {
+			this->PrepareWrite();
+		}
+
+		this->RunOperations(&operation, 1);
+		return;
+	}
+
+	if (operation.type == GGEN_OPERATION_FILL) {
+		/* Results of the waiting operations would be overwritten anyway */
+		this->DiscardOperations();
+	}
+
+	if (operation.map != NULL && operation.map != this) {
+		/* The addend is read as it is now, any later changes must wait for this map */
+		operation.map->FlushOperations();
+		operation.map->dependents.insert(this);
+	}
+
+	this->operations.push_back(operation);
+
+	/* Keep the statistics where the result is known without evaluation */
+	switch (operation.type) {
+		case GGEN_OPERATION_FILL:
+			this->stats_valid = true;
+			this->stats_min = this->stats_max = operation.value;
+			break;
+		case GGEN_OPERATION_CLAMP:
+			/* Clamping doesn't change order of the values, so the extremes are just clamped too */
+			this->stats_min = MIN(MAX(this->stats_min, operation.min), operation.max);
+			this->stats_max = MIN(MAX(this->stats_max, operation.min), operation.max);
+			break;
+		case GGEN_OPERATION_SCALE_VALUES:
+			/* The old extremes are mapped exactly onto the new ones */
+			this->stats_valid = true;
+			this->stats_min = (GGen_Height) operation.to_min;
+			this->stats_max = (GGen_Height) (operation.to_min + operation.to_range);
+			break;
+		default:
+			this->stats_valid = false;
+			break;
+	}
+}
+
+/* Number of tiles processed by all operations at once (so they stay in the cache between the operations) */
+#define GGEN_OPERATION_BLOCK_SIZE 4096
+
+void GGen_Data_2D::RunOperations(const GGen_Data_2D_Operation* operations, size_t count)
+{
+	GGen_Index num_blocks = (this->length + GGEN_OPERATION_BLOCK_SIZE - 1) / GGEN_OPERATION_BLOCK_SIZE;
+	GGen_Height* block_min = new GGen_Height[num_blocks];
+	GGen_Height* block_max = new GGen_Height[num_blocks];
+
+	GGen_Script_Assert(block_min != NULL && block_max != NULL);
+
+	/* The arrays are walked from start to end, let the system read ahead in the file backed ones */
+	GGen_BufferPool::SetSequentialAccess(this->data, true);
+
+	for (size_t j = 0; j < count; j++) {
+		if (operations[j].type == GGEN_OPERATION_ADD_MAP) GGen_BufferPool::SetSequentialAccess(operations[j].map->data, true);
+	}
+
+	GGen_ParallelFor(0, num_blocks, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index block = from; block < to; block++) {
+			GGen_Index offset = block * GGEN_OPERATION_BLOCK_SIZE;
+			GGen_Index block_length = MIN(GGEN_OPERATION_BLOCK_SIZE, this->length - offset);
+			GGen_Height* values = this->data + offset;
+
+			for (size_t j = 0; j < count; j++) {
+				const GGen_Data_2D_Operation& operation = operations[j];
+
+				switch (operation.type) {
+					case GGEN_OPERATION_FILL:
+						for (GGen_Index i = 0; i < block_length; i++) values[i] = operation.value;
+						break;
+					case GGEN_OPERATION_ADD:
+						for (GGen_Index i = 0; i < block_length; i++) values[i] += operation.value;
+						break;
+					case GGEN_OPERATION_ADD_MAP: {
+						const GGen_Height* addend = operation.map->data + offset;
+						for (GGen_Index i = 0; i < block_length; i++) values[i] += addend[i];
+						break;
+					}
+					case GGEN_OPERATION_MULTIPLY:
+						for (GGen_Index i = 0; i < block_length; i++) values[i] = (GGen_Height) (GGen_ExtHeight) (operation.factor * (double) values[i]);
+						break;
+					case GGEN_OPERATION_INVERT:
+						for (GGen_Index i = 0; i < block_length; i++) values[i] = -values[i];
+						break;
+					case GGEN_OPERATION_ABS:
+						for (GGen_Index i = 0; i < block_length; i++) if (values[i] < 0) values[i] = -values[i];
+						break;
+					case GGEN_OPERATION_CLAMP:
+						for (GGen_Index i = 0; i < block_length; i++) values[i] = MIN(MAX(values[i], operation.min), operation.max);
+						break;
+					case GGEN_OPERATION_CROP_VALUES:
+						for (GGen_Index i = 0; i < block_length; i++) if (values[i] > operation.max || values[i] < operation.min) values[i] = 0;
+						break;
+					case GGEN_OPERATION_REPLACE_VALUE:
+						for (GGen_Index i = 0; i < block_length; i++) if (values[i] == operation.value) values[i] = operation.replacement;
+						break;
+					case GGEN_OPERATION_MONOCHROME:
+						for (GGen_Index i = 0; i < block_length; i++) values[i] = values[i] > operation.value ? 1 : 0;
+						break;
+					case GGEN_OPERATION_SELECT_VALUE:
+						for (GGen_Index i = 0; i < block_length; i++) values[i] = values[i] == operation.value ? 1 : 0;
+						break;
+					case GGEN_OPERATION_SCALE_VALUES:
+						for (GGen_Index i = 0; i < block_length; i++) {
+							values[i] = (GGen_Height) (operation.to_min + ((GGen_ExtHeight) values[i] - operation.from_min) * operation.to_range / operation.from_range);
+						}
+						break;
+				}
+			}
+
+			/* The block is still in the cache, so the statistics are almost free */
+			GGen_Height current_min = GGEN_MAX_HEIGHT;
+			GGen_Height current_max = GGEN_MIN_HEIGHT;
+
+			for (GGen_Index i = 0; i < block_length; i++) {
+				current_min = MIN(current_min, values[i]);
+				current_max = MAX(current_max, values[i]);
+			}
+
+			block_min[block] = current_min;
+			block_max[block] = current_max;
+		}
+	});
+
+	GGen_BufferPool::SetSequentialAccess(this->data, false);
+
+	for (size_t j = 0; j < count; j++) {
+		if (operations[j].type == GGEN_OPERATION_ADD_MAP) GGen_BufferPool::SetSequentialAccess(operations[j].map->data, false);
+	}
+
+	this->stats_min = GGEN_MAX_HEIGHT;
+	this->stats_max = GGEN_MIN_HEIGHT;
+
+	for (GGen_Index block = 0; block < num_blocks; block++) {
+		this->stats_min = MIN(this->stats_min, block_min[block]);
+		this->stats_max = MAX(this->stats_max, block_max[block]);
+	}
+
+	this->stats_valid = true;
+
+	delete [] block_min;
+	delete [] block_max;
+}
+
+#undef GGEN_OPERATION_BLOCK_SIZE
+
+void GGen_Data_2D::CountValues(GGen_Index* counts)
+{
+	this->FlushOperations();
+
+	/* Each block of the map is counted into its own histogram (so the threads never write into the same bins)... */
+	GGen_Index num_blocks = MIN((GGen_Index) GGen_ThreadPool::GetThreadCount(), (GGen_Index) this->height);
+	GGen_Index* block_counts = new GGen_Index[num_blocks * GGEN_HISTOGRAM_SIZE];
+
+	GGen_Script_Assert(block_counts != NULL);
+
+	memset(block_counts, 0, num_blocks * GGEN_HISTOGRAM_SIZE * sizeof(GGen_Index));
+
+	GGen_ParallelFor(0, num_blocks, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index block = from; block < to; block++) {
+			GGen_Index* histogram = block_counts + block * GGEN_HISTOGRAM_SIZE - GGEN_INVALID_HEIGHT;
+			GGen_Index last = (GGen_Index) ((uint64) this->length * (block + 1) / num_blocks);
+
+			for (GGen_Index i = (GGen_Index) ((uint64) this->length * block / num_blocks); i < last; i++) {
+				histogram[this->data[i]]++;
+			}
+		}
+	});
+
+	/* ... and the histograms are summed up afterwards */
+	GGen_ParallelFor(0, GGEN_HISTOGRAM_SIZE, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index bin = from; bin < to; bin++) {
+			GGen_Index count = 0;
+
+			for (GGen_Index block = 0; block < num_blocks; block++) {
+				count += block_counts[bin + block * GGEN_HISTOGRAM_SIZE];
+			}
+
+			counts[bin] = count;
+		}
+	});
+
+	delete [] block_counts;
+}
+
+GGen_Data_1D* GGen_Data_2D::Histogram(GGen_Height min, GGen_Height max, GGen_Size bin_count)
+{
+	GGen_Script_Assert(min <= max);
+	GGen_Script_Assert(bin_count > 0);
+
+	GGen_Index* counts = new GGen_Index[GGEN_HISTOGRAM_SIZE];
+
+	GGen_Script_Assert(counts != NULL);
+
+	this->CountValues(counts);
+
+	GGen_Data_1D* histogram = new GGen_Data_1D(bin_count, 0);
+
+	GGen_ExtHeight range = (GGen_ExtHeight) max - min + 1;
+
+	for (GGen_Size bin = 0; bin < bin_count; bin++) {
+		/* Values from the interval <first, last) belong to the bin */
+		GGen_ExtHeight first = min + (GGen_ExtHeight) (range * (GGen_ExtExtHeight) bin / bin_count);
+		GGen_ExtHeight last = min + (GGen_ExtHeight) (range * (GGen_ExtExtHeight) (bin + 1) / bin_count);
+
+		uint64 count = 0;
+
+		for (GGen_ExtHeight value = first; value < last; value++) {
+			count += counts[value - GGEN_INVALID_HEIGHT];
+		}
+
+		histogram->data[bin] = (GGen_Height) (count * GGEN_MAX_HEIGHT / this->length);
+	}
+
+	delete [] counts;
+
+	return histogram;
+}
+
+GGen_Height GGen_Data_2D::ValueAtRank(GGen_Index rank)
+{
+	GGen_Script_Assert(rank < this->length);
+
+	GGen_Index* counts = new GGen_Index[GGEN_HISTOGRAM_SIZE];
+
+	GGen_Script_Assert(counts != NULL);
+
+	this->CountValues(counts);
+
+	/* Find the first value whose cumulative count exceeds the rank */
+	GGen_Index below = 0;
+	GGen_Index bin = 0;
+
+	while (below + counts[bin] <= rank) {
+		below += counts[bin];
+		bin++;
+	}
+
+	delete [] counts;
+
+	return (GGen_Height) (bin + GGEN_INVALID_HEIGHT);
+}
+
+GGen_Height GGen_Data_2D::Percentile(double percentile)
+{
+	GGen_Script_Assert(percentile >= 0 && percentile <= 1);
+
+	return this->ValueAtRank((GGen_Index) (percentile * (this->length - 1) + 0.5));
+}
+
+void GGen_Data_2D::Clamp(GGen_Height min, GGen_Height max)
+{
+	GGen_Script_Assert(max > min);
+
+	GGen_Data_2D_Operation operation(GGEN_OPERATION_CLAMP);
+	operation.min = min;
+	operation.max = max;
+
+	this->ApplyOperation(operation);
+}
+
+void GGen_Data_2D::CropValues(GGen_Height min, GGen_Height max)
+{
+	GGen_Script_Assert(max > min);
+
+	GGen_Data_2D_Operation operation(GGEN_OPERATION_CROP_VALUES);
+	operation.min = min;
+	operation.max = max;
+
+	this->ApplyOperation(operation);
+}
+
+void GGen_Data_2D::Union(GGen_Data_2D* victim)
+{
+	GGen_Script_Assert(victim != NULL);
+
+	this->PrepareWrite();
+	victim->FlushOperations();
+
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			for (GGen_Coord x = 0; x < this->width; x++) {	
+				this->data[x + y * (GGen_Index) width] = MAX(this->data[x + y * (GGen_Index) this->width], victim->GetValueInterpolated(x, y, this->width, this->height));
+			}
+		}
+	});
+}
+
+void GGen_Data_2D::UnionTo(GGen_Data_2D* victim, GGen_CoordOffset offset_x, GGen_CoordOffset offset_y)
+{
+	GGen_Script_Assert(victim != NULL);
+	GGen_Script_Assert(offset_x > -(GGen_CoordOffset) this->width);
+	GGen_Script_Assert(offset_x < this->width);
+	GGen_Script_Assert(offset_y > -(GGen_CoordOffset) this->height);
+	GGen_Script_Assert(offset_y < this->height);
+
+	this->PrepareWrite();
+	victim->FlushOperations();
+
+	/* Walk through the items where the array and the victim with offset intersect */
+	for (GGen_Coord y = MAX(0, offset_y); y < MIN(this->height, offset_y + victim->height); y++) {
+		for (GGen_Coord x = MAX(0, offset_x); x < MIN(this->width, offset_x + victim->width); x++) {
+			this->data[x + y * (GGen_Index) width] = MAX(victim->data[(x - offset_x) + (y - offset_y) * victim->width], this->data[x + y * (GGen_Index) this->width]);
+		}
+	}
+}
+
+void GGen_Data_2D::Intersection(GGen_Data_2D* victim)
+{
+	GGen_Script_Assert(victim != NULL);
+
+	this->PrepareWrite();
+	victim->FlushOperations();
+
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			for(GGen_Coord x = 0; x < this->width; x++) {	
+				this->data[x + y * (GGen_Index) this->width] = MIN(this->data[x + y * (GGen_Index) this->width], victim->GetValueInterpolated(x, y, this->width, this->height));
+			}
+		}
+	});
+}
+
+void GGen_Data_2D::IntersectionTo(GGen_Data_2D* victim, GGen_CoordOffset offset_x, GGen_CoordOffset offset_y)
+{
+	GGen_Script_Assert(victim != NULL);
+	GGen_Script_Assert(offset_x > -(GGen_CoordOffset) this->width);
+	GGen_Script_Assert(offset_x < this->width);
+	GGen_Script_Assert(offset_y > -(GGen_CoordOffset) this->height);
+	GGen_Script_Assert(offset_y < this->height);
+
+	this->PrepareWrite();
+	victim->FlushOperations();
+
+	/* Walk through the items where the array and the addend with offset intersect */
+	for (GGen_Coord y = MAX(0, offset_y); y < MIN(this->height, offset_y + victim->height); y++) {
+		for (GGen_Coord x = MAX(0, offset_x); x < MIN(this->width, offset_x + victim->width); x++) {
+			this->data[x + y * (GGen_Index) width] = MIN(victim->data[(x - offset_x) + (y - offset_y) * victim->width], this->data[x + y * (GGen_Index) this->width]);
+		}
+	}
+}
+
+void GGen_Data_2D::Combine(GGen_Data_2D* victim, GGen_Data_2D* mask, bool relative)
+{
+	GGen_Script_Assert(victim != NULL);
+	GGen_Script_Assert(mask != NULL);
+
+	this->PrepareWrite();
+	victim->FlushOperations();
+	mask->FlushOperations();
+
+	GGen_Height max = GGEN_UNRELATIVE_CAP;
+
+	if(relative){
+		max = mask->Max();
+	}
+
+	if(max == 0) return;
+	
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			for (GGen_Coord x = 0; x < this->width; x++) {	
+				this->data[x + y * (GGen_Index) this->width] = 
+					(GGen_ExtHeight) this->data[x + y * (GGen_Index) this->width] * (GGen_ExtHeight) mask->GetValueInterpolated(x, y, this->width, this->height) / max + 
+					(GGen_ExtHeight) victim->GetValueInterpolated(x, y, this->width, this->height) * (GGen_ExtHeight) (max - mask->GetValueInterpolated(x, y, this->width, this->height))/ max;
+			}
+		}
+	});
+}
+
+// Calls body(index) for every tile selected (or not selected) in the mask. Words of 64 tiles nobody is interested in
+// are skipped at once.
+template <bool selected, class T>
+void Masked_ForEach(GGen_Data_2D* map, GGen_Mask_2D* mask, T body){
+	GGen_ParallelFor(0, map->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			const uint64* bits = mask->data + y * (GGen_Index) mask->row_words;
+			GGen_Index row_index = y * (GGen_Index) map->width;
+
+			for (GGen_Size i = 0; i < mask->row_words; i++) {
+				GGen_Coord x = i * 64;
+				uint64 word = selected ? bits[i] : ~bits[i];
+
+				/* Tiles past the right border are not selected, so they would appear in the inverse */
+				if (!selected && map->width - x < 64) word &= (1ULL << (map->width - x)) - 1;
+
+				for (GGen_Index index = row_index + x; word != 0; word >>= 1, index++) {
+					if (word & 1) body(index);
+				}
+			}
+		}
+	});
+}
+
+void GGen_Data_2D::FillWhere(GGen_Height value, GGen_Mask_2D* mask)
+{
+	GGen_Script_Assert(mask != NULL);
+	GGen_Script_Assert(mask->width == this->width && mask->height == this->height);
+
+	this->PrepareWrite();
+
+	Masked_ForEach<true>(this, mask, [&](GGen_Index i){
+		this->data[i] = value;
+	});
+}
+
+void GGen_Data_2D::AddWhere(GGen_Height value, GGen_Mask_2D* mask)
+{
+	GGen_Script_Assert(mask != NULL);
+	GGen_Script_Assert(mask->width == this->width && mask->height == this->height);
+
+	this->PrepareWrite();
+
+	Masked_ForEach<true>(this, mask, [&](GGen_Index i){
+		this->data[i] += value;
+	});
+}
+
+void GGen_Data_2D::AddMapWhere(GGen_Data_2D* addend, GGen_Mask_2D* mask)
+{
+	GGen_Script_Assert(addend != NULL);
+	GGen_Script_Assert(mask != NULL);
+	GGen_Script_Assert(addend->width == this->width && addend->height == this->height);
+	GGen_Script_Assert(mask->width == this->width && mask->height == this->height);
+
+	this->PrepareWrite();
+	addend->FlushOperations();
+
+	Masked_ForEach<true>(this, mask, [&](GGen_Index i){
+		this->data[i] += addend->data[i];
+	});
+}
+
+void GGen_Data_2D::CombineWhere(GGen_Data_2D* victim, GGen_Mask_2D* mask)
+{
+	GGen_Script_Assert(victim != NULL);
+	GGen_Script_Assert(mask != NULL);
+	GGen_Script_Assert(victim->width == this->width && victim->height == this->height);
+	GGen_Script_Assert(mask->width == this->width && mask->height == this->height);
+
+	this->PrepareWrite();
+	victim->FlushOperations();
+
+	/* Only the tiles which are not selected change */
+	Masked_ForEach<false>(this, mask, [&](GGen_Index i){
+		this->data[i] = victim->data[i];
+	});
+}
+
+void GGen_Data_2D::Evaluate(const GGen_String& expression, const vector<GGen_Data_2D*>& maps)
+{
+	GGen_Script_Assert(maps.size() <= 0xFFFF);
+
+	for (size_t i = 0; i < maps.size(); i++) {
+		GGen_Script_Assert(maps[i] != NULL);
+		GGen_Script_Assert(maps[i]->width == this->width && maps[i]->height == this->height);
+	}
+
+	/* Syntax errors are reported before anything is changed */
+	GGen_Expression compiled(expression, (uint16) maps.size(), this->width, this->height);
+
+	this->PrepareWrite();
+
+	for (size_t i = 0; i < maps.size(); i++) {
+		maps[i]->FlushOperations();
+	}
+
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		double* stack = new double[GGEN_EXPRESSION_BLOCK_SIZE * compiled.GetStackDepth()];
+		const GGen_Height** rows = new const GGen_Height*[maps.size() + 1];
+
+		GGen_Script_Assert(stack != NULL && rows != NULL);
+
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			/* Each tile depends only on the same tile of the maps, so the results can be written right into the row */
+			for (GGen_Index x = 0; x < this->width; x += GGEN_EXPRESSION_BLOCK_SIZE) {
+				uint16 count = (uint16) MIN(GGEN_EXPRESSION_BLOCK_SIZE, this->width - x);
+				GGen_Index offset = x + y * (GGen_Index) this->width;
+
+				for (size_t i = 0; i < maps.size(); i++) {
+					rows[i] = maps[i]->data + offset;
+				}
+
+				compiled.Evaluate((GGen_Coord) x, y, count, this->data + offset, rows, stack, this->data + offset);
 			}
 		}
+
+		delete [] stack;
+		delete [] rows;
+	});
+}
+
+void GGen_Data_2D::Abs()
+{
+	this->ApplyOperation(GGen_Data_2D_Operation(GGEN_OPERATION_ABS));
+}
+
+void GGen_Data_2D::Project(GGen_Data_1D* profile, GGen_Direction direction)
+{
+	GGen_Script_Assert(profile != NULL);
+
+	/* All values are overwritten, a shared array does not have to be copied */
+	this->PrepareReplace();
+	this->Unshare(false);
+
+	if (direction == GGEN_HORIZONTAL) {
+		GGen_CompiledProfile compiled_profile(profile, this->height);
+
+		GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+			for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+				for(GGen_Coord x = 0; x < this->width; x++) {		
+					this->data[x + y * (GGen_Index) this->width] = compiled_profile[y];
+				}
+			}
+		});
+	} else {
+		GGen_CompiledProfile compiled_profile(profile, this->width);
+
+		GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+			for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+				for (GGen_Coord x = 0; x < this->width; x++) {		
+					this->data[x + y * (GGen_Index) this->width] = compiled_profile[x];
+				}
+			}
+		});
 	}
 }
 
@@ -560,6 +1459,8 @@ GGen_Data_1D* GGen_Data_2D::GetProfile(GGen_Direction direction, GGen_Coord coor
 {
 	GGen_Script_Assert(direction == GGEN_VERTICAL || coordinate < this->width);
 	GGen_Script_Assert(direction == GGEN_HORIZONTAL || coordinate < this->height);
+
+	this->FlushOperations();
 	
 	GGen_Data_1D* output;
 	
@@ -567,13 +1468,13 @@ GGen_Data_1D* GGen_Data_2D::GetProfile(GGen_Direction direction, GGen_Coord coor
 		output = new GGen_Data_1D(this->width, 0);
 		
 		for  (GGen_Coord x = 0; x < this->width; x++) {		
-			output->data[x] = this->data[x + coordinate * this->width];
+			output->data[x] = this->data[x + coordinate * (GGen_Index) this->width];
 		}
 	} else {
 		output = new GGen_Data_1D(this->height, 0);
 	
 		for (GGen_Coord y = 0; y < this->height; y++) {
-			output->data[y] = this->data[coordinate + y * this->width];
+			output->data[y] = this->data[coordinate + y * (GGen_Index) this->width];
 		}
 	}
 	
@@ -584,53 +1485,63 @@ void GGen_Data_2D::Shift(GGen_Data_1D* profile, GGen_Direction direction, GGen_O
 {
 	GGen_Script_Assert(profile != NULL);
 
+	this->PrepareReplace();
+
 	/* Allocate the new array */
-	GGen_Height* new_data = new GGen_Height[this->length];
+	GGen_Height* new_data = GGen_BufferPool::Allocate(this->length);
 
 	GGen_Script_Assert(new_data != NULL);
 
+	/* The vacated tiles are not written by the loop below and the array might be reused */
+	if (mode == GGEN_DISCARD) {
+		memset(new_data, 0, sizeof(GGen_Height) * this->length);
+	}
+
+	/* Shift distance for every column (vertical direction) or row (horizontal direction) */
+	GGen_CompiledProfile distances(profile, direction == GGEN_VERTICAL ? this->width : this->height);
+
 	for (GGen_Coord y = 0; y < this->height; y++) {
 		for (GGen_Coord x = 0; x < this->width; x++) {		
 			if (direction == GGEN_VERTICAL) {
-				GGen_Height distance = profile->GetValueInterpolated(x, this->width);
+				GGen_Height distance = distances[x];
 
 				/* Some values can be just plainly shifted */
-				if ((distance >= 0 && y < this->height - distance) || (distance <= 0 && (signed) y >= -distance)) {
-					new_data[x + (y + distance) * this->width] = this->data[x + y * this->width];
+				if ((distance >= 0 && (GGen_CoordOffset) y < (GGen_CoordOffset) this->height - distance) || (distance <= 0 && (GGen_CoordOffset) y >= -distance)) {
+					new_data[x + (y + distance) * (GGen_Index) this->width] = this->data[x + y * (GGen_Index) this->width];
 				} else if(distance >= 0) {
 					/* Some must go through the upper "border" */
 					if (mode == GGEN_CYCLE) {
-						new_data[x + (y - this->height + distance) * this->width] = this->data[x + y * this->width];
+						new_data[x + (y - this->height + distance) * (GGen_Index) this->width] = this->data[x + y * (GGen_Index) this->width];
 					} else if (mode == GGEN_DISCARD_AND_FILL) {
-						new_data[x + (y - this->height + distance) * this->width] = this->data[x];
+						new_data[x + (y - this->height + distance) * (GGen_Index) this->width] = this->data[x];
 					}
 				} else {
 					/* And some must go through the bottom "border" */
 					if (mode == GGEN_CYCLE) {
-						new_data[x + (y + this->height + distance) * this->width] = this->data[x + y * this->width];
+						new_data[x + (y + this->height + distance) * (GGen_Index) this->width] = this->data[x + y * (GGen_Index) this->width];
 					} else if ( mode == GGEN_DISCARD_AND_FILL) {
-						new_data[x + (y + this->height + distance) * this->width] = this->data[x + (this->height - 1) * this->width];
+						new_data[x + (y + this->height + distance) * (GGen_Index) this->width] = this->data[x + (this->height - 1) * (GGen_Index) this->width];
 					}
 				}					
 			} else { /* GGEN_HORIZONTAL */
-				GGen_Height distance = profile->GetValueInterpolated(y, this->height);
+				GGen_Height distance = distances[y];
 
 				/* Some values can be just plainly shifted */
-				if ((distance >= 0 && x < this->width - distance) || (distance <= 0 && (signed) x >= -distance)) {
-					new_data[x + distance + y * this->width] = this->data[x + y * this->width];
+				if ((distance >= 0 && (GGen_CoordOffset) x < (GGen_CoordOffset) this->width - distance) || (distance <= 0 && (GGen_CoordOffset) x >= -distance)) {
+					new_data[x + distance + y * (GGen_Index) this->width] = this->data[x + y * (GGen_Index) this->width];
 				} else if (distance >= 0) {
 					/* Some must go through the right "border" */
 					if (mode == GGEN_CYCLE) {
-						new_data[x - this->width + distance + y * this->width] = this->data[x + y * this->width];
+						new_data[x - this->width + distance + y * (GGen_Index) this->width] = this->data[x + y * (GGen_Index) this->width];
 					} else if (mode == GGEN_DISCARD_AND_FILL) {
-						new_data[x - this->width + distance + y * this->width] = this->data[y * this->width];
+						new_data[x - this->width + distance + y * (GGen_Index) this->width] = this->data[y * (GGen_Index) this->width];
 					}
 				} else {
 					/* And some must go through the left "border" */
 					if (mode == GGEN_CYCLE) {
-						new_data[x + this->width + distance + y * this->width] = this->data[x + y * this->width];
+						new_data[x + this->width + distance + y * (GGen_Index) this->width] = this->data[x + y * (GGen_Index) this->width];
 					} else if (mode == GGEN_DISCARD_AND_FILL) {
-						new_data[x + this->width + distance + y * this->width] = this->data[this->width - 1 + y * this->width];
+						new_data[x + this->width + distance + y * (GGen_Index) this->width] = this->data[this->width - 1 + y * (GGen_Index) this->width];
 					}
 				}					
 			}
@@ -638,8 +1549,7 @@ void GGen_Data_2D::Shift(GGen_Data_1D* profile, GGen_Direction direction, GGen_O
 	}
 
 	/* Relink and delete the original array data */
-	delete [] this->data;
-	this->data = new_data;
+	this->ReplaceData(new_data);
 }
 
 void GGen_Data_2D::GradientFromProfile(GGen_Coord from_x, GGen_Coord from_y, GGen_Coord to_x, GGen_Coord to_y, GGen_Data_1D* pattern, bool fill_outside)
@@ -650,37 +1560,43 @@ void GGen_Data_2D::GradientFromProfile(GGen_Coord from_x, GGen_Coord from_y, GGe
 	GGen_Script_Assert(to_x < this->width);
 	GGen_Script_Assert(to_y < this->height);
 
-	GGen_ExtExtHeight target_x = to_x - from_x;
-	GGen_ExtExtHeight target_y = to_y - from_y;
+	this->PrepareWrite();
+
+	GGen_ExtExtHeight target_x = (GGen_ExtExtHeight) to_x - from_x;
+	GGen_ExtExtHeight target_y = (GGen_ExtExtHeight) to_y - from_y;
 	
 	/* Width of the gradient strip */
-	double max_dist = sqrt((double) (ABS(to_x - from_x) * ABS(to_x - from_x) + ABS(to_y - from_y) * ABS(to_y - from_y)));
+	double max_dist = sqrt((double) (target_x * target_x + target_y * target_y));
 
-	for (GGen_Coord y = 0; y < this->height; y++) {
-		for (GGen_Coord x = 0; x < this->width; x++) {
-			GGen_ExtExtHeight point_x = x - from_x;
-			GGen_ExtExtHeight point_y = y - from_y;
+	GGen_CompiledProfile compiled_pattern(pattern, (GGen_Size) max_dist + 1);
+
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			for (GGen_Coord x = 0; x < this->width; x++) {
+				GGen_ExtExtHeight point_x = (GGen_ExtExtHeight) x - from_x;
+				GGen_ExtExtHeight point_y = (GGen_ExtExtHeight) y - from_y;
 
-			/* Get the point on the gradient vector (vector going through both starting and target point) to which is the current point closest */
-			GGen_ExtExtHeight cross_x = (target_x * (target_x * point_x + target_y * point_y)) / (target_x * target_x + target_y * target_y);
-			GGen_ExtExtHeight cross_y = (target_y * (target_x * point_x + target_y * point_y)) / (target_x * target_x + target_y * target_y);		
+				/* Get the point on the gradient vector (vector going through both starting and target point) to which is the current point closest */
+				GGen_ExtExtHeight cross_x = (target_x * (target_x * point_x + target_y * point_y)) / (target_x * target_x + target_y * target_y);
+				GGen_ExtExtHeight cross_y = (target_y * (target_x * point_x + target_y * point_y)) / (target_x * target_x + target_y * target_y);		
 		
-			/* Calculate the distance from the "from" point to the intersection with gradient vector */
-			double distance = sqrt((double) (cross_x * cross_x + cross_y * cross_y));
+				/* Calculate the distance from the "from" point to the intersection with gradient vector */
+				double distance = sqrt((double) (cross_x * cross_x + cross_y * cross_y));
 			
-			/* Distance from  the intersection point to the target point */
-			double reverse_distance = sqrt((double) ( ABS(target_x - cross_x) * ABS(target_x - cross_x) + ABS(target_y - cross_y) * ABS(target_y - cross_y) ));
+				/* Distance from  the intersection point to the target point */
+				double reverse_distance = sqrt((double) ( ABS(target_x - cross_x) * ABS(target_x - cross_x) + ABS(target_y - cross_y) * ABS(target_y - cross_y) ));
 			
-			/* Apply it to the array data */
-			if(distance <= max_dist && reverse_distance <= max_dist) {
-				this->data[x + this->width * y] = pattern->GetValueInterpolated((GGen_Distance) distance, (GGen_Size) max_dist + 1);
-			} else if (fill_outside && reverse_distance < distance) {
-				this->data[x + this->width * y] = pattern->GetValue(pattern->length - 1);
-			} else if(fill_outside) {
-				this->data[x + this->width * y] = pattern->GetValue(0);
+				/* Apply it to the array data */
+				if(distance <= max_dist && reverse_distance <= max_dist) {
+					this->data[x + (GGen_Index) this->width * y] = compiled_pattern[(GGen_Coord) distance];
+				} else if (fill_outside && reverse_distance < distance) {
+					this->data[x + (GGen_Index) this->width * y] = pattern->GetValue(pattern->length - 1);
+				} else if(fill_outside) {
+					this->data[x + (GGen_Index) this->width * y] = pattern->GetValue(0);
+				}
 			}
 		}
-	}
+	});
 }
 
 void GGen_Data_2D::Gradient(GGen_Coord from_x, GGen_Coord from_y, GGen_Coord to_x, GGen_Coord to_y, GGen_Height from_value, GGen_Height to_value, bool fill_outside)
@@ -706,19 +1622,26 @@ void GGen_Data_2D::RadialGradientFromProfile(GGen_Coord center_x, GGen_Coord cen
 	GGen_Script_Assert(center_y < this->height);
 
 	GGen_Script_Assert(radius > 0);
+	GGen_Script_Assert(radius < GGEN_MAX_SIZE);
 	GGen_Script_Assert(pattern != NULL);
 
-	for (GGen_Coord y = 0; y < this->height; y++) {
-		for (GGen_Coord x = 0; x < this->width; x++) {
-			GGen_Distance distance = (GGen_Distance) sqrt((double) (ABS(x - center_x) * ABS(x - center_x) + ABS(y - center_y) * ABS(y - center_y)));
+	this->PrepareWrite();
+
+	GGen_CompiledProfile compiled_pattern(pattern, (GGen_Size) radius);
+
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			for (GGen_Coord x = 0; x < this->width; x++) {
+				GGen_Distance distance = (GGen_Distance) sqrt((double) (((GGen_CoordOffset) x - center_x) * ((GGen_CoordOffset) x - center_x) + ((GGen_CoordOffset) y - center_y) * ((GGen_CoordOffset) y - center_y)));
 		 
-			if (distance < radius) {
-				this->data[x + this->width * y] = pattern->GetValueInterpolated(distance, radius);
-			} else if (fill_outside) {
-				this->data[x + this->width * y] = pattern->GetValue(pattern->length - 1);
+				if (distance < radius) {
+					this->data[x + (GGen_Index) this->width * y] = compiled_pattern[(GGen_Coord) distance];
+				} else if (fill_outside) {
+					this->data[x + (GGen_Index) this->width * y] = pattern->GetValue(pattern->length - 1);
+				}
 			}
 		}
-	}
+	});
 }
 
 void GGen_Data_2D::RadialGradient(GGen_Coord center_x, GGen_Coord center_y, GGen_Coord radius, GGen_Height min, GGen_Height max, bool fill_outside)
@@ -728,30 +1651,35 @@ void GGen_Data_2D::RadialGradient(GGen_Coord center_x, GGen_Coord center_y, GGen
 
 	GGen_Script_Assert(radius > 0);	
 	
+	this->PrepareWrite();
+
 	GGen_ExtExtHeight rel_max = max - min;
 
-	for (GGen_Coord y = 0; y < this->height; y++) {
-		for (GGen_Coord x = 0; x < this->width; x++) {
-			GGen_Distance distance = (GGen_Distance) sqrt((double) (ABS(x - center_x) * ABS(x - center_x) + ABS(y - center_y) * ABS(y - center_y)));
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			for (GGen_Coord x = 0; x < this->width; x++) {
+				GGen_Distance distance = (GGen_Distance) sqrt((double) (((GGen_CoordOffset) x - center_x) * ((GGen_CoordOffset) x - center_x) + ((GGen_CoordOffset) y - center_y) * ((GGen_CoordOffset) y - center_y)));
 
-			if (distance < radius) {
-				this->data[x + this->width * y] = (GGen_Height) ((GGen_ExtExtHeight) min + rel_max * (GGen_ExtExtHeight) distance / (GGen_ExtExtHeight) radius);
-			} else if (fill_outside) {
-				this->data[x + this->width * y] = (GGen_Height) ((GGen_ExtHeight) min + rel_max);
+				if (distance < radius) {
+					this->data[x + (GGen_Index) this->width * y] = (GGen_Height) ((GGen_ExtExtHeight) min + rel_max * (GGen_ExtExtHeight) distance / (GGen_ExtExtHeight) radius);
+				} else if (fill_outside) {
+					this->data[x + (GGen_Index) this->width * y] = (GGen_Height) ((GGen_ExtHeight) min + rel_max);
+				}
 			}
 		}
-	}
+	});
 }
 
 // Returns value usable for interpolation from give coordinate. The coordinate might be outside the map.
-double Noise_GetGridPoint(GGen_Data_2D* map, GGen_CoordOffset x, GGen_CoordOffset y, GGen_Height* verticalOverflowBuffer, GGen_Height* horizontalOverflowBuffer){
+GGen_ExtHeight Noise_GetGridPoint(GGen_Data_2D* map, GGen_CoordOffset x, GGen_CoordOffset y, GGen_Height* verticalOverflowBuffer, GGen_Height* horizontalOverflowBuffer){
 	// The value is outside the right border of the map - mirror the coordinate, so a realistically behaving value is used.
 	if(x < 0){
 		x = -x;
 	}
 
-	// The value is outside the right border - use value from the overflow buffer.
-	else if(x >= map->width){
+	// The value is outside the right border (the mirrored coordinate might get there too on narrow maps) - use value
+	// from the overflow buffer.
+	if(x >= map->width){
 		return verticalOverflowBuffer[MAX(MIN(y, map->height), 0)];
 	}
 
@@ -761,43 +1689,55 @@ double Noise_GetGridPoint(GGen_Data_2D* map, GGen_CoordOffset x, GGen_CoordOffse
 	}
 	
 	// The value is outside the bottom border - use value from the overflow buffer.
-	else if(y >= map->height){
+	if(y >= map->height){
 		return horizontalOverflowBuffer[x];
 	}
 
 	// The point is within the map.
-	return map->data[x + map->width * y];
-}
-
-GGen_Height Noise_BicubicInterpolation(double p[4][4]){
-	// Prepare coefficients for the bicubic polynomial.
-	double a00 = p[1][1];
-	double a01 = -.5*p[1][0] + .5*p[1][2];
-	double a02 = p[1][0] - 2.5*p[1][1] + 2*p[1][2] - .5*p[1][3];
-	double a03 = -.5*p[1][0] + 1.5*p[1][1] - 1.5*p[1][2] + .5*p[1][3];
-	double a10 = -.5*p[0][1] + .5*p[2][1];
-	double a11 = .25*p[0][0] - .25*p[0][2] - .25*p[2][0] + .25*p[2][2];
-	double a12 = -.5*p[0][0] + 1.25*p[0][1] - p[0][2] + .25*p[0][3] + .5*p[2][0] - 1.25*p[2][1] + p[2][2] - .25*p[2][3];
-	double a13 = .25*p[0][0] - .75*p[0][1] + .75*p[0][2] - .25*p[0][3] - .25*p[2][0] + .75*p[2][1] - .75*p[2][2] + .25*p[2][3];
-	double a20 = p[0][1] - 2.5*p[1][1] + 2*p[2][1] - .5*p[3][1];
-	double a21 = -.5*p[0][0] + .5*p[0][2] + 1.25*p[1][0] - 1.25*p[1][2] - p[2][0] + p[2][2] + .25*p[3][0] - .25*p[3][2];
-	double a22 = p[0][0] - 2.5*p[0][1] + 2*p[0][2] - .5*p[0][3] - 2.5*p[1][0] + 6.25*p[1][1] - 5*p[1][2] + 1.25*p[1][3] + 2*p[2][0] - 5*p[2][1] + 4*p[2][2] - p[2][3] - .5*p[3][0] + 1.25*p[3][1] - p[3][2] + .25*p[3][3];
-	double a23 = -.5*p[0][0] + 1.5*p[0][1] - 1.5*p[0][2] + .5*p[0][3] + 1.25*p[1][0] - 3.75*p[1][1] + 3.75*p[1][2] - 1.25*p[1][3] - p[2][0] + 3*p[2][1] - 3*p[2][2] + p[2][3] + .25*p[3][0] - .75*p[3][1] + .75*p[3][2] - .25*p[3][3];
-	double a30 = -.5*p[0][1] + 1.5*p[1][1] - 1.5*p[2][1] + .5*p[3][1];
-	double a31 = .25*p[0][0] - .25*p[0][2] - .75*p[1][0] + .75*p[1][2] + .75*p[2][0] - .75*p[2][2] - .25*p[3][0] + .25*p[3][2];
-	double a32 = -.5*p[0][0] + 1.25*p[0][1] - p[0][2] + .25*p[0][3] + 1.5*p[1][0] - 3.75*p[1][1] + 3*p[1][2] - .75*p[1][3] - 1.5*p[2][0] + 3.75*p[2][1] - 3*p[2][2] + .75*p[2][3] + .5*p[3][0] - 1.25*p[3][1] + p[3][2] - .25*p[3][3];
-	double a33 = .25*p[0][0] - .75*p[0][1] + .75*p[0][2] - .25*p[0][3] - .75*p[1][0] + 2.25*p[1][1] - 2.25*p[1][2] + .75*p[1][3] + .75*p[2][0] - 2.25*p[2][1] + 2.25*p[2][2] - .75*p[2][3] - .25*p[3][0] + .75*p[3][1] - .75*p[3][2] + .25*p[3][3];
-
-	// Calculate value of the bicubic polynomial.
-	double value = (a00 + a01 * 0.5 + a02 * 0.5 * 0.5 + a03 * 0.5 * 0.5 * 0.5) +
-		(a10 + a11 * 0.5 + a12 * 0.5 * 0.5 + a13 * 0.5 * 0.5 * 0.5) * 0.5 +
-		(a20 + a21 * 0.5 + a22 * 0.5 * 0.5 + a23 * 0.5 * 0.5 * 0.5) * 0.5 * 0.5 +
-		(a30 + a31 * 0.5 + a32 * 0.5 * 0.5 + a33 * 0.5 * 0.5 * 0.5) * 0.5 * 0.5 * 0.5;
+	return map->data[x + (GGen_Index) map->width * y];
+}
+
+// Value of the Catmull-Rom spline going through 4 equidistant points in the middle between the two inner points. The
+// result is 16 times the actual value (the weights are -1/16, 9/16, 9/16 and -1/16), so it is exact in integers.
+inline GGen_ExtHeight Noise_CubicMidpoint(GGen_ExtHeight p0, GGen_ExtHeight p1, GGen_ExtHeight p2, GGen_ExtHeight p3){
+	return 9 * (p1 + p2) - p0 - p3;
+}
+
+// Noise_CubicMidpoint for whole arrays: output[i] = Noise_CubicMidpoint(p0[i], p1[i], p2[i], p3[i]).
+void Noise_CubicMidpoints(GGen_ExtHeight* output, const GGen_ExtHeight* p0, const GGen_ExtHeight* p1, const GGen_ExtHeight* p2, const GGen_ExtHeight* p3, GGen_Index count){
+	GGen_Index i = 0;
+
+#ifdef GGEN_SSE2
+	// 4 values at once, 9 * x is computed as (x << 3) + x.
+	for(; i + 4 <= count; i += 4){
+		__m128i inner = _mm_add_epi32(_mm_loadu_si128((const __m128i*) (p1 + i)), _mm_loadu_si128((const __m128i*) (p2 + i)));
+		__m128i outer = _mm_add_epi32(_mm_loadu_si128((const __m128i*) (p0 + i)), _mm_loadu_si128((const __m128i*) (p3 + i)));
+		__m128i value = _mm_sub_epi32(_mm_add_epi32(_mm_slli_epi32(inner, 3), inner), outer);
+		_mm_storeu_si128((__m128i*) (output + i), value);
+	}
+#endif
+
+	for(; i < count; i++){
+		output[i] = Noise_CubicMidpoint(p0[i], p1[i], p2[i], p3[i]);
+	}
+}
+
+// Value of the bicubic (Catmull-Rom) patch in the middle of the 4x4 point grid, 256 times the actual value.
+GGen_ExtHeight Noise_BicubicInterpolation(GGen_ExtHeight p[4][4]){
+	return Noise_CubicMidpoint(
+		Noise_CubicMidpoint(p[0][0], p[0][1], p[0][2], p[0][3]),
+		Noise_CubicMidpoint(p[1][0], p[1][1], p[1][2], p[1][3]),
+		Noise_CubicMidpoint(p[2][0], p[2][1], p[2][2], p[2][3]),
+		Noise_CubicMidpoint(p[3][0], p[3][1], p[3][2], p[3][3])
+	);
+}
 
+// Converts result of Noise_BicubicInterpolation back to the height scale (rounding towards zero).
+GGen_Height Noise_FinishInterpolation(GGen_ExtHeight value){
 	// Check for overflows.
-	GGen_Script_Assert(value >= GGEN_MIN_HEIGHT && value <= GGEN_MAX_HEIGHT);
+	GGen_Script_Assert(value >= GGEN_MIN_HEIGHT * 256 && value <= GGEN_MAX_HEIGHT * 256);
 
-	return (GGen_Height) value;
+	return (GGen_Height) (value / 256);
 }
 
 void GGen_Data_2D::Noise(GGen_Size minFeatureSize, GGen_Size maxFeatureSize, GGen_Amplitudes* amplitudes)
@@ -815,6 +1755,11 @@ void GGen_Data_2D::Noise(GGen_Size minFeatureSize, GGen_Size maxFeatureSize, GGe
 	// Reset the map array, it will be filled with completely new values.
 	this->Fill(0);	
 
+	this->PrepareWrite();
+
+	/* Each grid point is generated exactly once, so its random offset can be keyed just by its coordinates. */
+	GGen_RandomStream random = GGen_RandomStream::ForOperation();
+
 	/* The diamond-square algorithm by definition works on square maps only with side length equal to power  
 	 * of two plus one. But only two rows/columns of points are enough to interpolate the points near the right 
 	 * and bottom borders (top and bottom borders are aligned with the grid, so they can be interpolated in much
@@ -824,208 +1769,523 @@ void GGen_Data_2D::Noise(GGen_Size minFeatureSize, GGen_Size maxFeatureSize, GGe
 	 * point in the vertical buffer. */	
 	GGen_Height* verticalOverflowBuffer = new GGen_Height[this->height + 1];
 	GGen_Height* horizontalOverflowBuffer = new GGen_Height[this->width];
+	GGen_Height* nextVerticalOverflowBuffer = new GGen_Height[this->height + 1];
+	GGen_Height* nextHorizontalOverflowBuffer = new GGen_Height[this->width];
 
 	// The supplied wave length is likely not a power of two. Convert the number to the nearest lesser power of two.
 	unsigned waveLengthLog2 = (unsigned) GGen_log2(maxFeatureSize);
 	GGen_Size waveLength = 1 << waveLengthLog2;
 	GGen_Height amplitude = amplitudes->data[waveLengthLog2];
 
-	// Generate the initial seed values (square corners).
-	for(GGen_Coord y = 0; ; y += waveLength){
-		if(y < this->height){
-			for(GGen_Coord x = 0; ; x += waveLength){
-				if(x < this->width){
-					this->data[x + this->width * y] = GGen_Random<GGen_Height>(-amplitude, amplitude);
-				}
-				else{
-					verticalOverflowBuffer[y] = GGen_Random<GGen_Height>(-amplitude, amplitude);
-					break;
-				}
+	// Generate the initial seed values (square corners).
+	for(GGen_Coord y = 0; ; y += waveLength){
+		if(y < this->height){
+			for(GGen_Coord x = 0; ; x += waveLength){
+				if(x < this->width){
+					this->data[x + (GGen_Index) this->width * y] = random.At<GGen_Height>(-amplitude, amplitude, x, y);
+				}
+				else{
+					verticalOverflowBuffer[y] = random.At<GGen_Height>(-amplitude, amplitude, x, y);
+					break;
+				}
+			}
+		}
+		else {
+			for(GGen_Coord x = 0; ; x += waveLength){
+				if(x < this->width){
+					horizontalOverflowBuffer[x] = random.At<GGen_Height>(-amplitude, amplitude, x, y);
+				}
+				else{
+					verticalOverflowBuffer[this->height] = random.At<GGen_Height>(-amplitude, amplitude, x, y);
+					break;
+				}
+			}
+			break;
+		}
+	}
+
+	amplitude = amplitudes->data[waveLengthLog2 - 1];
+
+	// Keep interpolating until there are uninterpolated tiles..
+	while(waveLength > 1){
+		GGen_Size halfWaveLength = waveLength / 2;
+
+		// The grid points sampled by one interpolated point lie up to 3 half wave lengths away from it. Points at least
+		// this far from all borders (the interior) can read the map directly, without any mirroring or overflow buffers.
+		GGen_Size reach = 3 * halfWaveLength;
+
+		// The square step - put a randomly generated point into center of each square. The points of one step depend only
+		// on points of the previous steps, so the rows are computed in parallel. The overflow buffers are double buffered
+		// for the same reason: the step reads the values from previous steps and writes the new ones into the second copy.
+		memcpy(nextVerticalOverflowBuffer, verticalOverflowBuffer, sizeof(GGen_Height) * (this->height + 1));
+		memcpy(nextHorizontalOverflowBuffer, horizontalOverflowBuffer, sizeof(GGen_Height) * this->width);
+
+		// Rows up to the first one below the bottom border (which goes into the horizontal overflow buffer).
+		GGen_Index numSquareRows = (this->height - halfWaveLength + waveLength - 1) / waveLength + 1;
+
+		// Square corners (points from the previous steps) lying in one row inside the map.
+		GGen_Index numCornerColumns = (this->width - 1) / waveLength + 1;
+
+		GGen_ParallelFor(0, numSquareRows, [&](GGen_Index from, GGen_Index to){
+			/* The bicubic interpolation is separable: the interior points first interpolate each of the 4 corner rows
+			 * horizontally and then combine the 4 results vertically. Each corner row is shared by 4 rows of square
+			 * centers, so the horizontal results of last 4 corner rows are kept in a ring (the rows are processed top
+			 * to bottom) and every corner row is read just once per chunk. */
+			GGen_ExtHeight* corners = new GGen_ExtHeight[numCornerColumns];
+			GGen_ExtHeight* horizontal[4];
+			GGen_CoordOffset horizontalRow[4] = {-1, -1, -1, -1};
+
+			for(int i = 0; i < 4; i++){
+				horizontal[i] = new GGen_ExtHeight[numCornerColumns];
+			}
+
+			for(GGen_Index row = from; row < to; row++){
+				GGen_Coord y = (GGen_Coord) (halfWaveLength + row * waveLength);
+
+				bool interiorRow = y >= reach && y + reach < this->height;
+
+				if(interiorRow){
+					// Corner rows y - 3/2 wave length ... y + 3/2 wave length are corner rows number row - 1 ... row + 2.
+					for(GGen_CoordOffset cornerRow = (GGen_CoordOffset) row - 1; cornerRow <= (GGen_CoordOffset) row + 2; cornerRow++){
+						if(horizontalRow[cornerRow % 4] == cornerRow) continue;
+
+						GGen_Height* source = this->data + cornerRow * waveLength * (GGen_Index) this->width;
+						for(GGen_Index i = 0; i < numCornerColumns; i++){
+							corners[i] = source[i * waveLength];
+						}
+
+						// The center between corner columns i and i + 1 is interpolated from corners i - 1 ... i + 2.
+						if(numCornerColumns > 3){
+							Noise_CubicMidpoints(horizontal[cornerRow % 4] + 1, corners, corners + 1, corners + 2, corners + 3, numCornerColumns - 3);
+						}
+
+						horizontalRow[cornerRow % 4] = cornerRow;
+					}
+				}
+
+				GGen_ExtHeight* h0 = horizontal[(row + 3) % 4];
+				GGen_ExtHeight* h1 = horizontal[row % 4];
+				GGen_ExtHeight* h2 = horizontal[(row + 1) % 4];
+				GGen_ExtHeight* h3 = horizontal[(row + 2) % 4];
+
+				GGen_Index column = 0;
+				for(GGen_Coord x = halfWaveLength; ; x += waveLength, column++){
+					GGen_ExtHeight interpolated;
+
+					if(interiorRow && x >= reach && x + reach < this->width){
+						interpolated = Noise_CubicMidpoint(h0[column], h1[column], h2[column], h3[column]);
+					}
+					else{
+						// Prepare the 4x4 value matrix for bicubic interpolation.
+						GGen_CoordOffset x0 = (GGen_CoordOffset) x - halfWaveLength - waveLength;
+						GGen_CoordOffset x1 = (GGen_CoordOffset) x - halfWaveLength;
+						GGen_CoordOffset x2 = (GGen_CoordOffset) x + halfWaveLength;
+						GGen_CoordOffset x3 = (GGen_CoordOffset) x + halfWaveLength + waveLength;
+
+						GGen_CoordOffset y0 = (GGen_CoordOffset) y - halfWaveLength - waveLength;
+						GGen_CoordOffset y1 = (GGen_CoordOffset) y - halfWaveLength;
+						GGen_CoordOffset y2 = (GGen_CoordOffset) y + halfWaveLength;
+						GGen_CoordOffset y3 = (GGen_CoordOffset) y + halfWaveLength + waveLength;
+
+						GGen_ExtHeight data[4][4] = {
+							{
+								Noise_GetGridPoint(this, x0, y0, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x1, y0, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x2, y0, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x3, y0, verticalOverflowBuffer, horizontalOverflowBuffer),
+							},
+							{
+								Noise_GetGridPoint(this, x0, y1, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x1, y1, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x2, y1, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x3, y1, verticalOverflowBuffer, horizontalOverflowBuffer),
+							},
+							{
+								Noise_GetGridPoint(this,x0, y2, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x1, y2, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x2, y2, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x3, y2, verticalOverflowBuffer, horizontalOverflowBuffer),
+							},
+							{
+								Noise_GetGridPoint(this, x0, y3, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x1, y3, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x2, y3, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x3, y3, verticalOverflowBuffer, horizontalOverflowBuffer),
+							},
+						};
+
+						interpolated = Noise_BicubicInterpolation(data);
+					}
+
+					// Interpolate!
+					GGen_Height interpolatedHeight = Noise_FinishInterpolation(interpolated) + (waveLength < minFeatureSize ? 0 : random.At<GGen_ExtHeight>(-amplitude, amplitude, x, y));
+
+					// Place the value into one of the overflow buffers, if it is outside the map.
+					if(x >= this->width){
+						nextVerticalOverflowBuffer[MIN(y, this->height)] = interpolatedHeight;
+						break;
+					}
+					else if(y >= this->height) {
+						nextHorizontalOverflowBuffer[x] = interpolatedHeight;
+					}
+					else{
+						this->data[x + (GGen_Index) this->width * y] = interpolatedHeight;
+					}
+				}
+			}
+
+			for(int i = 0; i < 4; i++){
+				delete [] horizontal[i];
+			}
+
+			delete [] corners;
+		});
+
+		swap(verticalOverflowBuffer, nextVerticalOverflowBuffer);
+		swap(horizontalOverflowBuffer, nextHorizontalOverflowBuffer);
+
+		// The diamond step - add point into middle of each diamond so each square from the square step is composed of 4 smaller squares.
+		memcpy(nextVerticalOverflowBuffer, verticalOverflowBuffer, sizeof(GGen_Height) * (this->height + 1));
+		memcpy(nextHorizontalOverflowBuffer, horizontalOverflowBuffer, sizeof(GGen_Height) * this->width);
+
+		GGen_Index numDiamondRows = (this->height + halfWaveLength - 1) / halfWaveLength + 1;
+
+		// Offsets of the 4x4 grid (rotated by 45 degrees) from the interpolated point in the data array. Point [i][j]
+		// lies (i + j - 3) half wave lengths to the right and (j - i) half wave lengths to the bottom.
+		GGen_CoordOffset offsets[4][4];
+		for(int i = 0; i < 4; i++){
+			for(int j = 0; j < 4; j++){
+				offsets[i][j] = (i + j - 3) * (GGen_CoordOffset) halfWaveLength + (j - i) * (GGen_CoordOffset) halfWaveLength * this->width;
+			}
+		}
+
+		GGen_ParallelFor(0, numDiamondRows, [&](GGen_Index from, GGen_Index to){
+			for(GGen_Index row = from; row < to; row++){
+				GGen_Coord y = (GGen_Coord) (row * halfWaveLength);
+
+				// The X coordinates are shifted by waveLength/2 in even rows.
+				bool evenRow = row % 2 == 0;
+
+				bool interiorRow = y >= reach && y + reach < this->height;
+
+				for(GGen_Coord x = evenRow ? halfWaveLength : 0; ; x += waveLength){							
+					GGen_ExtHeight interpolated;
+
+					if(interiorRow && x >= reach && x + reach < this->width){
+						const GGen_Height* center = this->data + x + (GGen_Index) this->width * y;
+
+						interpolated = Noise_CubicMidpoint(
+							Noise_CubicMidpoint(center[offsets[0][0]], center[offsets[0][1]], center[offsets[0][2]], center[offsets[0][3]]),
+							Noise_CubicMidpoint(center[offsets[1][0]], center[offsets[1][1]], center[offsets[1][2]], center[offsets[1][3]]),
+							Noise_CubicMidpoint(center[offsets[2][0]], center[offsets[2][1]], center[offsets[2][2]], center[offsets[2][3]]),
+							Noise_CubicMidpoint(center[offsets[3][0]], center[offsets[3][1]], center[offsets[3][2]], center[offsets[3][3]])
+						);
+					}
+					else{
+						// Prepare the 4x4 value matrix for bicubic interpolation (this time rotated by 45 degrees).
+						GGen_CoordOffset x0 = (GGen_CoordOffset) x - halfWaveLength - waveLength;
+						GGen_CoordOffset x1 = (GGen_CoordOffset) x - waveLength;
+						GGen_CoordOffset x2 = (GGen_CoordOffset) x - halfWaveLength;
+						GGen_CoordOffset x3 = x;
+						GGen_CoordOffset x4 = (GGen_CoordOffset) x + halfWaveLength;
+						GGen_CoordOffset x5 = (GGen_CoordOffset) x + waveLength;
+						GGen_CoordOffset x6 = (GGen_CoordOffset) x + halfWaveLength + waveLength;
+
+						GGen_CoordOffset y0 = (GGen_CoordOffset) y - halfWaveLength - waveLength;
+						GGen_CoordOffset y1 = (GGen_CoordOffset) y - waveLength;
+						GGen_CoordOffset y2 = (GGen_CoordOffset) y - halfWaveLength;
+						GGen_CoordOffset y3 = y;
+						GGen_CoordOffset y4 = (GGen_CoordOffset) y + halfWaveLength;
+						GGen_CoordOffset y5 = (GGen_CoordOffset) y + waveLength;
+						GGen_CoordOffset y6 = (GGen_CoordOffset) y + halfWaveLength + waveLength;
+
+						GGen_ExtHeight data[4][4] = {
+							{
+								Noise_GetGridPoint(this, x0, y3, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this,x1, y4, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x2, y5, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x3, y6, verticalOverflowBuffer, horizontalOverflowBuffer),
+							},
+							{
+								Noise_GetGridPoint(this, x1, y2, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x2, y3, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x3, y4, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x4, y5, verticalOverflowBuffer, horizontalOverflowBuffer),
+							},
+							{
+								Noise_GetGridPoint(this, x2, y1, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x3, y2, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x4, y3, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x5, y4, verticalOverflowBuffer, horizontalOverflowBuffer),
+							},
+							{
+								Noise_GetGridPoint(this, x3, y0, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x4, y1, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x5, y2, verticalOverflowBuffer, horizontalOverflowBuffer),
+								Noise_GetGridPoint(this, x6, y3, verticalOverflowBuffer, horizontalOverflowBuffer),
+							},
+						};
+
+						interpolated = Noise_BicubicInterpolation(data);
+					}
+
+					// Interpolate!
+					GGen_Height interpolatedHeight = Noise_FinishInterpolation(interpolated) + (waveLength < minFeatureSize ? 0 : random.At<GGen_ExtHeight>(-amplitude, amplitude, x, y));
+
+					// Place the value into one of the overflow buffers, if it is outside the map.
+					if(x >= this->width){
+						nextVerticalOverflowBuffer[MIN(y, this->height)] = interpolatedHeight;
+						break;
+					}
+					else if(y >= this->height) {
+						nextHorizontalOverflowBuffer[x] = interpolatedHeight;
+					}
+					else{
+						this->data[x + (GGen_Index) this->width * y] = interpolatedHeight;
+					}
+				}
+			}
+		});
+
+		swap(verticalOverflowBuffer, nextVerticalOverflowBuffer);
+		swap(horizontalOverflowBuffer, nextHorizontalOverflowBuffer);
+
+		// Decrease the wave length and amplitude.
+		waveLength /= 2;
+		if(waveLength > 1){						
+			amplitude = amplitudes->data[GGen_log2(waveLength / 2)];
+		}
+	}
+
+	delete [] verticalOverflowBuffer;
+	delete [] horizontalOverflowBuffer;
+	delete [] nextVerticalOverflowBuffer;
+	delete [] nextHorizontalOverflowBuffer;
+
+	return;
+} 
+
+// Division rounding towards negative infinity (so the lattice cells are the same size on both sides of zero).
+inline GGen_CoordOffset NoiseWindow_FloorDiv(GGen_CoordOffset value, GGen_CoordOffset divisor){
+	return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+// Weights of 4 consecutive lattice points for Catmull-Rom spline interpolation at relative position t between the 2 inner points.
+void NoiseWindow_Weights(double t, double weights[4]){
+	double t2 = t * t;
+	double t3 = t2 * t;
+
+	weights[0] = 0.5 * (-t3 + 2 * t2 - t);
+	weights[1] = 0.5 * (3 * t3 - 5 * t2 + 2);
+	weights[2] = 0.5 * (-3 * t3 + 4 * t2 + t);
+	weights[3] = 0.5 * (t3 - t2);
+}
+
+void GGen_Data_2D::NoiseWindow(GGen_CoordOffset offset_x, GGen_CoordOffset offset_y, GGen_Size min_feature_size, GGen_Size max_feature_size, GGen_Amplitudes* amplitudes)
+{
+	GGen_Script_Assert(amplitudes != NULL);
+	GGen_Script_Assert(min_feature_size > 0);
+	GGen_Script_Assert(max_feature_size >= min_feature_size);
+	GGen_Script_Assert((GGen_Size) GGen_log2(max_feature_size) < amplitudes->length);
+
+	/* All values are overwritten, a shared array does not have to be copied */
+	this->PrepareReplace();
+	this->Unshare(false);
+
+	/* The noise is a sum of octaves of value noise. Each octave places random values into lattice points spaced by its
+	 * wave length and interpolates them with Catmull-Rom splines. The random values are keyed by world coordinates of
+	 * the lattice points and each cell is computed from its world coordinates only (in the same order of operations),
+	 * so the map doesn't depend on where the window starts. */
+	GGen_RandomStream random = GGen_RandomStream::ForSeed();
+
+	double* sum = new double[this->length];
+
+	GGen_Script_Assert(sum != NULL);
+
+	for (GGen_Index i = 0; i < this->length; i++) {
+		sum[i] = 0;
+	}
+
+	for (int octave = GGen_log2(max_feature_size); octave >= GGen_log2(min_feature_size); octave--) {
+		GGen_CoordOffset waveLength = 1 << octave;
+		GGen_Height amplitude = amplitudes->data[octave];
+
+		if (amplitude == 0) continue;
+
+		/* Lattice points needed by the window (each cell needs one point before and two points after its cell) */
+		GGen_CoordOffset first_x = NoiseWindow_FloorDiv(offset_x, waveLength) - 1;
+		GGen_CoordOffset first_y = NoiseWindow_FloorDiv(offset_y, waveLength) - 1;
+		GGen_Index lattice_width = NoiseWindow_FloorDiv(offset_x + this->width - 1, waveLength) + 2 - first_x + 1;
+		GGen_Index lattice_height = NoiseWindow_FloorDiv(offset_y + this->height - 1, waveLength) + 2 - first_y + 1;
+
+		GGen_Height* lattice = new GGen_Height[lattice_width * lattice_height];
+		double* horizontal = new double[lattice_height * (GGen_Index) this->width];
+		GGen_Index* column_base = new GGen_Index[this->width];
+		double (*column_weights)[4] = new double[this->width][4];
+
+		GGen_Script_Assert(lattice != NULL && horizontal != NULL && column_base != NULL && column_weights != NULL);
+
+		for (GGen_Index y = 0; y < lattice_height; y++) {
+			for (GGen_Index x = 0; x < lattice_width; x++) {
+				lattice[x + y * lattice_width] = random.At<GGen_Height>(-amplitude, amplitude, (uint64) (int64) (first_x + (GGen_CoordOffset) x), (uint64) (int64) (first_y + (GGen_CoordOffset) y), octave);
 			}
 		}
-		else {
-			for(GGen_Coord x = 0; ; x += waveLength){
-				if(x < this->width){
-					horizontalOverflowBuffer[x] = GGen_Random<GGen_Height>(-amplitude, amplitude);
-				}
-				else{
-					verticalOverflowBuffer[this->height] = GGen_Random<GGen_Height>(-amplitude, amplitude);
-					break;
-				}
-			}
-			break;
+
+		for (GGen_Coord x = 0; x < this->width; x++) {
+			GGen_CoordOffset world_x = offset_x + x;
+			GGen_CoordOffset cell_x = NoiseWindow_FloorDiv(world_x, waveLength);
+
+			column_base[x] = cell_x - 1 - first_x;
+			NoiseWindow_Weights((double) (world_x - cell_x * waveLength) / (double) waveLength, column_weights[x]);
 		}
-	}
 
-	amplitude = amplitudes->data[waveLengthLog2 - 1];
+		/* Interpolate all lattice rows horizontally... */
+		GGen_ParallelFor(0, lattice_height, [&](GGen_Index from, GGen_Index to){
+			for (GGen_Index y = from; y < to; y++) {
+				GGen_Height* lattice_row = lattice + y * lattice_width;
 
-	// Keep interpolating until there are uninterpolated tiles..
-	while(waveLength > 1){
-		GGen_Size halfWaveLength = waveLength / 2;
+				for (GGen_Coord x = 0; x < this->width; x++) {
+					GGen_Height* points = lattice_row + column_base[x];
 
-		// The square step - put a randomly generated point into center of each square.
-		bool breakY = false;
-		for(GGen_Coord y = halfWaveLength; breakY == false; y += waveLength){			
-			for(GGen_Coord x = halfWaveLength; ; x += waveLength){
-				// Prepare the 4x4 value matrix for bicubic interpolation.
-				GGen_CoordOffset x0 = (int) x - (int) halfWaveLength - (int) waveLength;
-				GGen_CoordOffset x1 = (int) x - (int) halfWaveLength;
-				GGen_CoordOffset x2 = (int) x + (int) halfWaveLength;
-				GGen_CoordOffset x3 = (int) x + (int) halfWaveLength + (int) waveLength;
-
-				GGen_CoordOffset y0 = (int) y - (int) halfWaveLength - (int) waveLength;
-				GGen_CoordOffset y1 = (int) y - (int) halfWaveLength;
-				GGen_CoordOffset y2 = (int) y + (int) halfWaveLength;
-				GGen_CoordOffset y3 = (int) y + (int) halfWaveLength + (int) waveLength;
-
-				double data[4][4] = {
-					{
-						Noise_GetGridPoint(this, x0, y0, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x1, y0, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x2, y0, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x3, y0, verticalOverflowBuffer, horizontalOverflowBuffer),
-					},
-					{
-						Noise_GetGridPoint(this, x0, y1, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x1, y1, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x2, y1, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x3, y1, verticalOverflowBuffer, horizontalOverflowBuffer),
-					},
-					{
-						Noise_GetGridPoint(this,x0, y2, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x1, y2, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x2, y2, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x3, y2, verticalOverflowBuffer, horizontalOverflowBuffer),
-					},
-					{
-						Noise_GetGridPoint(this, x0, y3, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x1, y3, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x2, y3, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x3, y3, verticalOverflowBuffer, horizontalOverflowBuffer),
-					},
-				};
-
-				// Interpolate!
-				GGen_Height interpolatedHeight = Noise_BicubicInterpolation(data) + (waveLength < minFeatureSize ? 0 : GGen_Random<GGen_ExtHeight>(-amplitude, amplitude));
-
-				// Place the value into one of the overflow buffers, if it is outside the map.
-				if(x >= this->width){
-					verticalOverflowBuffer[MIN(y, this->height)] = interpolatedHeight;
-					break;
-				}
-				else if(y >= this->height) {
-					horizontalOverflowBuffer[x] = interpolatedHeight;
-					breakY = true;
-				}
-				else{
-					this->data[x + this->width * y] = interpolatedHeight;
+					horizontal[x + y * (GGen_Index) this->width] = 
+						column_weights[x][0] * points[0] + column_weights[x][1] * points[1] +
+						column_weights[x][2] * points[2] + column_weights[x][3] * points[3];
 				}
 			}
-		}
+		});
 
-		// The diamond step - add point into middle of each diamond so each square from the square step is composed of 4 smaller squares.
-		breakY = false;
-		bool evenRow = true;
-		for(GGen_Coord y = 0; breakY == false; y += halfWaveLength){			
-			for(GGen_Coord x = evenRow ? halfWaveLength : 0; ; x += waveLength){							
-				// Prepare the 4x4 value matrix for bicubic interpolation (this time rotated by 45 degrees).
-				GGen_CoordOffset x0 = (int) x - (int) halfWaveLength - (int) waveLength;
-				GGen_CoordOffset x1 = (int) x - (int) waveLength;
-				GGen_CoordOffset x2 = (int) x - (int) halfWaveLength;
-				GGen_CoordOffset x3 = (int) x;
-				GGen_CoordOffset x4 = (int) x + (int) halfWaveLength;
-				GGen_CoordOffset x5 = (int) x + (int) waveLength;
-				GGen_CoordOffset x6 = (int) x + (int) halfWaveLength + (int) waveLength;
-
-				GGen_CoordOffset y0 = (int) y - (int) halfWaveLength - (int) waveLength;
-				GGen_CoordOffset y1 = (int) y - (int) waveLength;
-				GGen_CoordOffset y2 = (int) y - (int) halfWaveLength;
-				GGen_CoordOffset y3 = (int) y;
-				GGen_CoordOffset y4 = (int) y + (int) halfWaveLength;
-				GGen_CoordOffset y5 = (int) y + (int) waveLength;
-				GGen_CoordOffset y6 = (int) y + (int) halfWaveLength + (int) waveLength;
-
-				double data[4][4] = {
-					{
-						Noise_GetGridPoint(this, x0, y3, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this,x1, y4, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x2, y5, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x3, y6, verticalOverflowBuffer, horizontalOverflowBuffer),
-					},
-					{
-						Noise_GetGridPoint(this, x1, y2, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x2, y3, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x3, y4, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x4, y5, verticalOverflowBuffer, horizontalOverflowBuffer),
-					},
-					{
-						Noise_GetGridPoint(this, x2, y1, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x3, y2, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x4, y3, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x5, y4, verticalOverflowBuffer, horizontalOverflowBuffer),
-					},
-					{
-						Noise_GetGridPoint(this, x3, y0, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x4, y1, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x5, y2, verticalOverflowBuffer, horizontalOverflowBuffer),
-						Noise_GetGridPoint(this, x6, y3, verticalOverflowBuffer, horizontalOverflowBuffer),
-					},
-				};
-
-				// Interpolate!
-				GGen_Height interpolatedHeight = Noise_BicubicInterpolation(data) + (waveLength < minFeatureSize ? 0 : GGen_Random<GGen_ExtHeight>(-amplitude, amplitude));
-
-				// Place the value into one of the overflow buffers, if it is outside the map.
-				if(x >= this->width){
-					verticalOverflowBuffer[MIN(y, this->height)] = interpolatedHeight;
-					break;
-				}
-				else if(y >= this->height) {
-					horizontalOverflowBuffer[x] = interpolatedHeight;
-					breakY = true;
-				}
-				else{
-					this->data[x + this->width * y] = interpolatedHeight;
+		/* ... and then the results vertically. */
+		GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+			for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+				GGen_CoordOffset world_y = offset_y + y;
+				GGen_CoordOffset cell_y = NoiseWindow_FloorDiv(world_y, waveLength);
+
+				double weights[4];
+				NoiseWindow_Weights((double) (world_y - cell_y * waveLength) / (double) waveLength, weights);
+
+				double* rows = horizontal + (cell_y - 1 - first_y) * (GGen_Index) this->width;
+
+				for (GGen_Coord x = 0; x < this->width; x++) {
+					sum[x + y * (GGen_Index) this->width] += 
+						weights[0] * rows[x] + weights[1] * rows[x + this->width] +
+						weights[2] * rows[x + 2 * (GGen_Index) this->width] + weights[3] * rows[x + 3 * (GGen_Index) this->width];
 				}
 			}
+		});
+
+		delete [] lattice;
+		delete [] horizontal;
+		delete [] column_base;
+		delete [] column_weights;
+	}
 
-			// The X coordinates are shifted by waveLength/2 in even rows.
-			evenRow = !evenRow;
+	/* The splines slightly overshoot the lattice values, so the sum might not fit into the height range */
+	GGen_ParallelFor(0, this->length, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			this->data[i] = (GGen_Height) MAX(MIN(sum[i], (double) GGEN_MAX_HEIGHT), (double) GGEN_MIN_HEIGHT);
 		}
+	});
 
-		// Decrease the wave length and amplitude.
-		waveLength /= 2;
-		if(waveLength > 1){						
-			amplitude = amplitudes->data[GGen_log2(waveLength / 2)];
+	delete [] sum;
+}
+
+// Point of the voronoi diagram.
+struct VoronoiNoise_Point{
+	GGen_Coord x, y;
+
+	// Value filled into the point's cell in GGEN_CELL_ID mode.
+	GGen_Height id;
+};
+
+// Squared distances from the pixel at x to the two nearest candidates (and index of the nearest one) are written into
+// min_dist, second_min_dist and nearest. The candidates are given by their x coordinates and squared y distances from the
+// pixel row, count must be even (padded with a far away candidate). Distances above limit are ignored.
+void VoronoiNoise_NearestTwo(const double* candidate_x, const double* candidate_dy2, GGen_Index count, double x, double limit, double& min_dist, double& second_min_dist, int& nearest){
+#ifdef GGEN_SSE2
+	// Even candidates are handled in the lower lane, odd candidates in the upper one.
+	__m128d pixel_x = _mm_set1_pd(x);
+	__m128d min1 = _mm_set1_pd(limit);
+	__m128d min2 = min1;
+	__m128d index = _mm_set_pd(1, 0);
+	__m128d nearest_index = _mm_set1_pd(-1);
+	__m128d two = _mm_set1_pd(2);
+
+	for(GGen_Index i = 0; i < count; i += 2){
+		__m128d dx = _mm_sub_pd(pixel_x, _mm_loadu_pd(candidate_x + i));
+		__m128d distance = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_loadu_pd(candidate_dy2 + i));
+		__m128d closer = _mm_cmplt_pd(distance, min1);
+
+		nearest_index = _mm_or_pd(_mm_and_pd(closer, index), _mm_andnot_pd(closer, nearest_index));
+		min2 = _mm_min_pd(min2, _mm_max_pd(min1, distance));
+		min1 = _mm_min_pd(min1, distance);
+		index = _mm_add_pd(index, two);
+	}
+
+	double lane_min1[2], lane_min2[2], lane_nearest[2];
+	_mm_storeu_pd(lane_min1, min1);
+	_mm_storeu_pd(lane_min2, min2);
+	_mm_storeu_pd(lane_nearest, nearest_index);
+
+	// Merge the lanes (the lower index wins ties, just like in the serial version).
+	int first = lane_min1[1] < lane_min1[0] || (lane_min1[1] == lane_min1[0] && lane_nearest[1] < lane_nearest[0]) ? 1 : 0;
+
+	min_dist = lane_min1[first];
+	second_min_dist = MIN(lane_min2[first], lane_min1[1 - first]);
+	nearest = (int) lane_nearest[first];
+#else
+	min_dist = limit;
+	second_min_dist = limit;
+	nearest = -1;
+
+	for(GGen_Index i = 0; i < count; i++){
+		double dx = x - candidate_x[i];
+		double distance = dx * dx + candidate_dy2[i];
+
+		if(distance < min_dist){
+			second_min_dist = min_dist;
+			min_dist = distance;
+			nearest = i;
+		}
+		else if(distance < second_min_dist){
+			second_min_dist = distance;
 		}
 	}
+#endif
+}
 
-	delete [] verticalOverflowBuffer;
-	delete [] horizontalOverflowBuffer;
+void GGen_Data_2D::VoronoiNoise(GGen_Size cell_size, uint8 points_per_cell, GGen_Voronoi_Noise_Mode mode)
+{
+	this->VoronoiNoise_Fill(cell_size, points_per_cell, mode, NULL, mode);
+}
 
-	return;
-} 
+void GGen_Data_2D::VoronoiNoisePair(GGen_Size cell_size, uint8 points_per_cell, GGen_Voronoi_Noise_Mode mode, GGen_Data_2D* second_map, GGen_Voronoi_Noise_Mode second_mode)
+{
+	GGen_Script_Assert(second_map != NULL && second_map != this);
+	GGen_Script_Assert(second_map->width == this->width && second_map->height == this->height);
 
-// NOT REALLY FINISHED!! NEEDS A LOT OF POLISH!!!
-void GGen_Data_2D::VoronoiNoise(GGen_Size cell_size, uint8 points_per_cell, GGen_Voronoi_Noise_Mode mode)
+	this->VoronoiNoise_Fill(cell_size, points_per_cell, mode, second_map, second_mode);
+}
+
+void GGen_Data_2D::VoronoiNoise_Fill(GGen_Size cell_size, uint8 points_per_cell, GGen_Voronoi_Noise_Mode mode, GGen_Data_2D* second_map, GGen_Voronoi_Noise_Mode second_mode)
 {
 	GGen_Script_Assert(cell_size > 2);
+	GGen_Script_Assert(cell_size < 0x40000000); /* The squared diagonal of a cell must fit into 64 bits */
 	GGen_Script_Assert(points_per_cell >= 1);
 
-	#define VORONOINOISE_GET_POINT(x, y, i) points[i + (x) * points_per_cell + (y) * num_cells_x * points_per_cell]
-	
-	struct Point{
-		GGen_Coord x, y;
-	};
-	
-	uint16 num_cells_x = (uint16) ceil((double) this->width / (double) cell_size);
-	uint16 num_cells_y = (uint16) ceil((double) this->height / (double) cell_size);
-	int cell_width = cell_size;
-	int cell_height = cell_size;
+	this->PrepareWrite();
+
+	if (second_map != NULL) {
+		second_map->PrepareWrite();
+	}
+
+	#define VORONOINOISE_GET_POINT(x, y, i) points[i + (GGen_Index) (x) * points_per_cell + (y) * (GGen_Index) num_cells_x * points_per_cell]
 	
-	GGen_ExtExtHeight max_dist = 2 * cell_width * cell_width + cell_height * cell_height;
+	GGen_Size num_cells_x = (GGen_Size) ceil((double) this->width / (double) cell_size);
+	GGen_Size num_cells_y = (GGen_Size) ceil((double) this->height / (double) cell_size);
+	GGen_Size cell_width = cell_size;
+	GGen_Size cell_height = cell_size;
 	
-	uint16 num_points_current_cell = 1;
+	GGen_ExtExtHeight max_dist = 2 * (GGen_ExtExtHeight) cell_width * cell_width + (GGen_ExtExtHeight) cell_height * cell_height;
 
 	GGen_Size overlap_x;
 	GGen_Size overlap_y;
@@ -1046,108 +2306,171 @@ void GGen_Data_2D::VoronoiNoise(GGen_Size cell_size, uint8 points_per_cell, GGen
 		num_cells_y++;
 	}
 
-	Point* points = new Point[num_cells_x * num_cells_y * points_per_cell];
-	
-	//Point points[100];
+	VoronoiNoise_Point* points = new VoronoiNoise_Point[(GGen_Index) num_cells_x * num_cells_y * points_per_cell];
 
-	/* Distribute the points into cells */
-	for (int y = 0; y < num_cells_y; y++) {
-		for (int x = 0; x < num_cells_x; x++) {
+	/* Distribute the points into cells (each point coordinate has its own random value keyed by the cell and point index) */
+	GGen_RandomStream random = GGen_RandomStream::ForOperation();
+
+	for (GGen_Coord y = 0; y < num_cells_y; y++) {
+		for (GGen_Coord x = 0; x < num_cells_x; x++) {
 			for (int i = 0; i < points_per_cell; i++) {
 				if (x == 0) {
-					VORONOINOISE_GET_POINT(x, y, i).x = GGen_Random<int>(0, overlap_x);
+					VORONOINOISE_GET_POINT(x, y, i).x = random.At<GGen_Coord>(0, overlap_x, x, y, 2 * i);
 				} else if (x < num_cells_x - 1) {
-					VORONOINOISE_GET_POINT(x, y, i).x = overlap_x + (x - 1) * cell_width + GGen_Random<int>(0, cell_width);
+					VORONOINOISE_GET_POINT(x, y, i).x = overlap_x + (x - 1) * cell_width + random.At<GGen_Coord>(0, cell_width, x, y, 2 * i);
 				} else {
-					VORONOINOISE_GET_POINT(x, y, i).x = overlap_x + (x - 1) * cell_width + GGen_Random<int>(0, overlap_x);
+					VORONOINOISE_GET_POINT(x, y, i).x = overlap_x + (x - 1) * cell_width + random.At<GGen_Coord>(0, overlap_x, x, y, 2 * i);
 				}
 
 				if (y == 0) {
-					VORONOINOISE_GET_POINT(x, y, i).y = GGen_Random<int>(0, overlap_y);
+					VORONOINOISE_GET_POINT(x, y, i).y = random.At<GGen_Coord>(0, overlap_y, x, y, 2 * i + 1);
 				} else if (y < num_cells_y - 1) {
-					VORONOINOISE_GET_POINT(x, y, i).y = overlap_y + (y - 1) * cell_height + GGen_Random<int>(0, cell_height);
+					VORONOINOISE_GET_POINT(x, y, i).y = overlap_y + (y - 1) * cell_height + random.At<GGen_Coord>(0, cell_height, x, y, 2 * i + 1);
 				} else {
-					VORONOINOISE_GET_POINT(x, y, i).y = overlap_y + (y - 1) * cell_height + GGen_Random<int>(0, overlap_y);
+					VORONOINOISE_GET_POINT(x, y, i).y = overlap_y + (y - 1) * cell_height + random.At<GGen_Coord>(0, overlap_y, x, y, 2 * i + 1);
 				}
 
+				VORONOINOISE_GET_POINT(x, y, i).id = random.At<GGen_Height>(0, GGEN_MAX_HEIGHT, x, y, 2 * points_per_cell + i);
 			}	
 		}
 	}
-	
-	/* We will first collect the points from surrounding cells of each pixel and then work them individually.
-	 * Since we know the number of points in each cell, we can hold only one pointer in this array - to the first point
-	 * in the cell (so there will be only up to 9 pointers in the array). */
-	Point* points_waiting[9];
-	
-	for(GGen_Coord y = 0; y < height; y++){
-		for(GGen_Coord x = 0; x < width; x++){
-			/* We will always use at least  one cell (the current one) */
-			uint8 num_points_waiting = 1;
-			
-			/* Coordinates in the cell grid */
-			GGen_Coord cell_x = x / cell_width;
-			GGen_Coord cell_y = y / cell_height;
 
-			if (x < overlap_x) {
-				cell_x = 0;
-			} else if (x < this->width - overlap_x) {
-				cell_x = 1 + ((x - overlap_x) / cell_width);
-			} else {
-				cell_x = num_cells_x - 1;
-			}
-		
-			if (y < overlap_y) {
-				cell_y = 0;
-			} else if (y < this->height - overlap_y) {
-				cell_y = 1 + ((y - overlap_y) / cell_height);
-			} else {
-				cell_y = num_cells_y - 1;
-			}
+	/* Cell of each column and row of the map */
+	GGen_Coord* column_cells = new GGen_Coord[this->width];
+	GGen_Coord* row_cells = new GGen_Coord[this->height];
 
-			/* Distances to the nearest and second nearest point */
-			GGen_ExtExtHeight current_min_dist = max_dist - 1;
-			GGen_ExtExtHeight current_second_min_dist = max_dist - 1;
-			
-			/* The current cell */
-			points_waiting[0] = &VORONOINOISE_GET_POINT(cell_x, cell_y, 0);
-		
-			/* Collect points from the surrounding cells */
-			if(cell_y > 0 && cell_x > 0)							{points_waiting[num_points_waiting] = &VORONOINOISE_GET_POINT(cell_x - 1, cell_y - 1, 0); ++num_points_waiting;}
-			if(cell_y > 0)											{points_waiting[num_points_waiting] = &VORONOINOISE_GET_POINT(cell_x,	 cell_y - 1, 0); ++num_points_waiting;}
-			if(cell_y > 0 && cell_x < num_cells_x - 1)				{points_waiting[num_points_waiting] = &VORONOINOISE_GET_POINT(cell_x + 1, cell_y - 1, 0); ++num_points_waiting;}
-			if(cell_x > 0)											{points_waiting[num_points_waiting] = &VORONOINOISE_GET_POINT(cell_x - 1, cell_y	   , 0); ++num_points_waiting;}
-			if(cell_x < num_cells_x - 1)							{points_waiting[num_points_waiting] = &VORONOINOISE_GET_POINT(cell_x + 1, cell_y	   , 0); ++num_points_waiting;}
-			if(cell_x > 0 && cell_y < num_cells_y - 1)				{points_waiting[num_points_waiting] = &VORONOINOISE_GET_POINT(cell_x - 1, cell_y + 1, 0); ++num_points_waiting;}
-			if(cell_y < num_cells_y - 1)							{points_waiting[num_points_waiting] = &VORONOINOISE_GET_POINT(cell_x	   , cell_y + 1, 0); ++num_points_waiting;}
-			if(cell_x < num_cells_x - 1 && cell_y < num_cells_y - 1){points_waiting[num_points_waiting] = &VORONOINOISE_GET_POINT(cell_x + 1, cell_y + 1, 0); ++num_points_waiting;}
-			
-			/* Find the closest point */
-			for(int i = 0; i < num_points_waiting; i++){
-				for(int j = 0; j < points_per_cell; j++){
-					Point* current_point = points_waiting[i] + j;
-					
-					double current_distance = (double) (x - current_point->x) * (double) (x - current_point->x) + (double) (y - current_point->y) * (double) (y - current_point->y);
-					
-					/* Is the current point closer than the nearest one? */
-					if(current_distance <= current_min_dist){
-						/* The current closest point will become the second closest */
-						current_second_min_dist = current_min_dist;
+	for (GGen_Coord x = 0; x < this->width; x++) {
+		if (x < overlap_x) {
+			column_cells[x] = 0;
+		} else if (x < this->width - overlap_x) {
+			column_cells[x] = 1 + ((x - overlap_x) / cell_width);
+		} else {
+			column_cells[x] = num_cells_x - 1;
+		}
+	}
+
+	for (GGen_Coord y = 0; y < this->height; y++) {
+		if (y < overlap_y) {
+			row_cells[y] = 0;
+		} else if (y < this->height - overlap_y) {
+			row_cells[y] = 1 + ((y - overlap_y) / cell_height);
+		} else {
+			row_cells[y] = num_cells_y - 1;
+		}
+	}
+
+	/* Distances to the two nearest points are squared. Distances above max_dist - 1 are ignored (as if there was
+	 * no point). */
+	double limit = (double) (max_dist - 1);
+
+	GGen_Data_2D* maps[2] = {this, second_map};
+	GGen_Voronoi_Noise_Mode modes[2] = {mode, second_mode};
+	int num_maps = second_map == NULL ? 1 : 2;
+
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		/* Points of the current cell and all the surrounding cells (padded to even count) */
+		GGen_Index max_candidates = 9 * points_per_cell + 1;
+		double* candidate_x = new double[max_candidates];
+		double* candidate_y = new double[max_candidates];
+		double* candidate_dy2 = new double[max_candidates];
+		GGen_Height* candidate_id = new GGen_Height[max_candidates];
+
+		/* Walk the rows cell by cell, so the candidate list is built only once for each cell */
+		for (GGen_Coord row_from = (GGen_Coord) from; row_from < to;) {
+			GGen_Coord cell_y = row_cells[row_from];
 
-						current_min_dist = (GGen_ExtExtHeight) current_distance;
+			GGen_Coord row_to = row_from;
+			while (row_to < to && row_cells[row_to] == cell_y) row_to++;
+
+			for (GGen_Coord column_from = 0; column_from < this->width;) {
+				GGen_Coord cell_x = column_cells[column_from];
+
+				GGen_Coord column_to = column_from;
+				while (column_to < this->width && column_cells[column_to] == cell_x) column_to++;
+
+				/* Collect points from the current cell and the surrounding cells */
+				GGen_Index num_candidates = 0;
+
+				for (GGen_Coord neighbor_y = cell_y > 0 ? cell_y - 1 : 0; neighbor_y <= MIN(cell_y + 1, num_cells_y - 1); neighbor_y++) {
+					for (GGen_Coord neighbor_x = cell_x > 0 ? cell_x - 1 : 0; neighbor_x <= MIN(cell_x + 1, num_cells_x - 1); neighbor_x++) {
+						for (int i = 0; i < points_per_cell; i++) {
+							VoronoiNoise_Point& point = VORONOINOISE_GET_POINT(neighbor_x, neighbor_y, i);
+
+							candidate_x[num_candidates] = point.x;
+							candidate_y[num_candidates] = point.y;
+							candidate_id[num_candidates] = point.id;
+							num_candidates++;
+						}
+					}
+				}
+
+				if (num_candidates % 2 == 1) {
+					candidate_x[num_candidates] = -1e9;
+					candidate_y[num_candidates] = -1e9;
+					candidate_id[num_candidates] = 0;
+					num_candidates++;
+				}
+
+				for (GGen_Coord y = row_from; y < row_to; y++) {
+					for (GGen_Index i = 0; i < num_candidates; i++) {
+						double dy = (double) y - candidate_y[i];
+						candidate_dy2[i] = dy * dy;
 					}
 
-					/* The current point is closer than the second closest one, but further than the nearest one -> it can still become #2 */
-					if(current_distance > current_min_dist && current_distance < current_second_min_dist){
-						current_second_min_dist = (GGen_ExtExtHeight) current_distance;
+					for (GGen_Coord x = column_from; x < column_to; x++) {
+						double min_dist_double, second_min_dist_double;
+						int nearest;
+
+						VoronoiNoise_NearestTwo(candidate_x, candidate_dy2, num_candidates, (double) x, limit, min_dist_double, second_min_dist_double, nearest);
+
+						GGen_ExtExtHeight current_min_dist = (GGen_ExtExtHeight) min_dist_double;
+						GGen_ExtExtHeight current_second_min_dist = (GGen_ExtExtHeight) second_min_dist_double;
+
+						/* Calculate value for current point from the distances to the two closest points */
+						for (int i = 0; i < num_maps; i++) {
+							GGen_Height value = 0;
+
+							switch (modes[i]) {
+								case GGEN_RIDGES:
+									value = (GGen_Height) ((-current_min_dist + current_second_min_dist) * GGEN_MAX_HEIGHT / max_dist);
+									break;
+								case GGEN_BUBBLES:
+									value = (GGen_Height) (current_min_dist * GGEN_MAX_HEIGHT / max_dist);
+									break;
+								case GGEN_F1:
+									value = (GGen_Height) MIN(sqrt(min_dist_double) * GGEN_MAX_HEIGHT / cell_size, (double) GGEN_MAX_HEIGHT);
+									break;
+								case GGEN_F2:
+									value = (GGen_Height) MIN(sqrt(second_min_dist_double) * GGEN_MAX_HEIGHT / cell_size, (double) GGEN_MAX_HEIGHT);
+									break;
+								case GGEN_F2_MINUS_F1:
+									value = (GGen_Height) MIN((sqrt(second_min_dist_double) - sqrt(min_dist_double)) * GGEN_MAX_HEIGHT / cell_size, (double) GGEN_MAX_HEIGHT);
+									break;
+								case GGEN_CELL_ID:
+									value = nearest >= 0 ? candidate_id[nearest] : 0;
+									break;
+							}
+
+							maps[i]->data[x + y * (GGen_Index) this->width] = value;
+						}
 					}
 				}
+
+				column_from = column_to;
 			}
-			
-			/* Calculate value for current point from the distances to the two closest points */
-			if(mode == GGEN_RIDGES) data[x + y * width] = (GGen_Height) ((-current_min_dist + current_second_min_dist) * GGEN_MAX_HEIGHT / max_dist);
-			else if(mode == GGEN_BUBBLES) data[x + y * width] = (GGen_Height) (current_min_dist * GGEN_MAX_HEIGHT / max_dist);
+
+			row_from = row_to;
 		}
-	}
+
+		delete [] candidate_x;
+		delete [] candidate_y;
+		delete [] candidate_dy2;
+		delete [] candidate_id;
+	});
+
+	delete [] column_cells;
+	delete [] row_cells;
+	delete [] points;
 
 	#undef VORONOINOISE_GET_POINT
 }
@@ -1162,26 +2485,46 @@ void GGen_Data_2D::Flood(double water_amount)
 
 	GGen_Index target = (GGen_Index) (water_amount * (double) this->length);
 
-	GGen_Height min = this->Min();
-	GGen_Height max = this->Max();
+	/* Number of tiles higher than or equal to each value (one extra item for the value above the highest one) */
+	GGen_Index* counts = new GGen_Index[GGEN_HISTOGRAM_SIZE + 1];
+
+	GGen_Script_Assert(counts != NULL);
+
+	this->CountValues(counts);
+
+	counts[GGEN_HISTOGRAM_SIZE] = 0;
+
+	GGen_Index lowest = 0;
+	while (lowest < GGEN_HISTOGRAM_SIZE - 1 && counts[lowest] == 0) lowest++;
+
+	GGen_Index highest = GGEN_HISTOGRAM_SIZE - 1;
+	while (highest > 0 && counts[highest] == 0) highest--;
+
+	for (GGen_Index bin = GGEN_HISTOGRAM_SIZE; bin-- > 0;) {
+		counts[bin] += counts[bin + 1];
+	}
+
+	/* Counts of tiles higher than or equal to a value, indexed by the value */
+	GGen_Index* amounts = counts - GGEN_INVALID_HEIGHT;
+
+	/* The same limits as Min() and Max() would return */
+	GGen_Height min = (GGen_Height) MIN((GGen_ExtHeight) lowest + GGEN_INVALID_HEIGHT, GGEN_MAX_HEIGHT);
+	GGen_Height max = (GGen_Height) MAX((GGen_ExtHeight) highest + GGEN_INVALID_HEIGHT, GGEN_MIN_HEIGHT);
 
 	// Use the binary search algorithm to find the correct water level
-	GGen_Height middle;
+	GGen_Height middle = min;
 	while (max - min > 1) {
 		middle = min + (max - min) / 2;
 
-		GGen_Index amount = 0;
-		for (GGen_Index i = 0; i < this->length; i++) {
-			if(this->data[i] >= middle) amount++;
-		}
-
-		if (amount > target) {
+		if (amounts[middle] > target) {
 			min = middle;
 		} else {
 			max = middle;
 		}
 	}
 
+	delete [] counts;
+
 	/* Shift the heights so given portion of the array is under zero */
 	this->Add(-middle);
 }
@@ -1194,88 +2537,228 @@ void GGen_Data_2D::Smooth(GGen_Distance radius)
 	this->SmoothDirection(radius, GGEN_VERTICAL);
 }
 
+/* Number of columns processed together by the vertical smoothing pass (the window sums of the whole strip are updated
+ * row by row, so the map is read in row order) */
+#define GGEN_SMOOTH_STRIP_WIDTH 64
+
 void GGen_Data_2D::SmoothDirection(GGen_Distance radius, GGen_Direction direction)
 {
 	GGen_Script_Assert(radius > 0);
-	
-	/* Allocate the new array */
-	GGen_Height* new_data = new GGen_Height[this->length];
 
-	GGen_Script_Assert(new_data != NULL);
+	this->PrepareWrite();
 
+	GGen_ExtHeight window_size = (GGen_ExtHeight) radius * 2 + 1;
+
+	/* Both passes work in place. The window sum at position i is the sum at position i - 1 plus the value at
+	 * i + radius minus the value at i - radius (positions outside the map are replaced by the nearest edge), so only
+	 * the original values which were already overwritten need to be stored aside. */
 	if (direction == GGEN_HORIZONTAL) {
-		for (GGen_Coord y = 0; y < height; y++) {
-			/* Prefill the window with value of the left edge + n leftmost values (where n is radius) */
-			GGen_Size window_size = radius * 2 + 1;
-			GGen_ExtHeight window_value = this->data[this->width * y] * radius;
+		GGen_ParallelFor(0, height, [&](GGen_Index from, GGen_Index to){
+			/* Original values of the current row */
+			GGen_Height* row = new GGen_Height[this->width];
+
+			for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+				memcpy(row, this->data + (GGen_Index) this->width * y, (GGen_Index) this->width * sizeof(GGen_Height));
+
+				/* Prefill the window with value of the left edge + n leftmost values (where n is radius) */
+				GGen_ExtHeight window_value = row[0] * (GGen_ExtHeight) radius;
+
+				for (GGen_Distance x = 0; x < radius; x++) {
+					window_value += row[MIN(x, (GGen_Distance) this->width - 1)];
+				}
+
+				/* In every step shift the window one tile to the right  (= subtract its leftmost cell and add
+				value of rightmost + 1). */
+				for (GGen_Coord x = 0; x < this->width; x++) {
+					/* If the window is approaching a border, use the edge value as fill. */
+					window_value += row[MIN(x + radius, (GGen_Distance) this->width - 1)] - row[x < radius ? 0 : x - radius];
 
-			for (GGen_Distance x = 0; x < radius; x++) {
-				window_value += this->data[x + this->width * y];
+					/* Set the value of current tile to arithmetic average of window tiles. */
+					this->data[x + (GGen_Index) this->width * y] = window_value / window_size;
+				}
 			}
 
-			/* In every step shift the window one tile to the right  (= subtract its leftmost cell and add
-			value of rightmost + 1). i represents position of the central cell of the window. */
-			for (GGen_Coord x = 0; x < this->width; x++) {
-				/* If the window is approaching right border, use the rightmost value as fill. */
-				if (x < radius) {
-					window_value += this->data[x + radius + this->width * y] - this->data[this->width * y];
-				} else if (x + radius < this->width) {
-					window_value += this->data[x + radius + this->width * y] - this->data[x - radius + this->width * y];
-				} else {
-					window_value += this->data[this->width - 1 + this->width * y] - this->data[x - radius + this->width * y];
+			delete [] row;
+		});
+	} else { /* vertical */
+		/* Original values of the last radius + 1 rows of the strip (the window never reaches further up) */
+		GGen_Size ring_rows = (GGen_Size) MIN(radius + 1, (GGen_Distance) this->height);
+
+		GGen_ParallelFor(0, (this->width + GGEN_SMOOTH_STRIP_WIDTH - 1) / GGEN_SMOOTH_STRIP_WIDTH, [&](GGen_Index from, GGen_Index to){
+			GGen_Height* ring = new GGen_Height[(GGen_Index) ring_rows * GGEN_SMOOTH_STRIP_WIDTH];
+			GGen_ExtHeight window_values[GGEN_SMOOTH_STRIP_WIDTH];
+
+			for (GGen_Index strip = from; strip < to; strip++) {
+				GGen_Coord strip_x = (GGen_Coord) (strip * GGEN_SMOOTH_STRIP_WIDTH);
+				GGen_Size strip_width = (GGen_Size) MIN(GGEN_SMOOTH_STRIP_WIDTH, this->width - strip_x);
+				GGen_Height* column = this->data + strip_x;
+
+				/* Prefill the windows with value of the top edge + n topmost values (where n is radius) */
+				for (GGen_Size i = 0; i < strip_width; i++) {
+					window_values[i] = column[i] * (GGen_ExtHeight) radius;
+				}
+
+				for (GGen_Distance y = 0; y < radius; y++) {
+					GGen_Height* source = column + MIN(y, (GGen_Distance) this->height - 1) * (GGen_Index) this->width;
+
+					for (GGen_Size i = 0; i < strip_width; i++) {
+						window_values[i] += source[i];
+					}
 				}
 
-				/* Set the value of current tile to arithmetic average of window tiles. */
-				new_data[x + this->width * y] = window_value / window_size;
+				/* In every step shift the windows one tile to the bottom  (= subtract their topmost cells and add
+				values of bottommost + 1). */
+				for (GGen_Coord y = 0; y < this->height; y++) {
+					GGen_Height* current = column + y * (GGen_Index) this->width;
+					GGen_Height* added = column + MIN(y + radius, (GGen_Distance) this->height - 1) * (GGen_Index) this->width;
+					GGen_Height* removed = ring + ((y < radius ? 0 : y - radius) % ring_rows) * GGEN_SMOOTH_STRIP_WIDTH;
+
+					/* The row is about to be overwritten, remember its original values. */
+					memcpy(ring + (y % ring_rows) * GGEN_SMOOTH_STRIP_WIDTH, current, strip_width * sizeof(GGen_Height));
+
+					for (GGen_Size i = 0; i < strip_width; i++) {
+						window_values[i] += added[i] - removed[i];
+
+						/* Set the value of current tile to arithmetic average of window tiles. */
+						current[i] = window_values[i] / window_size;
+					}
+				}
+			}
+
+			delete [] ring;
+		});
+	}
+}
+
+#undef GGEN_SMOOTH_STRIP_WIDTH
+
+/* Coefficients of the recursive gaussian filter (Young and van Vliet, "Recursive implementation of the Gaussian filter") */
+struct GaussianBlur_Coefficients{
+	/* Weight of the input value */
+	double b;
+
+	/* Weights of the previous three outputs */
+	double b1, b2, b3;
+
+	GaussianBlur_Coefficients(double sigma){
+		double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330 : 3.97156 - 4.14554 * sqrt(1 - 0.26891 * sigma);
+		double q2 = q * q;
+		double q3 = q2 * q;
+		double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+
+		this->b1 = ((2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0);
+		this->b2 = (-(1.4281 * q2 + 1.26661 * q3) / b0);
+		this->b3 = (0.422205 * q3 / b0);
+		this->b = 1 - (this->b1 + this->b2 + this->b3);
+	}
+};
+
+/* Number of columns processed together by the vertical blur pass */
+#define GGEN_BLUR_STRIP_WIDTH 64
+
+void GGen_Data_2D::GaussianBlur(double sigma)
+{
+	GGen_Script_Assert(sigma >= 0.5);
+
+	this->PrepareWrite();
+
+	GaussianBlur_Coefficients c(sigma);
+
+	/* The values are kept as floats between the passes (and filtered in doubles), so they are rounded to heights only once */
+	float* buffer = new float[this->length];
+
+	GGen_Script_Assert(buffer != NULL);
+
+	/* Horizontal pass: filter each row forwards and then backwards. Values outside the map are considered to be equal
+	 * to the nearest edge value (so the filter starts in its steady state for that value). */
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			GGen_Height* source = this->data + y * (GGen_Index) this->width;
+			float* row = buffer + y * (GGen_Index) this->width;
+
+			double w1 = source[0], w2 = source[0], w3 = source[0];
+
+			for (GGen_Coord x = 0; x < this->width; x++) {
+				double w = c.b * source[x] + c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+				row[x] = (float) w;
+				w3 = w2; w2 = w1; w1 = w;
+			}
+
+			w1 = w2 = w3 = row[this->width - 1];
+
+			for (GGen_Coord x = this->width; x-- > 0;) {
+				double w = c.b * row[x] + c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+				row[x] = (float) w;
+				w3 = w2; w2 = w1; w1 = w;
 			}
 		}
-	} else { /* vertical */
-		for (GGen_Coord x = 0; x < this->width; x++) {
-			/* Prefill the window with value of the left edge + n topmost values (where n is radius) */
-			GGen_Size window_size = radius * 2 + 1;
-			GGen_ExtHeight window_value = this->data[x] * radius;
+	});
+
+	/* Vertical pass: the same in strips of columns, so the map is walked in row order */
+	GGen_ParallelFor(0, (this->width + GGEN_BLUR_STRIP_WIDTH - 1) / GGEN_BLUR_STRIP_WIDTH, [&](GGen_Index from, GGen_Index to){
+		double w1[GGEN_BLUR_STRIP_WIDTH], w2[GGEN_BLUR_STRIP_WIDTH], w3[GGEN_BLUR_STRIP_WIDTH];
 
-			for (GGen_Distance y = 0; y < radius; y++) {
-				window_value += this->data[x + y * this->width];
+		for (GGen_Index strip = from; strip < to; strip++) {
+			GGen_Coord strip_x = (GGen_Coord) (strip * GGEN_BLUR_STRIP_WIDTH);
+			GGen_Size strip_width = (GGen_Size) MIN(GGEN_BLUR_STRIP_WIDTH, this->width - strip_x);
+			float* column = buffer + strip_x;
+
+			for (GGen_Size i = 0; i < strip_width; i++) {
+				w1[i] = w2[i] = w3[i] = column[i];
 			}
 
-			/* In every step shift the window one tile to the bottom  (= subtract its topmost cell and add
-			value of bottommost + 1). i represents position of the central cell of the window. */
 			for (GGen_Coord y = 0; y < this->height; y++) {
-				/* If the window is approaching right border, use the rightmost value as fill. */
-				if (y < radius) {
-					window_value += this->data[x + (y + radius) * this->width] - this->data[x];
-				} else if (y + radius < height) {
-					window_value += this->data[x + (y + radius) * this->width] - this->data[x + (y - radius) * this->width];
-				} else {
-					window_value += this->data[x + (this->height - 1) * this->width] - this->data[x + (y - radius) * this->width];
+				float* row = column + y * (GGen_Index) this->width;
+
+				for (GGen_Size i = 0; i < strip_width; i++) {
+					double w = c.b * row[i] + c.b1 * w1[i] + c.b2 * w2[i] + c.b3 * w3[i];
+					row[i] = (float) w;
+					w3[i] = w2[i]; w2[i] = w1[i]; w1[i] = w;
 				}
+			}
+
+			for (GGen_Size i = 0; i < strip_width; i++) {
+				w1[i] = w2[i] = w3[i] = column[i + (this->height - 1) * (GGen_Index) this->width];
+			}
+
+			for (GGen_Coord y = this->height; y-- > 0;) {
+				float* row = column + y * (GGen_Index) this->width;
+				GGen_Height* target = this->data + strip_x + y * (GGen_Index) this->width;
 
-				/* Set the value of current tile to arithmetic average of window tiles. */
-				new_data[x + this->width * y] = window_value / window_size;
+				for (GGen_Size i = 0; i < strip_width; i++) {
+					double w = c.b * row[i] + c.b1 * w1[i] + c.b2 * w2[i] + c.b3 * w3[i];
+					w3[i] = w2[i]; w2[i] = w1[i]; w1[i] = w;
+
+					/* Round to the nearest height */
+					target[i] = (GGen_Height) MAX(MIN(floor(w + 0.5), (double) GGEN_MAX_HEIGHT), (double) GGEN_MIN_HEIGHT);
+				}
 			}
 		}
-	}	
-	
+	});
 
-	/* Relink and delete the original array data */
-	delete [] this->data;
-	this->data = new_data;	
+	delete [] buffer;
 }
 
+#undef GGEN_BLUR_STRIP_WIDTH
+
 void GGen_Data_2D::Pattern(GGen_Data_2D* pattern)
 {
 	GGen_Script_Assert(pattern != NULL);
 	
+	this->PrepareWrite();
+	pattern->FlushOperations();
+
 	for (GGen_Coord y = 0; y < this->height; y++) {
 		for (GGen_Coord x = 0; x < this->width; x++) {
-			this->data[x + y * this->width] = pattern->data[ y % pattern->width + (x % pattern->height) * pattern->height];
+			this->data[x + y * (GGen_Index) this->width] = pattern->data[ y % pattern->width + (x % pattern->height) * pattern->height];
 		}
 	}
 }
 
 void GGen_Data_2D::ReturnAs(const GGen_String &name)
 {
+	this->FlushOperations();
+
 	if(GGen::GetInstance()->return_callback == NULL) {
 		GGen::GetInstance()->ThrowMessage(GGen_Const_String("The script returned a named map, but return handler was not defined"), GGEN_WARNING);
 		return;
@@ -1287,41 +2770,47 @@ void GGen_Data_2D::ReturnAs(const GGen_String &name)
 
 void GGen_Data_2D::Monochrome(GGen_Height threshold)
 {
-	for (GGen_Index i = 0; i < this->length; i++) {
-		this->data[i] = this->data[i] > threshold ? 1 : 0;
-	}	
+	GGen_Data_2D_Operation operation(GGEN_OPERATION_MONOCHROME);
+	operation.value = threshold;
+
+	this->ApplyOperation(operation);
 }
 
 void GGen_Data_2D::SelectValue(GGen_Height value)
 {
-	for (GGen_Index i = 0; i < this->length; i++) {
-		this->data[i] = this->data[i] == value ? 1 : 0;
-	}	
+	GGen_Data_2D_Operation operation(GGEN_OPERATION_SELECT_VALUE);
+	operation.value = value;
+
+	this->ApplyOperation(operation);
 }
 
 
 void GGen_Data_2D::SlopeMap()
 {
+	this->PrepareReplace();
+
 	/* Allocate the new array */
-	GGen_Height* new_data = new GGen_Height[this->length];
+	GGen_Height* new_data = GGen_BufferPool::Allocate(this->length);
 
 	GGen_Script_Assert(new_data != NULL);
 	GGen_Script_Assert(this->width > 2 && this->height > 2);
 
-	for (GGen_Coord y = 1; y < this->height - 1; y++) {
-		for (GGen_Coord x = 1; x < this->width - 1; x++) {		
-			new_data[x + y * this->width] = 
-				MAX(
-					ABS(this->data[x + y * this->width - 1] - this->data[x + y * this->width + 1]), 
-					ABS(this->data[x + y * this->width - this->width] - this->data[x + y * this->width + this->width])
-				);
+	GGen_ParallelFor(1, this->height - 1, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			for (GGen_Coord x = 1; x < this->width - 1; x++) {		
+				new_data[x + y * (GGen_Index) this->width] = 
+					MAX(
+						ABS(this->data[x + y * (GGen_Index) this->width - 1] - this->data[x + y * (GGen_Index) this->width + 1]), 
+						ABS(this->data[x + y * (GGen_Index) this->width - this->width] - this->data[x + y * (GGen_Index) this->width + this->width])
+					);
+			}
 		}
-	}
+	});
 
 	/* Fix the corners */
 	new_data[0] =  new_data[this->width + 1];
-	new_data[this->width - 1] = new_data[2 * this->width - 2];
-	new_data[this->length - this->width] = new_data[this->length - 2 * this->width + 1];
+	new_data[this->width - 1] = new_data[2 * (GGen_Index) this->width - 2];
+	new_data[this->length - this->width] = new_data[this->length - 2 * (GGen_Index) this->width + 1];
 	new_data[length - 1] = new_data[length - width - 2];
 
 	/* Upper border */
@@ -1331,22 +2820,21 @@ void GGen_Data_2D::SlopeMap()
 
 	/* Bottom corner */
 	for (GGen_Coord x = 1; x < this->width - 1; x++) {
-		new_data[this->length - this->width + x] = new_data[this->length - 2 * this->width + x];
+		new_data[this->length - this->width + x] = new_data[this->length - 2 * (GGen_Index) this->width + x];
 	}
 
 	/* Left border */
 	for (GGen_Coord y = 1; y < this->height - 1; y++) {
-		new_data[y * this->width] = new_data[y * this->width + 1];
+		new_data[y * (GGen_Index) this->width] = new_data[y * (GGen_Index) this->width + 1];
 	}
 
 	/* Right border */
 	for (GGen_Coord y = 1; y < this->height - 1; y++) {
-		new_data[y * this->width + this->width - 1] = new_data[y * this->width + this->width - 2];
+		new_data[y * (GGen_Index) this->width + this->width - 1] = new_data[y * (GGen_Index) this->width + this->width - 2];
 	}
 
 	/* Relink and delete the original array data */
-	delete [] this->data;
-	this->data = new_data;	
+	this->ReplaceData(new_data);	
 }
 
 void GGen_Data_2D::Scatter(bool relative)
@@ -1357,11 +2845,17 @@ void GGen_Data_2D::Scatter(bool relative)
 		max = this->Max();
 	}
 
-	for (GGen_Coord y = 0; y < this->height; y++) {
-		for (GGen_Coord x = 0; x < this->width; x++) {		
-			this->data[x + y * this->width] = GGen_Random<GGen_Height>(0, max) > this->data[x + y * this->width] ? 0 : 1;
+	this->PrepareWrite();
+
+	GGen_RandomStream random = GGen_RandomStream::ForOperation();
+
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			for (GGen_Coord x = 0; x < this->width; x++) {		
+				this->data[x + y * (GGen_Index) this->width] = random.At<GGen_Height>(0, max, x, y) > this->data[x + y * (GGen_Index) this->width] ? 0 : 1;
+			}
 		}
-	}
+	});
 }
 
 void GGen_Data_2D::TransformValues(GGen_Data_1D* profile, bool relative)
@@ -1373,47 +2867,56 @@ void GGen_Data_2D::TransformValues(GGen_Data_1D* profile, bool relative)
 
 	if(relative){
 		max = this->Max();
+
+		/* Only positive values are transformed */
+		if (max <= 0) return;
 	}
 
+	this->PrepareWrite();
+
+	/* Resample the profile for all positive values at once */
+	GGen_CompiledProfile compiled_profile(profile, max + 1);
+
 	/* Transform the values */
-	for (GGen_Coord y = 0; y < this->height; y++) {
-		for (GGen_Coord x = 0; x < this->width; x++) {	
-			if (this->data[x + y * this->width] > 0) {
-				GGen_Height height = this->data[x + this->width * y];
-				this->data[x + y * this->width] = profile->GetValueInterpolated(height, max + 1);
+	GGen_ParallelFor(0, this->length, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			if (this->data[i] > 0) {
+				this->data[i] = compiled_profile[this->data[i]];
 			}
 		}
-	}
+	});
 }
 
 void GGen_Data_2D::NormalizeDirection(GGen_Direction direction, GGen_Normalization_Mode mode)
 {
+	this->PrepareWrite();
+
 	if (direction == GGEN_HORIZONTAL) {
 		for (GGen_Coord y = 0; y < this->height; y++){
-			GGen_Height last = this->data[y * this->width];
+			GGen_Height last = this->data[y * (GGen_Index) this->width];
 
 			for (GGen_Coord x = 0; x < this->width; x++) {
-				if (mode == GGEN_ADDITIVE && this->data[x + y * this->width] > last + 1) {
-					this->data[x + y * this->width] = last + 1;
-				} else if (mode == GGEN_SUBSTRACTIVE && this->data[x + y * this->width] < last - 1) {
-					this->data[x + y * this->width] = last - 1;
+				if (mode == GGEN_ADDITIVE && this->data[x + y * (GGen_Index) this->width] > last + 1) {
+					this->data[x + y * (GGen_Index) this->width] = last + 1;
+				} else if (mode == GGEN_SUBSTRACTIVE && this->data[x + y * (GGen_Index) this->width] < last - 1) {
+					this->data[x + y * (GGen_Index) this->width] = last - 1;
 				}
 
-				last = this->data[x + y * this->width];
+				last = this->data[x + y * (GGen_Index) this->width];
 			}
 		}
 		
 		for (GGen_Coord y = this->height - 1; y > 0; y--) {
-			GGen_Height last = this->data[y * this->width + this->width - 1];
+			GGen_Height last = this->data[y * (GGen_Index) this->width + this->width - 1];
 
 			for (GGen_Coord x = this->width - 1; x > 0; x--) {
-				if (mode == GGEN_ADDITIVE && this->data[x + y * this->width] > last + 1) {
-					this->data[x + y * this->width] = last + 1;
-				} else if (mode == GGEN_SUBSTRACTIVE && this->data[x + y * this->width] < last - 1) {
-					this->data[x + y * this->width] = last - 1;
+				if (mode == GGEN_ADDITIVE && this->data[x + y * (GGen_Index) this->width] > last + 1) {
+					this->data[x + y * (GGen_Index) this->width] = last + 1;
+				} else if (mode == GGEN_SUBSTRACTIVE && this->data[x + y * (GGen_Index) this->width] < last - 1) {
+					this->data[x + y * (GGen_Index) this->width] = last - 1;
 				}
 
-				last = this->data[x + y * this->width];
+				last = this->data[x + y * (GGen_Index) this->width];
 			}
 		}
 	} else if (direction == GGEN_VERTICAL) {
@@ -1421,13 +2924,13 @@ void GGen_Data_2D::NormalizeDirection(GGen_Direction direction, GGen_Normalizati
 			GGen_Height last = this->data[x];
 			
 			for (GGen_Coord y = 0; y < this->height; y++) {
-				if (mode == GGEN_ADDITIVE && this->data[x + y * this->width] > last + 1) {
-					this->data[x + y * this->width] = last + 1;
-				} else if (mode == GGEN_SUBSTRACTIVE && this->data[x + y * this->width] < last - 1) {
-					this->data[x + y * this->width] = last - 1;
+				if (mode == GGEN_ADDITIVE && this->data[x + y * (GGen_Index) this->width] > last + 1) {
+					this->data[x + y * (GGen_Index) this->width] = last + 1;
+				} else if (mode == GGEN_SUBSTRACTIVE && this->data[x + y * (GGen_Index) this->width] < last - 1) {
+					this->data[x + y * (GGen_Index) this->width] = last - 1;
 				}
 
-				last = this->data[x + y * this->width];
+				last = this->data[x + y * (GGen_Index) this->width];
 			}
 		}
 		
@@ -1435,13 +2938,13 @@ void GGen_Data_2D::NormalizeDirection(GGen_Direction direction, GGen_Normalizati
 			GGen_Height last = this->data[this->length - (this->width - x)];
 
 			for (GGen_Coord y = this->height - 1; y > 0; y--) {
-				if (mode == GGEN_ADDITIVE && this->data[x + y * this->width] > last + 1) {
-					this->data[x + y * this->width] = last + 1;
-				} else if (mode == GGEN_SUBSTRACTIVE && this->data[x + y * this->width] < last - 1) {
-					this->data[x + y * this->width] = last - 1;
+				if (mode == GGEN_ADDITIVE && this->data[x + y * (GGen_Index) this->width] > last + 1) {
+					this->data[x + y * (GGen_Index) this->width] = last + 1;
+				} else if (mode == GGEN_SUBSTRACTIVE && this->data[x + y * (GGen_Index) this->width] < last - 1) {
+					this->data[x + y * (GGen_Index) this->width] = last - 1;
 				}
 
-				last = this->data[x + y * this->width];
+				last = this->data[x + y * (GGen_Index) this->width];
 			}
 		}
 	}
@@ -1453,10 +2956,16 @@ void GGen_Data_2D::Normalize(GGen_Normalization_Mode mode)
 	this->NormalizeDirection(GGEN_VERTICAL, mode);
 }
 
-void GGen_Data_2D::Transform(double a11, double a12, double a21, double a22, bool preserve_size)
+/* Size of the square blocks the transformed map is generated in (so the source is read from a small area at a time) */
+#define GGEN_TRANSFORM_BLOCK_SIZE 64
+
+void GGen_Data_2D::TransformFiltered(double a11, double a12, double a21, double a22, bool preserve_size, GGen_Scaling_Filter filter)
 {
 	/* The matrix must be invertible (its determinant must not be 0) */
 	GGen_Script_Assert(a11 * a22 - a12 * a21 != 0);
+	GGen_Script_Assert(filter == GGEN_BOX || filter == GGEN_BILINEAR);
+
+	this->PrepareReplace();
 
 	/* Calculate output's boundaries so we can allocate the new array */
 	double new_top_right_x = (this->width - 1) * a11;
@@ -1470,21 +2979,21 @@ void GGen_Data_2D::Transform(double a11, double a12, double a21, double a22, boo
 	
 	/* Find which bounding point is which (the rotations and such might change this). The zeros
 	represent the origin (upper left corner), which always stays the same. */
-	GGen_CoordOffset new_left_x = (int32) floor(MIN(MIN(0, new_top_right_x), MIN(new_bottom_left_x, new_bottom_right_x)));
-	GGen_CoordOffset new_right_x = (int32) ceil(MAX(MAX(0, new_top_right_x), MAX(new_bottom_left_x, new_bottom_right_x)));
+	GGen_CoordOffset new_left_x = (GGen_CoordOffset) floor(MIN(MIN(0, new_top_right_x), MIN(new_bottom_left_x, new_bottom_right_x)));
+	GGen_CoordOffset new_right_x = (GGen_CoordOffset) ceil(MAX(MAX(0, new_top_right_x), MAX(new_bottom_left_x, new_bottom_right_x)));
 	
-	GGen_CoordOffset new_top_y = (int32)floor(MIN(MIN(0, new_top_right_y), MIN(new_bottom_left_y, new_bottom_right_y)));
-	GGen_CoordOffset new_bottom_y = (int32) ceil(MAX(MAX(0, new_top_right_y), MAX(new_bottom_left_y, new_bottom_right_y)));
+	GGen_CoordOffset new_top_y = (GGen_CoordOffset) floor(MIN(MIN(0, new_top_right_y), MIN(new_bottom_left_y, new_bottom_right_y)));
+	GGen_CoordOffset new_bottom_y = (GGen_CoordOffset) ceil(MAX(MAX(0, new_top_right_y), MAX(new_bottom_left_y, new_bottom_right_y)));
 	
 	GGen_CoordOffset new_width = new_right_x - new_left_x + 1;
 	GGen_CoordOffset new_height = new_bottom_y - new_top_y + 1;
 	
-	/* Make sure the output dimensions fit into a 16 bit unsigned integer, so we don't have array overflows later */
-	GGen_Script_Assert(new_width < 2 << 16 && new_height < 2 << 16);
+	/* Make sure the output dimensions fit into GGen_Size, so we don't have array overflows later */
+	GGen_Script_Assert(new_width <= (GGen_CoordOffset) GGEN_MAX_SIZE && new_height <= (GGen_CoordOffset) GGEN_MAX_SIZE);
 	
 	/* New origin coordinates */
-	int new_origin_x = -new_left_x;
-	int new_origin_y = -new_top_y;
+	GGen_CoordOffset new_origin_x = -new_left_x;
+	GGen_CoordOffset new_origin_y = -new_top_y;
 	
 	/* Invert the transformation matrix */
 	double inverted_a11 =   a22 / (-(a12 * a21) + a11 * a22);
@@ -1492,16 +3001,16 @@ void GGen_Data_2D::Transform(double a11, double a12, double a21, double a22, boo
 	double inverted_a21 = -(a21 / (-(a12 * a21) + a11 * a22));
 	double inverted_a22 =   a11 / (-(a12 * a21) + a11 * a22);
 
-	int from_x, to_x, from_y, to_y;
+	GGen_CoordOffset from_x, to_x, from_y, to_y;
 	GGen_Index new_length;
 	GGen_Height* new_data;
 	
 	if (preserve_size) {
 		/* Calculate boundaries of the centered box of the original size */
-		from_x = ((signed) new_width - (signed) this->width) / 2;
+		from_x = (new_width - (GGen_CoordOffset) this->width) / 2;
 		to_x = from_x + this->width;
 
-		from_y = ((signed) new_height - (signed) this->height) / 2;
+		from_y = (new_height - (GGen_CoordOffset) this->height) / 2;
 		to_y = from_y + this->height;
 		
 		new_length = this->length;
@@ -1509,7 +3018,7 @@ void GGen_Data_2D::Transform(double a11, double a12, double a21, double a22, boo
 		new_height = this->height;
 		
 		/* Allocate the new array */
-		new_data = new GGen_Height[this->length];
+		new_data = GGen_BufferPool::Allocate(this->length);
 	} else { 
 		/* Using the new image bounding box */
 		from_x = from_y = 0;
@@ -1517,63 +3026,199 @@ void GGen_Data_2D::Transform(double a11, double a12, double a21, double a22, boo
 		to_x = new_width;
 		to_y = new_height;
 		
-		new_length = new_width * new_height;
+		new_length = (GGen_Index) new_width * new_height;
 		
 		/* Allocate the new array */
-		new_data = new GGen_Height[new_length];
+		new_data = GGen_BufferPool::Allocate(new_length);
 	}
+
+	GGen_Script_Assert(new_data != NULL);
+
+	/* The original coordinates are stepped incrementally in 32.32 fixed point numbers */
+	const double fixed_one = 4294967296.0;
+	int64 step_x = (int64) floor(inverted_a11 * fixed_one + 0.5);
+	int64 step_y = (int64) floor(inverted_a21 * fixed_one + 0.5);
+
+	/* Tiles closer than half a tile to the original map are sampled (the samples are clamped to the map) */
+	int64 max_x = ((int64) this->width << 32) - ((int64) 1 << 31);
+	int64 max_y = ((int64) this->height << 32) - ((int64) 1 << 31);
+	int64 min_xy = -((int64) 1 << 31);
+
+	/* Go through the new array in blocks and for every tile look back into the old array (thus we need the inverted function) what is there */
+	GGen_ParallelFor(0, (to_y - from_y + GGEN_TRANSFORM_BLOCK_SIZE - 1) / GGEN_TRANSFORM_BLOCK_SIZE, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index block_y = from; block_y < to; block_y++) {
+			GGen_CoordOffset block_from_y = from_y + (GGen_CoordOffset) block_y * GGEN_TRANSFORM_BLOCK_SIZE;
+			GGen_CoordOffset block_to_y = MIN(block_from_y + GGEN_TRANSFORM_BLOCK_SIZE, to_y);
+
+			for (GGen_CoordOffset block_from_x = from_x; block_from_x < to_x; block_from_x += GGEN_TRANSFORM_BLOCK_SIZE) {
+				GGen_CoordOffset block_to_x = MIN(block_from_x + GGEN_TRANSFORM_BLOCK_SIZE, to_x);
+
+				for (GGen_CoordOffset new_y = block_from_y; new_y < block_to_y; new_y++) {
+					/* Calculate the original coordinates of the first tile in the block row by multiplying the
+					coordinate vector of the desired point by inverted transformation matrix... */
+					int64 x = (int64) floor(((block_from_x - new_origin_x) * inverted_a11 + (new_y - new_origin_y) * inverted_a12) * fixed_one + 0.5);
+					int64 y = (int64) floor(((block_from_x - new_origin_x) * inverted_a21 + (new_y - new_origin_y) * inverted_a22) * fixed_one + 0.5);
+
+					GGen_Height* target = new_data + (new_y - from_y) * (GGen_Index) new_width - from_x;
+
+					/* ... and step to the following ones */
+					for (GGen_CoordOffset new_x = block_from_x; new_x < block_to_x; new_x++, x += step_x, y += step_y) {
+						if (x < min_xy || y < min_xy || x >= max_x || y >= max_y) {
+							/* The "original point" is outside the array => such areas are filled with black */
+							target[new_x] = 0;
+						} else if (filter == GGEN_BOX) {
+							/* The nearest original tile */
+							target[new_x] = this->data[(GGen_Index) ((x + ((int64) 1 << 31)) >> 32) + (GGen_Index) ((y + ((int64) 1 << 31)) >> 32) * this->width];
+						} else {
+							/* Bilinear interpolation of the four surrounding tiles (with 16 bit weights) */
+							int64 clamped_x = MAX(MIN(x, (int64) (this->width - 1) << 32), (int64) 0);
+							int64 clamped_y = MAX(MIN(y, (int64) (this->height - 1) << 32), (int64) 0);
+
+							GGen_Coord left = (GGen_Coord) (clamped_x >> 32);
+							GGen_Coord top = (GGen_Coord) (clamped_y >> 32);
+							GGen_Coord right = MIN(left + 1, this->width - 1);
+							GGen_Coord bottom = MIN(top + 1, this->height - 1);
+							int64 weight_x = (clamped_x >> 16) & 0xFFFF;
+							int64 weight_y = (clamped_y >> 16) & 0xFFFF;
+
+							int64 upper = this->data[left + top * (GGen_Index) this->width] * (65536 - weight_x) + this->data[right + top * (GGen_Index) this->width] * weight_x;
+							int64 lower = this->data[left + bottom * (GGen_Index) this->width] * (65536 - weight_x) + this->data[right + bottom * (GGen_Index) this->width] * weight_x;
+
+							target[new_x] = (GGen_Height) ((upper * (65536 - weight_y) + lower * weight_y + ((int64) 1 << 31)) >> 32);
+						}
+					}
+				}
+			}
+		}
+	});
 	
-	/* Go through the new array and for every tile look back into the old array (thus we need the inverted function) what is there */
-	for (GGen_CoordOffset new_y = from_y; new_y < to_y; new_y++) {
-		/* The second multiplication always stays the same for whole row */
-		GGen_Index y_part_1 = (GGen_Height) ((new_y - new_origin_y) * inverted_a12);
-		GGen_Index y_part_2 = (GGen_Height) ((new_y - new_origin_y) * inverted_a22);
-		
-		/* Offset from pointer from the first cell in the array to the first cell in current row */
-		GGen_CoordOffset y_offset = (new_y - from_y) * new_width;
-		
-		for (GGen_CoordOffset new_x = from_x; new_x < to_x; new_x++) {
-			/* Calculate the original coordinates for the current "new point" by multiplying the coordinate vector of
-			the desired point by inverted transformation matrix */
-			GGen_CoordOffset x = (GGen_CoordOffset) ((new_x - new_origin_x) * inverted_a11) + y_part_1;
-			GGen_CoordOffset y = (GGen_CoordOffset) ((new_x - new_origin_x) * inverted_a21) + y_part_2;
-			
-			/* The original point exists => use its value */
-			if (x >= 0 && y >= 0 && x < this->width && y < this->height) {			
-				new_data[new_x - from_x + y_offset] = this->data[x + y * this->width];
-			} else {
-				/* The "original point" is outside the array => such areas are filled with black */
-				new_data[new_x - from_x + y_offset] = 0;
+	/* Relink and delete the original array data */
+	this->ReplaceData(new_data);
+	this->length = new_length;
+	this->width = new_width;
+	this->height = new_height;
+}
+
+void GGen_Data_2D::Transform(double a11, double a12, double a21, double a22, bool preserve_size)
+{
+	this->TransformFiltered(a11, a12, a21, a22, preserve_size, GGEN_BOX);
+}
+
+/* Blocks smaller than this (in tiles) are rotated by a simple loop */
+#define GGEN_ROTATE_BLOCK_AREA 1024
+
+// Rotates the <from_x, to_x) x <from_y, to_y) block of the target by a quarter turn (counter-clockwise if
+// clockwise == false). The block is recursively split along its longer side, so both source and target are accessed
+// in cache sized pieces whatever the cache size is.
+void Rotate_QuarterBlock(const GGen_Height* source, GGen_Size source_width, GGen_Size source_height, GGen_Height* target, bool clockwise, GGen_Coord from_x, GGen_Coord to_x, GGen_Coord from_y, GGen_Coord to_y){
+	GGen_Size block_width = to_x - from_x;
+	GGen_Size block_height = to_y - from_y;
+
+	if ((GGen_TotalSize) block_width * block_height > GGEN_ROTATE_BLOCK_AREA) {
+		if (block_width >= block_height) {
+			Rotate_QuarterBlock(source, source_width, source_height, target, clockwise, from_x, from_x + block_width / 2, from_y, to_y);
+			Rotate_QuarterBlock(source, source_width, source_height, target, clockwise, from_x + block_width / 2, to_x, from_y, to_y);
+		} else {
+			Rotate_QuarterBlock(source, source_width, source_height, target, clockwise, from_x, to_x, from_y, from_y + block_height / 2);
+			Rotate_QuarterBlock(source, source_width, source_height, target, clockwise, from_x, to_x, from_y + block_height / 2, to_y);
+		}
+
+		return;
+	}
+
+	/* The target is source_height tiles wide. Each target row is read from one source column. */
+	for (GGen_Coord y = from_y; y < to_y; y++) {
+		GGen_Height* target_row = target + (GGen_Index) y * source_height;
+
+		if (clockwise) {
+			/* Target row y is the source column y read from the bottom */
+			const GGen_Height* source_tile = source + (GGen_Index) (source_height - 1 - from_x) * source_width + y;
+			for (GGen_Coord x = from_x; x < to_x; x++, source_tile -= source_width) {
+				target_row[x] = *source_tile;
+			}
+		} else {
+			/* Target row y is the source column (width - 1 - y) read from the top */
+			const GGen_Height* source_tile = source + (GGen_Index) from_x * source_width + (source_width - 1 - y);
+			for (GGen_Coord x = from_x; x < to_x; x++, source_tile += source_width) {
+				target_row[x] = *source_tile;
 			}
 		}
 	}
-	
-	/* Relink and delete the original array data */
-	delete [] this->data;
-	this->data = new_data;
-	this->length = new_length;
-	this->width = new_width;
-	this->height = new_height;
 }
 
-void GGen_Data_2D::Rotate(int32 angle, bool preserve_size)
+void GGen_Data_2D::RotateFiltered(int32 angle, bool preserve_size, GGen_Scaling_Filter filter)
 {
 	/* Clamp the angle to the 0-360 range */
-	angle = angle % 360;
+	angle = ((angle % 360) + 360) % 360;
+
+	if (angle % 90 == 0) {
+		/* Multiples of the right angle only move the tiles around, which can be done exactly */
+		this->RotateQuarterTurns(angle / 90, preserve_size);
+		return;
+	}
 	
 	/* Degrees to radians */
-	double angle_double = (double) angle * 3.14159 / 180;
+	double angle_double = (double) angle * 3.14159265358979 / 180;
 	
 	/* Build the rotation matrix */
-	this->Transform(
+	this->TransformFiltered(
 		cos(angle_double), 
 		sin(angle_double), 
 		-sin(angle_double), 
 		cos(angle_double), 
-		preserve_size
+		preserve_size,
+		filter
 	);
 }
 
+void GGen_Data_2D::RotateQuarterTurns(int32 quarter_turns, bool preserve_size)
+{
+	this->PrepareReplace();
+
+	quarter_turns = ((quarter_turns % 4) + 4) % 4;
+
+	if (quarter_turns == 0) {
+		return;
+	} else if (quarter_turns == 2) {
+		/* Half turn == both flips */
+		this->Flip(GGEN_HORIZONTAL);
+		this->Flip(GGEN_VERTICAL);
+		return;
+	}
+
+	GGen_Height* new_data = GGen_BufferPool::Allocate(this->length);
+
+	GGen_Script_Assert(new_data != NULL);
+
+	/* Three quarter turns counter-clockwise == one quarter turn clockwise */
+	bool clockwise = quarter_turns == 3;
+
+	GGen_ParallelFor(0, (this->width + GGEN_TRANSFORM_BLOCK_SIZE - 1) / GGEN_TRANSFORM_BLOCK_SIZE, [&](GGen_Index from, GGen_Index to){
+		Rotate_QuarterBlock(this->data, this->width, this->height, new_data, clockwise, 0, this->height, (GGen_Coord) (from * GGEN_TRANSFORM_BLOCK_SIZE), (GGen_Coord) MIN(to * GGEN_TRANSFORM_BLOCK_SIZE, this->width));
+	});
+
+	GGen_Size old_width = this->width;
+	GGen_Size old_height = this->height;
+
+	/* Relink and delete the original array data */
+	this->ReplaceData(new_data);
+	this->width = old_height;
+	this->height = old_width;
+
+	if (preserve_size && old_width != old_height) {
+		/* Crop/expand the result to the centered box of the original size */
+		this->ResizeCanvas(old_width, old_height, ((GGen_CoordOffset) old_height - (GGen_CoordOffset) old_width) / 2, ((GGen_CoordOffset) old_width - (GGen_CoordOffset) old_height) / 2);
+	}
+}
+
+#undef GGEN_ROTATE_BLOCK_AREA
+#undef GGEN_TRANSFORM_BLOCK_SIZE
+
+void GGen_Data_2D::Rotate(int32 angle, bool preserve_size)
+{
+	this->RotateFiltered(angle, preserve_size, GGEN_BOX);
+}
+
 void GGen_Data_2D::Shear(int32 horizontal_shear, int32 vertical_shear, bool preserve_size){
 	/* Vertical and horizontal shear == 1 ==> the transformation matrix would be non-invertible */
 	GGen_Script_Assert(horizontal_shear != 1 || vertical_shear != 1);
@@ -1588,13 +3233,32 @@ void GGen_Data_2D::Shear(int32 horizontal_shear, int32 vertical_shear, bool pres
 }
  
  void GGen_Data_2D::Flip(GGen_Direction direction){
-	this->Transform(
-		direction == GGEN_HORIZONTAL ? 1 : -1, 
-		0,
-		0,
-		direction == GGEN_VERTICAL ? 1 : -1,
-		false
-	);
+	this->PrepareWrite();
+
+	if (direction == GGEN_HORIZONTAL) {
+		/* Flipping along the horizontal axis swaps the rows */
+		GGen_ParallelFor(0, this->height / 2, [&](GGen_Index from, GGen_Index to){
+			GGen_Height* row_buffer = new GGen_Height[this->width];
+
+			for (GGen_Index y = from; y < to; y++) {
+				GGen_Height* upper_row = this->data + y * (GGen_Index) this->width;
+				GGen_Height* lower_row = this->data + (this->height - 1 - y) * (GGen_Index) this->width;
+
+				memcpy(row_buffer, upper_row, sizeof(GGen_Height) * this->width);
+				memcpy(upper_row, lower_row, sizeof(GGen_Height) * this->width);
+				memcpy(lower_row, row_buffer, sizeof(GGen_Height) * this->width);
+			}
+
+			delete [] row_buffer;
+		});
+	} else {
+		/* Flipping along the vertical axis reverses each row */
+		GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+			for (GGen_Index y = from; y < to; y++) {
+				std::reverse(this->data + y * (GGen_Index) this->width, this->data + (y + 1) * (GGen_Index) this->width);
+			}
+		});
+	}
 }
 
 // helper data structure for the following algorithm
@@ -1646,6 +3310,8 @@ public:
 void GGen_Data_2D::FillPolygon(GGen_Path* path, GGen_Height value){
 	GGen_Script_Assert(path != NULL);
 
+	this->PrepareWrite();
+
 	/* Create a full list of all non-horizontal edges (this is line algorithm, we can skip horizontal edges) */
 	list<GGen_FillPolygon_DownwardsEdge*> edges;
 	for (GGen_Path::Iterator i = path->points.begin(); i != path->points.end();) {
@@ -1738,7 +3404,7 @@ void GGen_Data_2D::FillPolygon(GGen_Path* path, GGen_Height value){
 
 				/* If we are in the "odd section" (between even and odd intersection) */
 				if (odd) {
-					this->data[x + this->width * y] = value;
+					this->data[x + (GGen_Index) this->width * y] = value;
 				}
 			}
 		}
@@ -1808,6 +3474,9 @@ void GGen_Data_2D::StrokePath(GGen_Path* path, GGen_Data_1D* brush, GGen_Distanc
 	GGen_Script_Assert(path != NULL);
 	GGen_Script_Assert(brush != NULL);
 	GGen_Script_Assert(radius > 0);	
+	GGen_Script_Assert(radius <= 0xFFFF);
+
+	this->PrepareWrite();
 
 	/* This is quite typical divide-and-conquer algorithm. The map will be divided into four quads. The most adjacent
 	 * path segment will be calculated for each of it corners. If the quad has all four corners adjacent to the same
@@ -1821,7 +3490,7 @@ void GGen_Data_2D::StrokePath(GGen_Path* path, GGen_Data_1D* brush, GGen_Distanc
 	vector<GGen_Point> segmentArray = vector<GGen_Point>(path->points.begin(), path->points.end());
 
 	/* Distance from each tile to the nearest path segment. Tiles, that were not calculated yet hold GGEN_INVALID_HEIGHT. */
-	GGen_Height* segmentDistances = new GGen_Height[this->length];
+	GGen_Height* segmentDistances = GGen_BufferPool::Allocate(this->length);
 
 	/* Index of the nearest path segment (indexed from 0 from the beginning of the path). */
 	uint32* segmentIndices = new uint32[this->length];
@@ -1864,7 +3533,7 @@ void GGen_Data_2D::StrokePath(GGen_Path* path, GGen_Data_1D* brush, GGen_Distanc
 		/* For every corner of the current quad... */
 		for(int cornerNumber = 0; cornerNumber < 4; cornerNumber++){
 			GGen_Point currentPoint = cornerPoints[cornerNumber];
-			GGen_Index currentIndex = currentPoint.x + this->width * currentPoint.y;
+			GGen_Index currentIndex = currentPoint.x + (GGen_Index) this->width * currentPoint.y;
 			
 			if(segmentDistances[currentIndex] == GGEN_INVALID_HEIGHT){				
 				/* Calculate distance to the closest path segment */
@@ -1950,7 +3619,7 @@ void GGen_Data_2D::StrokePath(GGen_Path* path, GGen_Data_1D* brush, GGen_Distanc
 				
 		if(!isSubdivisionNeeded){
 			/* Further subdivision is not needed, we know which segment to use to fill whole quad. */
-			uint32 currentSegmentIndex = segmentIndices[currentQuad.x + this->width * currentQuad.y];
+			uint32 currentSegmentIndex = segmentIndices[currentQuad.x + (GGen_Index) this->width * currentQuad.y];
 			GGen_Point point1 = segmentArray[currentSegmentIndex];
 			GGen_Point point2 = segmentArray[currentSegmentIndex + 1];
 
@@ -1961,8 +3630,8 @@ void GGen_Data_2D::StrokePath(GGen_Path* path, GGen_Data_1D* brush, GGen_Distanc
 					
 					GGen_Distance currentDistance = GGen_StrokePath_GetDistanceToSegment(point1, point2, GGen_Point(x, y));
 
-					segmentDistances[currentQuad.x + offsetX + this->width * (currentQuad.y + offsetY)] = currentDistance;
-					segmentIndices[currentQuad.x + offsetX + this->width * (currentQuad.y + offsetY)] = currentSegmentIndex;
+					segmentDistances[currentQuad.x + offsetX + (GGen_Index) this->width * (currentQuad.y + offsetY)] = currentDistance;
+					segmentIndices[currentQuad.x + offsetX + (GGen_Index) this->width * (currentQuad.y + offsetY)] = currentSegmentIndex;
 				}
 			}
 		}
@@ -1990,102 +3659,159 @@ void GGen_Data_2D::StrokePath(GGen_Path* path, GGen_Data_1D* brush, GGen_Distanc
 	}
 
 	/* Distance to all tiles have been calculated, map values into the main data array according to the brush. */ 
+	GGen_CompiledProfile compiled_brush(brush, (GGen_Size) radius);
+
 	for(GGen_Coord y = 0; y < this->height; y++){
 		for(GGen_Coord x = 0; x < this->width; x++){
-			GGen_Distance currentDistance = segmentDistances[x + this->width * y];
+			GGen_Distance currentDistance = segmentDistances[x + (GGen_Index) this->width * y];
 			
 			if(currentDistance < radius){
 				/* The distance is smaller than brush radius - get value form brush. */
-				this->data[x + this->width * y] = brush->GetValueInterpolated(currentDistance, radius);
+				this->data[x + (GGen_Index) this->width * y] = compiled_brush[(GGen_Coord) currentDistance];
 			}
 			else if(fill_outside){
 				/* The distance is larger than brush radius - use the outermost values from the brush (if asked to). */
-				this->data[x + this->width * y] = brush->data[brush->length - 1];
+				this->data[x + (GGen_Index) this->width * y] = brush->data[brush->length - 1];
 			}
 		}
 	}
 
-	delete [] segmentDistances;
+	GGen_BufferPool::Release(segmentDistances);
 	delete [] segmentIndices;
 }
 
-void GGen_Data_2D::FloodFillBase(GGen_Coord start_x, GGen_Coord start_y, GGen_Height fill_value, GGen_Comparison_Mode mode, GGen_Height threshold, bool select_only){
-	GGen_Script_Assert(start_x < this->width);
-	GGen_Script_Assert(start_y < this->height);		
+// Returns true if the value matches the arithmetic condition (the condition is resolved at compile time).
+template <GGen_Comparison_Mode mode>
+inline bool FloodFill_Matches(GGen_Height value, GGen_Height threshold){
+	switch (mode) {
+		case GGEN_EQUAL_TO: return value == threshold;
+		case GGEN_NOT_EQUAL_TO: return value != threshold;
+		case GGEN_LESS_THAN: return value < threshold;
+		case GGEN_GREATER_THAN: return value > threshold;
+		case GGEN_LESS_THAN_OR_EQUAL_TO: return value <= threshold;
+		case GGEN_GREATER_THAN_OR_EQUAL_TO: return value >= threshold;
+	}
+
+	return false;
+}
+
+// Bit mask of already filled tiles (one bit per tile, 32 tiles per word).
+inline bool FloodFill_IsFilled(const uint32* mask, GGen_Index i){
+	return (mask[i >> 5] >> (i & 31)) & 1;
+}
 
-	/* Bordering (potential spread) points will be stored in queue */
-	queue<GGen_Point> queue;
+// Marks tiles from (inclusive) to to (exclusive) as filled, whole words at once where possible.
+void FloodFill_SetFilled(uint32* mask, GGen_Index from, GGen_Index to){
+	while (from < to && (from & 31) != 0) {
+		mask[from >> 5] |= 1u << (from & 31);
+		from++;
+	}
 
-	/* Add the starting point to the queue */
-	queue.push(GGen_Point(start_x, start_y));
+	while (from + 32 <= to) {
+		mask[from >> 5] = 0xFFFFFFFF;
+		from += 32;
+	}
 
-	/* Already processed points will be held in a simple bit mask to prevent entering infinite loop */
-	vector<bool> mask(this->length, false);
+	while (from < to) {
+		mask[from >> 5] |= 1u << (from & 31);
+		from++;
+	}
+}
 
-	/* Keep filling until we have what to fill */
-	while (!queue.empty()) {
-		/* Pick one tile from top of the queue */
-		GGen_Point current = queue.front();
-		queue.pop();
+// Scanline flood fill. Fills whole horizontal spans of matching tiles at once and looks for new spans only in the
+// rows directly above and below each span.
+template <GGen_Comparison_Mode mode>
+void FloodFill_Scanline(GGen_Data_2D* map, GGen_Coord start_x, GGen_Coord start_y, GGen_Height fill_value, GGen_Height threshold, bool select_only, uint32* mask){
+	GGen_Height* data = map->data;
+	GGen_Size width = map->width;
+	GGen_Size height = map->height;
 
-		GGen_Height currentValue = this->data[current.x + current.y * this->width];
+	#define FLOODFILL_FILLABLE(x, y) (!FloodFill_IsFilled(mask, (x) + (y) * (GGen_Index) width) && FloodFill_Matches<mode>(data[(x) + (y) * (GGen_Index) width], threshold))
 
-		/* Do not process one tile more than once */
-		if(mask[current.x + current.y * this->width]) continue;
+	/* One seed tile for each span waiting to be filled */
+	stack<GGen_Point> seeds;
 
-		/* Mark the current tile as processed */
-		mask[current.x + current.y * this->width] = true;
+	seeds.push(GGen_Point(start_x, start_y));
 
-		/* Check if the spread condition is valid for current tile */
-		if (
-			(mode == GGEN_EQUAL_TO && currentValue != threshold) ||
-			(mode == GGEN_NOT_EQUAL_TO && currentValue == threshold) ||
-			(mode == GGEN_LESS_THAN && currentValue >= threshold) ||
-			(mode == GGEN_GREATER_THAN && currentValue <= threshold) ||
-			(mode == GGEN_LESS_THAN_OR_EQUAL_TO && currentValue > threshold) ||
-			(mode == GGEN_GREATER_THAN_OR_EQUAL_TO && currentValue < threshold))
-		{
-			/* The condition failed -> skip this tile */
+	while (!seeds.empty()) {
+		GGen_Point seed = seeds.top();
+		seeds.pop();
 
-			/* Fill the failed area with 0 in selection mode */
-			if(select_only){			
-				this->data[current.x + current.y * this->width] = 0;
-			}
+		GGen_Coord y = (GGen_Coord) seed.y;
 
-			continue;
-		} 
+		/* The span might have been filled from another seed meanwhile */
+		if (!FLOODFILL_FILLABLE(seed.x, y)) continue;
 
-		/* The condition is valid -> fill the current tile */
-		this->data[current.x + current.y * this->width] = fill_value;
+		/* Find ends of the span */
+		GGen_Coord left = (GGen_Coord) seed.x;
+		GGen_Coord right = (GGen_Coord) seed.x;
 
-		/* Add surrounding tiles to the fill queue (as long as they are within mao borders and are yet unworked) */
-		if (current.x > 0 && !mask[current.x - 1 + current.y * this->width]) {
-			queue.push(GGen_Point(current.x - 1, current.y));
-		}
+		while (left > 0 && FLOODFILL_FILLABLE(left - 1, y)) left--;
+		while (right + 1 < width && FLOODFILL_FILLABLE(right + 1, y)) right++;
 
-		if (current.y > 0 && !mask[current.x + (current.y - 1) * this->width]) {
-			queue.push(GGen_Point(current.x, current.y - 1));
-		}
+		/* Fill it */
+		FloodFill_SetFilled(mask, left + y * (GGen_Index) width, right + 1 + y * (GGen_Index) width);
 
-		if (current.x < this->width && !mask[current.x + 1 + current.y * this->width]) {
-			queue.push(GGen_Point(current.x + 1, current.y));
-		}
-		
-		if (current.y < this->height && !mask[current.x + (current.y + 1) * this->width]) {
-			queue.push(GGen_Point(current.x, current.y + 1));
+		if (!select_only) {
+			for (GGen_Coord x = left; x <= right; x++) {
+				data[x + y * (GGen_Index) width] = fill_value;
+			}
 		}
-	}
 
-	/* Fill the unworked area with 0 in selection mode */
-	if(select_only){			
-		for (GGen_Coord y = 0; y < this->height; y++) {
-			for (GGen_Coord x = 0; x < this->width; x++) {
-				if(!mask[x + y * this->width]){
-					this->data[x + y * this->width] = 0;
+		/* Add one seed for each fillable span touching the current span from above or below */
+		for (int direction = -1; direction <= 1; direction += 2) {
+			if ((direction < 0 && y == 0) || (direction > 0 && y + 1 >= height)) continue;
+
+			GGen_Coord neighbor_y = (GGen_Coord) (y + direction);
+			bool in_span = false;
+
+			for (GGen_Coord x = left; x <= right; x++) {
+				bool fillable = FLOODFILL_FILLABLE(x, neighbor_y);
+
+				if (fillable && !in_span) {
+					seeds.push(GGen_Point(x, neighbor_y));
 				}
-			}	
+
+				in_span = fillable;
+			}
 		}
 	}
+
+	#undef FLOODFILL_FILLABLE
+}
+
+void GGen_Data_2D::FloodFillBase(GGen_Coord start_x, GGen_Coord start_y, GGen_Height fill_value, GGen_Comparison_Mode mode, GGen_Height threshold, bool select_only){
+	GGen_Script_Assert(start_x < this->width);
+	GGen_Script_Assert(start_y < this->height);		
+
+	this->PrepareWrite();
+
+	/* Already filled tiles are held in a bit mask (the fill value itself might match the condition) */
+	uint32* mask = new uint32[(this->length + 31) / 32];
+
+	GGen_Script_Assert(mask != NULL);
+
+	memset(mask, 0, ((this->length + 31) / 32) * sizeof(uint32));
+
+	switch (mode) {
+		case GGEN_EQUAL_TO: FloodFill_Scanline<GGEN_EQUAL_TO>(this, start_x, start_y, fill_value, threshold, select_only, mask); break;
+		case GGEN_NOT_EQUAL_TO: FloodFill_Scanline<GGEN_NOT_EQUAL_TO>(this, start_x, start_y, fill_value, threshold, select_only, mask); break;
+		case GGEN_LESS_THAN: FloodFill_Scanline<GGEN_LESS_THAN>(this, start_x, start_y, fill_value, threshold, select_only, mask); break;
+		case GGEN_GREATER_THAN: FloodFill_Scanline<GGEN_GREATER_THAN>(this, start_x, start_y, fill_value, threshold, select_only, mask); break;
+		case GGEN_LESS_THAN_OR_EQUAL_TO: FloodFill_Scanline<GGEN_LESS_THAN_OR_EQUAL_TO>(this, start_x, start_y, fill_value, threshold, select_only, mask); break;
+		case GGEN_GREATER_THAN_OR_EQUAL_TO: FloodFill_Scanline<GGEN_GREATER_THAN_OR_EQUAL_TO>(this, start_x, start_y, fill_value, threshold, select_only, mask); break;
+	}
+
+	/* In selection mode, the filled area becomes 1 and the rest of the map 0 */
+	if (select_only) {
+		GGen_ParallelFor(0, this->length, [&](GGen_Index from, GGen_Index to){
+			for (GGen_Index i = from; i < to; i++) {
+				this->data[i] = FloodFill_IsFilled(mask, i) ? 1 : 0;
+			}
+		});
+	}
+
+	delete [] mask;
 }
 
 void GGen_Data_2D::FloodFill(GGen_Coord start_x, GGen_Coord start_y, GGen_Height fill_value, GGen_Comparison_Mode mode, GGen_Height threshold){
@@ -2106,6 +3832,8 @@ GGen_Height GGen_Data_2D::GetValueOnPathBase(GGen_Path* path, bool max){
 	GGen_Script_Assert(path != NULL);
 	GGen_Script_Assert(path->points.size() > 1);
 
+	this->FlushOperations();
+
 	GGen_Height extreme = max ? GGEN_MIN_HEIGHT : GGEN_MAX_HEIGHT;
 
 	/* For every line segment do... */
@@ -2179,7 +3907,7 @@ GGen_Height GGen_Data_2D::GetValueOnPathBase(GGen_Path* path, bool max){
 			/* The first point */
 			if(x > 0 && x < this->width && y > 0 && y < height){
 				/* X coordinate must be rounded */
-				GGen_Height current = this->data[(GGen_CoordOffset) (x + 0.5) + y * this->width]; 
+				GGen_Height current = this->data[(GGen_CoordOffset) (x + 0.5) + y * (GGen_Index) this->width]; 
 
 				if((max && extreme < current) || (!max && extreme > current)){
 					extreme = current;
@@ -2193,7 +3921,7 @@ GGen_Height GGen_Data_2D::GetValueOnPathBase(GGen_Path* path, bool max){
 
 				if(x > 0 && x < this->width && (GGen_CoordOffset) y > 0 && (GGen_CoordOffset) y < height){
 					/* X coordinate must be rounded */
-					GGen_Height current = this->data[(GGen_CoordOffset) (x + 0.5) + y * this->width]; 
+					GGen_Height current = this->data[(GGen_CoordOffset) (x + 0.5) + y * (GGen_Index) this->width]; 
 
 					if((max && extreme < current) || (!max && extreme > current)){
 						extreme = current;
@@ -2226,7 +3954,7 @@ void GGen_Data_2D::ExpandShrinkDirectionBase(GGen_Distance distance, GGen_Direct
 	GGen_Script_Assert(distance > 0);
 	GGen_Script_Assert(direction == GGEN_VERTICAL || distance < this->width);
 	GGen_Script_Assert(direction == GGEN_HORIZONTAL || distance < this->height);
-	
+
 	/* shrinking = inverse expanding */
 	if(shrink){
 		this->Invert();
@@ -2235,8 +3963,11 @@ void GGen_Data_2D::ExpandShrinkDirectionBase(GGen_Distance distance, GGen_Direct
 		this->Add(1);
 	}
 
+	/* Also evaluates the inversion, the loops below read the data directly */
+	this->PrepareReplace();
+
 	/* Allocate the new array */
-	GGen_Height* new_data = new GGen_Height[this->length];
+	GGen_Height* new_data = GGen_BufferPool::Allocate(this->length);
 
 	GGen_Script_Assert(new_data != NULL);
 
@@ -2246,10 +3977,10 @@ void GGen_Data_2D::ExpandShrinkDirectionBase(GGen_Distance distance, GGen_Direct
 		for (GGen_Coord y = 0; y < height; y++) {
 			/* Prefill the window with value of the left edge + n leftmost values (where n is radius) */
 			GGen_Size window_size = distance * 2 + 1;
-			GGen_Height window_value = (GGen_Height) (this->data[this->width * y] > 0) * distance;
+			GGen_ExtHeight window_value = (GGen_Height) (this->data[(GGen_Index) this->width * y] > 0) * distance;
 
 			for (GGen_Distance x = 0; x < distance; x++) {
-				window_value += (GGen_Height) (this->data[x + this->width * y] > 0);
+				window_value += (GGen_Height) (this->data[x + (GGen_Index) this->width * y] > 0);
 			}
 
 			/* In every step shift the window one tile to the right  (= subtract its leftmost cell and add
@@ -2257,25 +3988,25 @@ void GGen_Data_2D::ExpandShrinkDirectionBase(GGen_Distance distance, GGen_Direct
 			for (GGen_Coord x = 0; x < this->width; x++) {
 				/* If the window is approaching right border, use the rightmost value as fill. */
 				if (x < distance) {
-					window_value += (GGen_Height) (this->data[x + distance + this->width * y] > 0) - (GGen_Height) (this->data[this->width * y] > 0);
+					window_value += (GGen_Height) (this->data[x + distance + (GGen_Index) this->width * y] > 0) - (GGen_Height) (this->data[(GGen_Index) this->width * y] > 0);
 				} else if (x + distance < this->width) {
-					window_value += (GGen_Height) (this->data[x + distance + this->width * y] > 0) - (GGen_Height) (this->data[x - distance + this->width * y] > 0);
+					window_value += (GGen_Height) (this->data[x + distance + (GGen_Index) this->width * y] > 0) - (GGen_Height) (this->data[x - distance + (GGen_Index) this->width * y] > 0);
 				} else {
-					window_value += (GGen_Height) (this->data[this->width - 1 + this->width * y] > 0) - (GGen_Height) (this->data[x - distance + this->width * y] > 0);
+					window_value += (GGen_Height) (this->data[this->width - 1 + (GGen_Index) this->width * y] > 0) - (GGen_Height) (this->data[x - distance + (GGen_Index) this->width * y] > 0);
 				}
 
 				/* Set the value of current tile to 1 as long as there is at least one value greater than zero in the current window. */
-				new_data[x + this->width * y] = (GGen_Height) (window_value > 0) * (shrink ? -1 : 1);
+				new_data[x + (GGen_Index) this->width * y] = (GGen_Height) (window_value > 0) * (shrink ? -1 : 1);
 			}
 		}
 	} else { /* vertical */
 		for (GGen_Coord x = 0; x < this->width; x++) {
 			/* Prefill the window with value of the left edge + n topmost values (where n is radius) */
 			GGen_Size window_size = distance * 2 + 1;
-			GGen_Height window_value = (GGen_Height) (this->data[x] > 0) * distance;
+			GGen_ExtHeight window_value = (GGen_Height) (this->data[x] > 0) * distance;
 
 			for (GGen_Distance y = 0; y < distance; y++) {
-				window_value += (GGen_Height) (this->data[x + y * this->width] > 0);
+				window_value += (GGen_Height) (this->data[x + y * (GGen_Index) this->width] > 0);
 			}
 
 			/* In every step shift the window one tile to the bottom  (= subtract its topmost cell and add
@@ -2283,22 +4014,21 @@ void GGen_Data_2D::ExpandShrinkDirectionBase(GGen_Distance distance, GGen_Direct
 			for (GGen_Coord y = 0; y < this->height; y++) {
 				/* If the window is approaching right border, use the rightmost value as fill. */
 				if (y < distance) {
-					window_value += (GGen_Height) (this->data[x + (y + distance) * this->width] > 0) - (GGen_Height) (this->data[x] > 0);
+					window_value += (GGen_Height) (this->data[x + (y + distance) * (GGen_Index) this->width] > 0) - (GGen_Height) (this->data[x] > 0);
 				} else if (y + distance < height) {
-					window_value += (GGen_Height) (this->data[x + (y + distance) * this->width] > 0) - (GGen_Height) (this->data[x + (y - distance) * this->width] > 0);
+					window_value += (GGen_Height) (this->data[x + (y + distance) * (GGen_Index) this->width] > 0) - (GGen_Height) (this->data[x + (y - distance) * (GGen_Index) this->width] > 0);
 				} else {
-					window_value += (GGen_Height) (this->data[x + (this->height - 1) * this->width] > 0) - (GGen_Height) (this->data[x + (y - distance) * this->width] > 0);
+					window_value += (GGen_Height) (this->data[x + (this->height - 1) * (GGen_Index) this->width] > 0) - (GGen_Height) (this->data[x + (y - distance) * (GGen_Index) this->width] > 0);
 				}
 
 				/* Set the value of current tile to 1 as long as there is at least one value greater than zero in the current window. */
-				new_data[x + this->width * y] = (GGen_Height) (window_value > 0) * (shrink ? -1 : 1);
+				new_data[x + (GGen_Index) this->width * y] = (GGen_Height) (window_value > 0) * (shrink ? -1 : 1);
 			}
 		}
 	}	
 
 	/* Relink and delete the original array data */
-	delete [] this->data;
-	this->data = new_data;	
+	this->ReplaceData(new_data);	
 
 	/* Shift the values from  range <-1, 0> to <0, 1> (we were working on an inverse) */
 	if(shrink) this->Add(1);
@@ -2338,8 +4068,199 @@ void GGen_Data_2D::Shrink(GGen_Distance distance){
 	this->ShrinkDirection(distance, GGEN_VERTICAL);
 }
 
+// Returns true if the value matches the arithmetic condition.
+inline bool DistanceMap_Matches(GGen_Height value, GGen_Comparison_Mode mode, GGen_Height threshold){
+	switch (mode) {
+		case GGEN_EQUAL_TO: return value == threshold;
+		case GGEN_NOT_EQUAL_TO: return value != threshold;
+		case GGEN_LESS_THAN: return value < threshold;
+		case GGEN_GREATER_THAN: return value > threshold;
+		case GGEN_LESS_THAN_OR_EQUAL_TO: return value <= threshold;
+		case GGEN_GREATER_THAN_OR_EQUAL_TO: return value >= threshold;
+	}
+
+	return false;
+}
+
+/* Squared distance of tiles with no matching tile within reach */
+#define GGEN_DISTANCE_INFINITY 0xFFFFFFFFFFFFFFFFULL
+
+/* Squared distance used for parabolas of columns with no matching tile (large enough to never win, small enough to
+ * keep the intersections finite) */
+#define GGEN_DISTANCE_MAP_FAR 1e20
+
+/* Number of columns gathered together by the column pass of the distance transform */
+#define GGEN_DISTANCE_MAP_STRIP_WIDTH 16
+
+void GGen_Data_2D::DistanceTransform(GGen_Comparison_Mode mode, GGen_Height threshold, uint64* squared_distances)
+{
+	this->FlushOperations();
+
+	/* Pass 1: distance to the nearest matching tile in the same row */
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			GGen_Height* row = this->data + y * (GGen_Index) this->width;
+			uint64* distances = squared_distances + y * (GGen_Index) this->width;
+
+			/* Distance to the nearest matching tile on the left... */
+			GGen_CoordOffset last = -1;
+
+			for (GGen_Coord x = 0; x < this->width; x++) {
+				if (DistanceMap_Matches(row[x], mode, threshold)) last = x;
+
+				distances[x] = last < 0 ? GGEN_DISTANCE_INFINITY : x - last;
+			}
+
+			/* ... and on the right */
+			last = -1;
+
+			for (GGen_Coord x = this->width; x-- > 0;) {
+				if (distances[x] == 0) last = x;
+
+				if (last >= 0 && (GGen_Distance) (last - x) < distances[x]) distances[x] = last - x;
+				if (distances[x] != GGEN_DISTANCE_INFINITY) distances[x] *= distances[x];
+			}
+		}
+	});
+
+	/* Pass 2: each column is a lower envelope of parabolas rooted in the column tiles (each parabola's height is
+	 * the squared row distance of its tile). Felzenszwalb and Huttenlocher, "Distance Transforms of Sampled Functions". */
+	GGen_ParallelFor(0, (this->width + GGEN_DISTANCE_MAP_STRIP_WIDTH - 1) / GGEN_DISTANCE_MAP_STRIP_WIDTH, [&](GGen_Index from, GGen_Index to){
+		/* Columns of the current strip (transposed, so each column is contiguous) */
+		double* columns = new double[(GGen_Index) this->height * GGEN_DISTANCE_MAP_STRIP_WIDTH];
+
+		/* Roots of the parabolas forming the lower envelope and borders between them */
+		GGen_CoordOffset* roots = new GGen_CoordOffset[this->height];
+		double* borders = new double[this->height + 1];
+
+		for (GGen_Index strip = from; strip < to; strip++) {
+			GGen_Coord strip_x = (GGen_Coord) (strip * GGEN_DISTANCE_MAP_STRIP_WIDTH);
+			GGen_Size strip_width = (GGen_Size) MIN(GGEN_DISTANCE_MAP_STRIP_WIDTH, this->width - strip_x);
+
+			for (GGen_Coord y = 0; y < this->height; y++) {
+				uint64* distances = squared_distances + strip_x + y * (GGen_Index) this->width;
+
+				for (GGen_Size i = 0; i < strip_width; i++) {
+					columns[y + i * this->height] = distances[i] == GGEN_DISTANCE_INFINITY ? GGEN_DISTANCE_MAP_FAR : (double) distances[i];
+				}
+			}
+
+			for (GGen_Size i = 0; i < strip_width; i++) {
+				double* f = columns + i * this->height;
+
+				/* Build the lower envelope */
+				int k = 0;
+				roots[0] = 0;
+				borders[0] = -GGEN_DISTANCE_MAP_FAR;
+				borders[1] = GGEN_DISTANCE_MAP_FAR;
+
+				for (GGen_CoordOffset q = 1; q < this->height; q++) {
+					double s;
+
+					/* Drop the parabolas hidden by the new one (the first border is lower than any intersection) */
+					while (true) {
+						GGen_CoordOffset v = roots[k];
+						s = ((f[q] + (double) q * q) - (f[v] + (double) v * v)) / (2.0 * (q - v));
+
+						if (s > borders[k]) break;
+
+						k--;
+					}
+
+					k++;
+					roots[k] = q;
+					borders[k] = s;
+					borders[k + 1] = GGEN_DISTANCE_MAP_FAR;
+				}
+
+				/* Read the envelope */
+				k = 0;
+
+				for (GGen_CoordOffset q = 0; q < this->height; q++) {
+					while (borders[k + 1] < q) k++;
+
+					GGen_CoordOffset v = roots[k];
+					double distance = (double) (q - v) * (q - v) + f[v];
+
+					squared_distances[strip_x + i + q * (GGen_Index) this->width] = distance >= GGEN_DISTANCE_INFINITY ? GGEN_DISTANCE_INFINITY : (uint64) distance;
+				}
+			}
+		}
+
+		delete [] columns;
+		delete [] roots;
+		delete [] borders;
+	});
+}
+
+#undef GGEN_DISTANCE_MAP_FAR
+#undef GGEN_DISTANCE_MAP_STRIP_WIDTH
+
+void GGen_Data_2D::DistanceMap(GGen_Comparison_Mode mode, GGen_Height threshold)
+{
+	this->PrepareWrite();
+
+	uint64* squared_distances = new uint64[this->length];
+
+	GGen_Script_Assert(squared_distances != NULL);
+
+	this->DistanceTransform(mode, threshold, squared_distances);
+
+	GGen_ParallelFor(0, this->length, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			double distance = floor(sqrt((double) squared_distances[i]) + 0.5);
+
+			this->data[i] = (GGen_Height) MIN(distance, (double) GGEN_MAX_HEIGHT);
+		}
+	});
+
+	delete [] squared_distances;
+}
+
+void GGen_Data_2D::ExpandShrinkCircularBase(GGen_Distance distance, bool shrink)
+{
+	this->PrepareWrite();
+
+	uint64* squared_distances = new uint64[this->length];
+
+	GGen_Script_Assert(squared_distances != NULL);
+
+	/* shrinking = expanding of the non-positive area */
+	this->DistanceTransform(shrink ? GGEN_LESS_THAN_OR_EQUAL_TO : GGEN_GREATER_THAN, 0, squared_distances);
+
+	uint64 max_distance = (uint64) distance * distance;
+
+	GGen_ParallelFor(0, this->length, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			bool within = squared_distances[i] != GGEN_DISTANCE_INFINITY && squared_distances[i] <= max_distance;
+
+			this->data[i] = (GGen_Height) (within != shrink);
+		}
+	});
+
+	delete [] squared_distances;
+}
+
+void GGen_Data_2D::ExpandCircular(GGen_Distance distance)
+{
+	GGen_Script_Assert(distance > 0);
+
+	this->ExpandShrinkCircularBase(distance, false);
+}
+
+void GGen_Data_2D::ShrinkCircular(GGen_Distance distance)
+{
+	GGen_Script_Assert(distance > 0);
+
+	this->ExpandShrinkCircularBase(distance, true);
+}
+
+#undef GGEN_DISTANCE_INFINITY
+
 void GGen_Data_2D::Outline(GGen_Comparison_Mode mode, GGen_Height threshold, GGen_Outline_Mode outlineMode)
 {
+	this->PrepareReplace();
+
 	/* Outside border = inside border with inverted condition */
 	if(outlineMode == GGEN_OUTSIDE){
 		outlineMode = GGEN_INSIDE;
@@ -2355,62 +4276,69 @@ void GGen_Data_2D::Outline(GGen_Comparison_Mode mode, GGen_Height threshold, GGe
 	}
 
 	/* Allocate the new array */
-	GGen_Height* new_data = new GGen_Height[this->length];
+	GGen_Height* new_data = GGen_BufferPool::Allocate(this->length);
 
 	GGen_Script_Assert(new_data != NULL);
 	
 	/* First generate the border in horizontal direction... */
-	for(GGen_Coord y = 0; y < this->height; y++){
-
-		/* This value stays constant for all cells in the row. */
-		GGen_Index yIndexOffset = y * this->width;
-
-		/* A cell is part of a border, if it matches the condition and at least one of its neighbors doesn't. */
-		for(GGen_Coord x = 1; x < this->width - 1; x++){
-			GGen_Height prevValue = this->data[x - 1 + yIndexOffset];
-			GGen_Height currentValue = this->data[x + yIndexOffset];
-			GGen_Height nextValue = this->data[x + 1 + yIndexOffset];
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+
+			/* This value stays constant for all cells in the row. */
+			GGen_Index yIndexOffset = y * (GGen_Index) this->width;
+
+			/* The edge cells have only one horizontal neighbor (the array might be reused, so they must be written anyway) */
+			new_data[yIndexOffset] = 0;
+			new_data[this->width - 1 + yIndexOffset] = 0;
+
+			/* A cell is part of a border, if it matches the condition and at least one of its neighbors doesn't. */
+			for(GGen_Coord x = 1; x < this->width - 1; x++){
+				GGen_Height prevValue = this->data[x - 1 + yIndexOffset];
+				GGen_Height currentValue = this->data[x + yIndexOffset];
+				GGen_Height nextValue = this->data[x + 1 + yIndexOffset];
+
+				switch(mode){
+					case GGEN_EQUAL_TO: currentValue = (GGen_Height) ((currentValue == threshold) && (!(nextValue == threshold) || !(prevValue == threshold))); break;
+					case GGEN_NOT_EQUAL_TO: currentValue = (GGen_Height) ((currentValue != threshold) && (!(nextValue != threshold) || !(prevValue != threshold))); break;
+					case GGEN_GREATER_THAN: currentValue = (GGen_Height) ((currentValue > threshold) && (!(nextValue > threshold) || !(prevValue > threshold))); break;
+					case GGEN_GREATER_THAN_OR_EQUAL_TO: currentValue = (GGen_Height) ((currentValue >= threshold) && (!(nextValue >= threshold) || !(prevValue >= threshold))); break;
+					case GGEN_LESS_THAN: currentValue = (GGen_Height) ((currentValue < threshold) && (!(nextValue < threshold) || !(prevValue < threshold))); break;
+					case GGEN_LESS_THAN_OR_EQUAL_TO: currentValue = (GGen_Height) ((currentValue <= threshold) && (!(nextValue <= threshold) || !(prevValue <= threshold))); break;
+				}
 
-			switch(mode){
-				case GGEN_EQUAL_TO: currentValue = (GGen_Height) ((currentValue == threshold) && (!(nextValue == threshold) || !(prevValue == threshold))); break;
-				case GGEN_NOT_EQUAL_TO: currentValue = (GGen_Height) ((currentValue != threshold) && (!(nextValue != threshold) || !(prevValue != threshold))); break;
-				case GGEN_GREATER_THAN: currentValue = (GGen_Height) ((currentValue > threshold) && (!(nextValue > threshold) || !(prevValue > threshold))); break;
-				case GGEN_GREATER_THAN_OR_EQUAL_TO: currentValue = (GGen_Height) ((currentValue >= threshold) && (!(nextValue >= threshold) || !(prevValue >= threshold))); break;
-				case GGEN_LESS_THAN: currentValue = (GGen_Height) ((currentValue < threshold) && (!(nextValue < threshold) || !(prevValue < threshold))); break;
-				case GGEN_LESS_THAN_OR_EQUAL_TO: currentValue = (GGen_Height) ((currentValue <= threshold) && (!(nextValue <= threshold) || !(prevValue <= threshold))); break;
+				new_data[x + yIndexOffset] = currentValue;
 			}
-
-			new_data[x + yIndexOffset] = currentValue;
 		}
-	}
+	});
 
 	/* First generate the border in vertical direction... */
-	for(GGen_Coord x = 0; x < this->width; x++){
-
-		/* A cell is part of a border, if it matches the condition and at least one of its neighbors doesn't. */
-		for(GGen_Coord y = 1; y < this->height - 1; y++){
-			GGen_Height prevValue = this->data[x + (y - 1) * this->width];
-			GGen_Height currentValue = this->data[x + y * this->width];
-			GGen_Height nextValue = this->data[x + (y + 1) * this->width];
+	GGen_ParallelFor(0, this->width, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord x = (GGen_Coord) from; x < to; x++) {
+
+			/* A cell is part of a border, if it matches the condition and at least one of its neighbors doesn't. */
+			for(GGen_Coord y = 1; y < this->height - 1; y++){
+				GGen_Height prevValue = this->data[x + (y - 1) * (GGen_Index) this->width];
+				GGen_Height currentValue = this->data[x + y * (GGen_Index) this->width];
+				GGen_Height nextValue = this->data[x + (y + 1) * (GGen_Index) this->width];
+
+				switch(mode){
+					case GGEN_EQUAL_TO: currentValue = (GGen_Height) ((currentValue == threshold) && (!(nextValue == threshold) || !(prevValue == threshold))); break;
+					case GGEN_NOT_EQUAL_TO: currentValue = (GGen_Height) ((currentValue != threshold) && (!(nextValue != threshold) || !(prevValue != threshold))); break;
+					case GGEN_GREATER_THAN: currentValue = (GGen_Height) ((currentValue > threshold) && (!(nextValue > threshold) || !(prevValue > threshold))); break;
+					case GGEN_GREATER_THAN_OR_EQUAL_TO: currentValue = (GGen_Height) ((currentValue >= threshold) && (!(nextValue >= threshold) || !(prevValue >= threshold))); break;
+					case GGEN_LESS_THAN: currentValue = (GGen_Height) ((currentValue < threshold) && (!(nextValue < threshold) || !(prevValue < threshold))); break;
+					case GGEN_LESS_THAN_OR_EQUAL_TO: currentValue = (GGen_Height) ((currentValue <= threshold) && (!(nextValue <= threshold) || !(prevValue <= threshold))); break;
+				}
 
-			switch(mode){
-				case GGEN_EQUAL_TO: currentValue = (GGen_Height) ((currentValue == threshold) && (!(nextValue == threshold) || !(prevValue == threshold))); break;
-				case GGEN_NOT_EQUAL_TO: currentValue = (GGen_Height) ((currentValue != threshold) && (!(nextValue != threshold) || !(prevValue != threshold))); break;
-				case GGEN_GREATER_THAN: currentValue = (GGen_Height) ((currentValue > threshold) && (!(nextValue > threshold) || !(prevValue > threshold))); break;
-				case GGEN_GREATER_THAN_OR_EQUAL_TO: currentValue = (GGen_Height) ((currentValue >= threshold) && (!(nextValue >= threshold) || !(prevValue >= threshold))); break;
-				case GGEN_LESS_THAN: currentValue = (GGen_Height) ((currentValue < threshold) && (!(nextValue < threshold) || !(prevValue < threshold))); break;
-				case GGEN_LESS_THAN_OR_EQUAL_TO: currentValue = (GGen_Height) ((currentValue <= threshold) && (!(nextValue <= threshold) || !(prevValue <= threshold))); break;
+				/* The cell is in either "vertical border" or in "horizontal border" => it is part of the final border. */
+				new_data[x + y * (GGen_Index) this->width] = MAX(currentValue, new_data[x + y * (GGen_Index) this->width]);
 			}
-
-			/* The cell is in either "vertical border" or in "horizontal border" => it is part of the final border. */
-			new_data[x + y * this->width] = MAX(currentValue, new_data[x + y * this->width]);
 		}
-	}
+	});
 	
 
 	/* Relink and delete the original array data */
-	delete [] this->data;
-	this->data = new_data;	
+	this->ReplaceData(new_data);	
 }
 
 void GGen_Data_2D::ConvexityMap(GGen_Distance radius)
@@ -2438,6 +4366,8 @@ void GGen_Data_2D::Distort(GGen_Size waveLength, GGen_Distance amplitude)
 	GGen_Script_Assert(amplitude < this->width);
 	GGen_Script_Assert(amplitude < this->height);
 
+	this->PrepareReplace();
+
 	/* Set up an Amplitude object with one wave length only. */
 	GGen_Amplitudes* amplitudeObject = new GGen_Amplitudes(waveLength);
 	amplitudeObject->AddAmplitude(waveLength, amplitude);
@@ -2450,23 +4380,24 @@ void GGen_Data_2D::Distort(GGen_Size waveLength, GGen_Distance amplitude)
 	turbulenceYMap->Noise(1, waveLength, amplitudeObject);
 
 	/* Allocate the new array */
-	GGen_Height* new_data = new GGen_Height[this->length];
+	GGen_Height* new_data = GGen_BufferPool::Allocate(this->length);
 
 	GGen_Script_Assert(new_data != NULL);
 
 	/* Shift the coordinate of each cell by distortion values found in the turbulence maps. */
-	for (GGen_Coord y = 0; y < this->height; y++) {
-		for (GGen_Coord x = 0; x < this->width; x++) {
-			GGen_Coord distortedX = MAX(MIN((GGen_CoordOffset) x + (GGen_CoordOffset) turbulenceXMap->data[x + y * this->width], (GGen_CoordOffset) (this->width - 1)), 0);
-			GGen_Coord distortedY = MAX(MIN((GGen_CoordOffset) y + (GGen_CoordOffset) turbulenceYMap->data[x + y * this->width], (GGen_CoordOffset) (this->height - 1)), 0);
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			for (GGen_Coord x = 0; x < this->width; x++) {
+				GGen_Coord distortedX = MAX(MIN((GGen_CoordOffset) x + (GGen_CoordOffset) turbulenceXMap->data[x + y * (GGen_Index) this->width], (GGen_CoordOffset) (this->width - 1)), 0);
+				GGen_Coord distortedY = MAX(MIN((GGen_CoordOffset) y + (GGen_CoordOffset) turbulenceYMap->data[x + y * (GGen_Index) this->width], (GGen_CoordOffset) (this->height - 1)), 0);
 
-			new_data[x + y * this->width] = this->data[distortedX + this->width * distortedY];
+				new_data[x + y * (GGen_Index) this->width] = this->data[distortedX + (GGen_Index) this->width * distortedY];
+			}
 		}
-	}
+	});
 
 	/* Relink and delete the original array data */
-	delete [] this->data;
-	this->data = new_data;	
+	this->ReplaceData(new_data);	
 
 	delete amplitudeObject;
 	delete turbulenceXMap;
@@ -2474,24 +4405,29 @@ void GGen_Data_2D::Distort(GGen_Size waveLength, GGen_Distance amplitude)
 }
 
 void GGen_Data_2D::NormalMap(){
+	this->PrepareReplace();
+
 	/* Allocate the new array */
-	GGen_Height* new_data = new GGen_Height[this->length];
+	GGen_Height* new_data = GGen_BufferPool::Allocate(this->length);
 
 	GGen_Script_Assert(new_data != NULL);
 
 	/* Calculate facing direction information for individual cells */
-	for (GGen_Coord y = 0; y < this->height; y++) {
-		for (GGen_Coord x = 0; x < this->width; x++) {
-			new_data[x + y * this->width] = this->GetNormal(x, y);
-		}	
-	}
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			for (GGen_Coord x = 0; x < this->width; x++) {
+				new_data[x + y * (GGen_Index) this->width] = this->GetNormal(x, y);
+			}	
+		}
+	});
 
 	/* Relink and delete the original array data */
-	delete [] this->data;
-	this->data = new_data;
+	this->ReplaceData(new_data);
 }
 
 void GGen_Data_2D::NormalDifferenceMap(int32 angle){
+	this->PrepareReplace();
+
 	/* Clamp the angle to the 0-360 range */
 	angle = angle % 360;
 
@@ -2501,37 +4437,38 @@ void GGen_Data_2D::NormalDifferenceMap(int32 angle){
 	angle = (int64) GGEN_MIN_HEIGHT + ((int64) angle * (int64) (GGEN_MAX_HEIGHT - GGEN_MIN_HEIGHT)) / (int64) 360;
 
 	/* Allocate the new array */
-	GGen_Height* new_data = new GGen_Height[this->length];
+	GGen_Height* new_data = GGen_BufferPool::Allocate(this->length);
 
 	GGen_Script_Assert(new_data != NULL);
 
 	/* Calculate facing direction information for individual cells */
-	for (GGen_Coord y = 0; y < this->height; y++) {
-		for (GGen_Coord x = 0; x < this->width; x++) {
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			for (GGen_Coord x = 0; x < this->width; x++) {
 
-			GGen_Height normal = this->GetNormal(x, y);
+				GGen_Height normal = this->GetNormal(x, y);
 
-			/* Flat tiles aways return invalid angle */ 
-			if(normal == GGEN_INVALID_HEIGHT) {
-				new_data[x + y * this->width] = GGEN_INVALID_HEIGHT;
-				continue;
-			}
+				/* Flat tiles aways return invalid angle */ 
+				if(normal == GGEN_INVALID_HEIGHT) {
+					new_data[x + y * (GGen_Index) this->width] = GGEN_INVALID_HEIGHT;
+					continue;
+				}
 
-			/* Difference of the two angles */
-			GGen_ExtHeight normalDifference = ABS(((GGen_ExtHeight) normal - (GGen_ExtHeight) angle));
+				/* Difference of the two angles */
+				GGen_ExtHeight normalDifference = ABS(((GGen_ExtHeight) normal - (GGen_ExtHeight) angle));
 
-			/* The push angles (180, 360) into the (0, 180) range (we want angle difference, not absolute angle) */
-			if(normalDifference > (GGEN_MAX_HEIGHT - GGEN_MIN_HEIGHT) / 2){
-				normalDifference = (GGEN_MAX_HEIGHT - GGEN_MIN_HEIGHT) - normalDifference;
-			}
+				/* The push angles (180, 360) into the (0, 180) range (we want angle difference, not absolute angle) */
+				if(normalDifference > (GGEN_MAX_HEIGHT - GGEN_MIN_HEIGHT) / 2){
+					normalDifference = (GGEN_MAX_HEIGHT - GGEN_MIN_HEIGHT) - normalDifference;
+				}
 
-			new_data[x + y * this->width] = normalDifference;
-		}	
-	}
+				new_data[x + y * (GGen_Index) this->width] = normalDifference;
+			}	
+		}
+	});
 
 	/* Relink and delete the original array data */
-	delete [] this->data;
-	this->data = new_data;
+	this->ReplaceData(new_data);
 }
 
 GGen_Height GGen_Data_2D::GetNormal( GGen_Coord x, GGen_Coord y )
@@ -2539,10 +4476,12 @@ GGen_Height GGen_Data_2D::GetNormal( GGen_Coord x, GGen_Coord y )
 	GGen_Script_Assert(x < this->width);
 	GGen_Script_Assert(y < this->height);
 
-	GGen_Index indexLeft = x > 0 ? (x - 1) + y * this->width : x + y * this->width;
-	GGen_Index indexRight = x < this->width ? (x + 1) + y * this->width : x + y * this->width;
-	GGen_Index indexTop = y > 0 ? x + (y - 1) * this->width : x + y * this->width;
-	GGen_Index indexBottom = y < this->height ? x + (y + 1) * this->width : x + y * this->width;
+	this->FlushOperations();
+
+	GGen_Index indexLeft = x > 0 ? (x - 1) + y * (GGen_Index) this->width : x + y * (GGen_Index) this->width;
+	GGen_Index indexRight = x + 1 < this->width ? (x + 1) + y * (GGen_Index) this->width : x + y * (GGen_Index) this->width;
+	GGen_Index indexTop = y > 0 ? x + (y - 1) * (GGen_Index) this->width : x + y * (GGen_Index) this->width;
+	GGen_Index indexBottom = y + 1 < this->height ? x + (y + 1) * (GGen_Index) this->width : x + y * (GGen_Index) this->width;
 
 	GGen_Height heightLeft = this->data[indexLeft];
 	GGen_Height heightRight = this->data[indexRight];
@@ -2573,41 +4512,45 @@ GGen_Height GGen_Data_2D::GetNormal( GGen_Coord x, GGen_Coord y )
 
 void GGen_Data_2D::SimpleErosion(uint8 numRounds, uint8 erosionFactor, bool enableSedimentation)
 {
+	this->PrepareWrite();
+
 	//GGen_Script_Assert(this->width == flowMap->width && this->height == flowMap->height);
 	//GGen_Script_Assert(this->width == sedimentMap->width && this->height == sedimentMap->height);
 
+	GGen_RandomStream random = GGen_RandomStream::ForOperation();
+
 	// Each round is completely separate.
 	for(uint32 round = 0; round < numRounds * this->length; round++){
 		// Choose a random tile on the map.
-		GGen_Coord x = GGen_Random<GGen_Coord>(0, this->width - 1);
-		GGen_Coord y = GGen_Random<GGen_Coord>(0, this->height - 1);
+		GGen_Coord x = random.Next<GGen_Coord>(0, this->width - 1);
+		GGen_Coord y = random.Next<GGen_Coord>(0, this->height - 1);
 		
 		GGen_Height currentCarriedSediment = 0;
 
 		// Don't bother with water tiles.
-		if(this->data[x + this->width * y] <= 0) continue;
+		if(this->data[x + (GGen_Index) this->width * y] <= 0) continue;
 
 		// Keep advancing from the initial tile until the water level is reached.
-		while(this->data[x + this->width * y] > 0){
+		while(this->data[x + (GGen_Index) this->width * y] > 0){
 			// Find the lowest neighboring tile
 			GGen_Coord lowestNeighborX = x;
 			GGen_Coord lowestNeighborY = y;
-			GGen_Height lowestNeighborHeight = this->data[x + this->width * y];
+			GGen_Height lowestNeighborHeight = this->data[x + (GGen_Index) this->width * y];
 
 			// Try to look at 5 random points in the neighborhood (to add a little randomness into the flow).
 			for(uint8 i = 0; i < 5; i++){		
-				GGen_CoordOffset currentNeighborX = (GGen_CoordOffset) x + GGen_Random<int8>(-1, 1);
-				GGen_CoordOffset currentNeighborY = (GGen_CoordOffset) y + GGen_Random<int8>(-1, 1);
+				GGen_CoordOffset currentNeighborX = (GGen_CoordOffset) x + random.Next<int8>(-1, 1);
+				GGen_CoordOffset currentNeighborY = (GGen_CoordOffset) y + random.Next<int8>(-1, 1);
 
 				// Ignore the neighbor if it is outside the map
 				if(currentNeighborX < 0 || currentNeighborX == this->width || currentNeighborY < 0 || currentNeighborY == this->height){
 					continue;
 				}
 
-				if(this->data[currentNeighborX + this->width * currentNeighborY] < lowestNeighborHeight){
+				if(this->data[currentNeighborX + (GGen_Index) this->width * currentNeighborY] < lowestNeighborHeight){
 					lowestNeighborX = currentNeighborX;
 					lowestNeighborY = currentNeighborY;
-					lowestNeighborHeight = this->data[currentNeighborX + this->width * currentNeighborY];
+					lowestNeighborHeight = this->data[currentNeighborX + (GGen_Index) this->width * currentNeighborY];
 				}
 			}
 
@@ -2616,10 +4559,10 @@ void GGen_Data_2D::SimpleErosion(uint8 numRounds, uint8 erosionFactor, bool enab
 				// If we are out of sediment, terminate the flow.
 				if(currentCarriedSediment <= 0) break;
 
-				this->data[x + this->width * y] += erosionFactor;
+				this->data[x + (GGen_Index) this->width * y] += erosionFactor;
 
 				/*if(sedimentMap != null){
-					sedimentMap->data[x + this->width * y]++;
+					sedimentMap->data[x + (GGen_Index) this->width * y]++;
 				}*/
 
 				// Consume the suspended sediment at twice the erosion rate (to prevent infinite cycles of erosion and sedimentation).
@@ -2627,10 +4570,10 @@ void GGen_Data_2D::SimpleErosion(uint8 numRounds, uint8 erosionFactor, bool enab
 			}
 			// A lower neighbor was found, lower the current tile and move the cursor to that neighbor.
 			else {
-				this->data[x + this->width * y] -= erosionFactor;
+				this->data[x + (GGen_Index) this->width * y] -= erosionFactor;
 				
 				/*if(sedimentMap != null){
-					flowMap->data[x + this->width * y]++;
+					flowMap->data[x + (GGen_Index) this->width * y]++;
 				}*/
 				
 				if(enableSedimentation){
@@ -2649,34 +4592,17 @@ double GGen_Data_2D::FlowMap(double duration, double waterRate){
     GGen_Script_Assert(waterRate > 0);
     GGen_Script_Assert(waterRate < 10);
 
-    GGen_ErosionSimulator simulator(this->width, this->height);
+    GGen_ErosionSimulator<double> simulator(this->width, this->height);
     double* heightMap = simulator.ImportHeightMap(*this);
 
     double* waterMap = new double[this->length];
 
-    memset(waterMap, 0, this->length * sizeof(double));
-
-    GGen_OutflowValues* outflowFluxMap = new GGen_OutflowValues[this->length];
-
-    memset(outflowFluxMap, 0, this->length * sizeof(GGen_OutflowValues));
-
-    for(double tRemaining = duration; tRemaining > 0; tRemaining -= simulator.deltaT){
-        simulator.ApplyWaterSources(waterMap, waterRate);
-        simulator.ApplyFlowSimulation(heightMap, waterMap, outflowFluxMap, NULL);
-        simulator.ApplyEvaporation(waterMap);
-    }
-
-    for(GGen_Index i = 0; i < this->length; i++){
-        if(this->data[i] <= 0){
-            waterMap[i] = 0;
-        }
-    }
+    simulator.FlowMap(heightMap, waterMap, duration, waterRate);
 
     double scale = simulator.ExportHeightMap(waterMap, *this);
 
     delete [] waterMap;
     delete [] heightMap;
-    delete [] outflowFluxMap;
 
     return scale;
 }
@@ -2685,15 +4611,10 @@ void GGen_Data_2D::ThermalWeathering(double duration, double talusAngle){
     GGen_Script_Assert(duration > 0);
     GGen_Script_Assert(talusAngle > 0 && talusAngle < 1);
 
-    GGen_ErosionSimulator simulator(this->width, this->height);
+    GGen_ErosionSimulator<double> simulator(this->width, this->height);
     double* heightMap = simulator.ImportHeightMap(*this);
-    simulator.talusAngle = talusAngle;
-
-    simulator.deltaT = 0.1;
 
-    for(double tRemaining = duration; tRemaining > 0; tRemaining -= simulator.deltaT){
-        simulator.ApplyThermalWeathering(heightMap, 4);
-    }
+    simulator.ThermalWeathering(heightMap, duration, talusAngle);
 
     simulator.ExportHeightMap(heightMap, *this);
 
@@ -2704,90 +4625,13 @@ void GGen_Data_2D::Erosion(double duration, double thermalWeatheringAmount, doub
 	GGen_Script_Assert(duration > 0);
     GGen_Script_Assert(waterAmount > 0);
     GGen_Script_Assert(waterAmount < 10);
-    
-    //GGen_Data_2D exportMap(this->width, this->height, 0);
-    
-    GGen_ErosionSimulator simulator(this->width, this->height);
-    double* heightMap = simulator.ImportHeightMap(*this);    
-
-	double* waterMap = new double[this->length];
-	double* sedimentMap = new double[this->length];
-	GGen_OutflowValues* outflowFluxMap = new GGen_OutflowValues[this->length];			
-    GGen_VelocityVector* velocityVectorMap = new GGen_VelocityVector[this->length];
-
-	// Initialize values in maps to zero where necessary
-	for(GGen_Coord y = 0; y < this->height; y++){
-		for(GGen_Coord x = 0; x < this->width; x++){
-			GGen_Index currentIndex = x + y * this->width;
-			
-			waterMap[currentIndex] = heightMap > 0 ? 0 : -heightMap[currentIndex];
-			outflowFluxMap[currentIndex].left = 0;
-			outflowFluxMap[currentIndex].right = 0;
-			outflowFluxMap[currentIndex].top = 0;
-			outflowFluxMap[currentIndex].bottom = 0;
-			sedimentMap[currentIndex] = 0;
-		}
-	}
-	
-    GGen::GetInstance()->ThrowMessage(GGen_Const_String("Starting erosion..."), GGEN_MESSAGE);
-
-	for(double tRemaining = duration; tRemaining > 0; tRemaining -= simulator.deltaT){
-		if(tRemaining >= simulator.deltaT){
-            GGen_StringStream ss;
-            ss << GGen_Const_String("Erosion time remaining: ");
-            ss << tRemaining;
-            GGen::GetInstance()->ThrowMessage(ss.str(), GGEN_MESSAGE);
-        }        
-
-		simulator.ApplyWaterSources(waterMap, 0.05 * waterAmount);
-
-		simulator.ApplyFlowSimulation(heightMap, waterMap, outflowFluxMap, velocityVectorMap);
-		
-        /*this->ExportHeightMap(waterMap, exportMap);
-        wstringstream ss;
-        ss << GGen_Const_String("waterMapProgress");
-        ss << round;
-
-	    exportMap.ReturnAs(ss.str());*/
-
-        simulator.ApplyErosion(heightMap, waterMap, velocityVectorMap, sedimentMap);		
-
-        simulator.ApplyThermalWeathering(heightMap, thermalWeatheringAmount);
 
-		simulator.ApplyEvaporation(waterMap);	
-
-        double maxLength = 0;
-        for(GGen_Index i = 0; i < this->length; i++){
-            double length = sqrt(velocityVectorMap[i].x * velocityVectorMap[i].x + velocityVectorMap[i].y * velocityVectorMap[i].y);
-            if(length > maxLength){
-                maxLength = length;
-            }
-        }
-
-        simulator.deltaT = 1 / (1.5 * maxLength);
-        simulator.deltaT = MIN(simulator.deltaT, 0.05);
-
-        /*this->ExportHeightMap(heightMap, exportMap);
-        wstringstream ss2;
-        ss2 << GGen_Const_String("heightMapProgress");
-        ss2 << round;
-
-        exportMap.ReturnAs(ss2.str());*/		
-	}
-
-    GGen::GetInstance()->ThrowMessage(GGen_Const_String("Finished erosion..."), GGEN_MESSAGE);
-
-	/*simulator.ExportHeightMap(sedimentMap, exportMap);
-	exportMap.ReturnAs(GGen_Const_String("sedimentMap"));
+    GGen_ErosionSimulator<double> simulator(this->width, this->height);
+    double* heightMap = simulator.ImportHeightMap(*this);    
 
-	simulator.ExportHeightMap(waterMap, exportMap);
-	exportMap.ReturnAs(GGen_Const_String("waterMap"));*/
+    simulator.Erosion(heightMap, duration, thermalWeatheringAmount, waterAmount);
 
     simulator.ExportHeightMap(heightMap, *this);
 
 	delete [] heightMap;
-	delete [] waterMap;
-	delete [] sedimentMap;
-	delete [] outflowFluxMap;
-    delete [] velocityVectorMap;	
 }
\ No newline at end of file
@@ -23,9 +23,63 @@
 #include "ggen_data_1d.h"
 #include <iostream>
 #include <set>
+#include <vector>
 
 using namespace std;
 
+class GGen_Data_2D;
+class GGen_Mask_2D;
+
+/**
+ * @internal Elementwise map operations, which can be deferred and evaluated together in one pass.
+ **/
+enum GGen_Operation_Type{
+	GGEN_OPERATION_FILL,
+	GGEN_OPERATION_ADD,
+	GGEN_OPERATION_ADD_MAP,
+	GGEN_OPERATION_MULTIPLY,
+	GGEN_OPERATION_INVERT,
+	GGEN_OPERATION_ABS,
+	GGEN_OPERATION_CLAMP,
+	GGEN_OPERATION_CROP_VALUES,
+	GGEN_OPERATION_REPLACE_VALUE,
+	GGEN_OPERATION_MONOCHROME,
+	GGEN_OPERATION_SELECT_VALUE,
+	GGEN_OPERATION_SCALE_VALUES
+};
+
+/**
+ * @internal One elementwise operation with its operands.
+ **/
+struct GGen_Data_2D_Operation{
+	GGen_Operation_Type type;
+
+	/* Fill, Add, Monochrome and SelectValue operand, ReplaceValue needle */
+	GGen_Height value;
+
+	/* ReplaceValue replacement */
+	GGen_Height replacement;
+
+	/* Clamp and CropValues boundaries */
+	GGen_Height min;
+	GGen_Height max;
+
+	/* Multiply factor */
+	double factor;
+
+	/* ScaleValuesTo mapping of <from_min, from_min + from_range> onto <to_min, to_min + to_range> */
+	GGen_ExtHeight from_min;
+	GGen_ExtHeight from_range;
+	GGen_ExtHeight to_min;
+	GGen_ExtHeight to_range;
+
+	/* AddMap addend (of the same size) */
+	GGen_Data_2D* map;
+
+	GGen_Data_2D_Operation(GGen_Operation_Type type)
+	: type(type), value(0), replacement(0), min(0), max(0), factor(0), from_min(0), from_range(0), to_min(0), to_range(0), map(NULL) {}
+};
+
 /**
  * GGen_Data_2D represents 2-dimensional array of values. Most straightforward interpretation of such array is a bitmap, where black represents some minimal value (usually 0) and white represents some maximal value (in case of 8 bit per channel bitmaps usually 255). You will probably realize many of the GGen_Data_2D functions strongly resemble functions from classical bitmap editors - <a href="#2d_add">adding</a> changes brightness, <a href="#2d_multiply">multiplying</a> changes contrast, <a href="#2d_transformvalues">curves</a>... Working with multiple 2D arrays with GGen is generally very similiar to working with layer enabled bitmap editor, just without a fancy GUI.
  **/
@@ -34,6 +88,93 @@ class GGen_Data_2D{
 		static uint16 num_instances;
 		static set<GGen_Data_2D*> instances;
 
+		/* Record elementwise operations instead of executing them right away */
+		static bool deferred_evaluation;
+
+		/* Elementwise operations waiting for evaluation (in deferred evaluation mode) */
+		vector<GGen_Data_2D_Operation> operations;
+
+		/* Maps with waiting operations reading this map */
+		set<GGen_Data_2D*> dependents;
+
+		/* Cached statistics of the values (valid only if stats_valid is true) */
+		bool stats_valid;
+		GGen_Height stats_min;
+		GGen_Height stats_max;
+
+		/* Number of maps sharing the data array (NULL if the array is not shared) */
+		uint32* data_references;
+
+		/**
+		 * Creates a map sharing the data array with another map. The array is copied once either of them is modified.
+		 * @param original The map to share the array with.
+		 **/
+		GGen_Data_2D(GGen_Data_2D* original);
+
+		/**
+		 * Gives the map its own copy of the data array if the array is shared with other maps.
+		 * @param keep_values True to copy the values into the new array (otherwise it is left uninitialized).
+		 **/
+		void Unshare(bool keep_values);
+
+		/**
+		 * Releases the data array (deletes it unless other maps still share it).
+		 **/
+		void ReleaseData();
+
+		/**
+		 * Releases the current data array and uses a new one instead.
+		 * @param new_data The new array (of the current length).
+		 **/
+		void ReplaceData(GGen_Height* new_data);
+
+		/**
+		 * Fills the array (and optionally one more array of the same size) with random voronoi noise. All arrays share the same diagram.
+		 * @param cell_size Size of one cell (cells are considered to be squares).
+		 * @param points_per_cell Number of points randomly placed in each cell.
+		 * @param mode The noise mode for this array.
+		 * @param second_map The second array (or NULL).
+		 * @param second_mode The noise mode for the second array.
+		 **/
+		void VoronoiNoise_Fill(GGen_Size cell_size, uint8 points_per_cell, GGen_Voronoi_Noise_Mode mode, GGen_Data_2D* second_map, GGen_Voronoi_Noise_Mode second_mode);
+
+		/**
+		 * Rotates the map counter-clockwise by a multiple of 90 degrees. The tiles are only moved, so the result is exact.
+		 * @param quarter_turns Number of 90 degree turns.
+		 * @param preserve_size If set to true, the result will be cropped/expanded to match its original boundaries.
+		 **/
+		void RotateQuarterTurns(int32 quarter_turns, bool preserve_size);
+
+		/**
+		 * Common implementation of ExpandCircular and ShrinkCircular.
+		 * @param distance The distance in euclidean metric.
+		 * @param shrink True to shrink, false to expand.
+		 **/
+		void ExpandShrinkCircularBase(GGen_Distance distance, bool shrink);
+
+		/**
+		 * Executes an elementwise operation, or records it in deferred evaluation mode.
+		 * @param operation The operation.
+		 **/
+		void ApplyOperation(const GGen_Data_2D_Operation& operation);
+
+		/**
+		 * Executes a sequence of elementwise operations in one pass over the map. Updates the cached statistics.
+		 * @param operations The operations.
+		 * @param count Number of the operations.
+		 **/
+		void RunOperations(const GGen_Data_2D_Operation* operations, size_t count);
+
+		/**
+		 * Evaluates waiting operations of all maps reading this map (so they read its current values).
+		 **/
+		void FlushDependents();
+
+		/**
+		 * Drops all waiting operations without evaluating them.
+		 **/
+		void DiscardOperations();
+
 	public:
 		GGen_Height* data;
 		GGen_Size width;
@@ -51,7 +192,8 @@ class GGen_Data_2D{
 		~GGen_Data_2D();
 
 		/**
-		 * Creates a 1:1 copy of the current object.
+		 * Creates a 1:1 copy of the current object. The copy shares the data with the original until one of them is
+		 * modified.
 		 * @return Copy of the object.
 		 **/
 		GGen_Data_2D* Clone();
@@ -118,6 +260,49 @@ class GGen_Data_2D{
 		 **/
 		GGen_Height GetValueInterpolated(GGen_Coord x, GGen_Coord y, GGen_Size scale_to_width, GGen_Size scale_to_height);
 
+		/**
+		 * Copies values of a rectangle out of the map.
+		 * @param x X coordinate of the left border.
+		 * @param y Y coordinate of the top border.
+		 * @param width Width of the rectangle.
+		 * @param height Height of the rectangle.
+		 * @param output Array of width * height values, the rectangle is stored row by row.
+		 **/
+		void GetRegion(GGen_Coord x, GGen_Coord y, GGen_Size width, GGen_Size height, GGen_Height* output);
+
+		/**
+		 * Overwrites values of a rectangle in the map.
+		 * @param x X coordinate of the left border.
+		 * @param y Y coordinate of the top border.
+		 * @param width Width of the rectangle.
+		 * @param height Height of the rectangle.
+		 * @param values Array of width * height values, the rectangle is stored row by row.
+		 **/
+		void SetRegion(GGen_Coord x, GGen_Coord y, GGen_Size width, GGen_Size height, const GGen_Height* values);
+
+		/**
+		 * Copies values of one row out of the map.
+		 * @param y Y coordinate of the row.
+		 * @param output Array of GetWidth() values.
+		 **/
+		void GetRow(GGen_Coord y, GGen_Height* output);
+
+		/**
+		 * Overwrites values of one row.
+		 * @param y Y coordinate of the row.
+		 * @param values Array of GetWidth() values.
+		 **/
+		void SetRow(GGen_Coord y, const GGen_Height* values);
+
+		/**
+		 * Returns values of many tiles at once.
+		 * @param xs X coordinates of the tiles.
+		 * @param ys Y coordinates of the tiles.
+		 * @param count Number of the tiles.
+		 * @param output Array of count values.
+		 **/
+		void GetValues(const GGen_Coord* xs, const GGen_Coord* ys, GGen_Index count, GGen_Height* output);
+
 		/**
 		 * Adds an integer to all values in the map.
 		 * @param value Value to be added to values in the map.
@@ -177,7 +362,7 @@ class GGen_Data_2D{
 		 * Scales size of the map by a real number.
 		 * @param ratio Scaling ratio (0.5 = 50%, 2.0 = 200%).
 		 * @param scale_values Multiply the values by the ratio as well?
-		 * @note If the new size is larger than the original, the new values will be calculated using the linear interpolation algorithm. Otherwise, the new values will be chosen using the nearest neighbor algorithm.
+		 * @note The new values are calculated using the bilinear filter (see ScaleToFiltered).
 		 **/
 		void Scale(double ratio, bool scale_values);
 
@@ -186,9 +371,19 @@ class GGen_Data_2D{
 		 * @param new_width Target array width.
 		 * @param new_height Target array height.
 		 * @param scale_values Scale the values correspondingly as well?
-		 * @note If the new size is larger than the original, the new values will be calculated using the linear interpolation algorithm. Otherwise, the new values will be chosen using the nearest neighbor algorithm.
+		 * @note The new values are calculated using the bilinear filter (see ScaleToFiltered).
 		 **/
 		void ScaleTo(GGen_Size new_width, GGen_Size new_height, bool scale_values);
+
+		/**
+		 * Scales size of the map to new size using given resampling filter.
+		 * @param new_width Target array width.
+		 * @param new_height Target array height.
+		 * @param scale_values Scale the values correspondingly as well?
+		 * @param filter The resampling filter (see GGen_Scaling_Filter).
+		 * @note When shrinking, the filter is stretched over all the original tiles covered by one new tile, so no tiles are skipped.
+		 **/
+		void ScaleToFiltered(GGen_Size new_width, GGen_Size new_height, bool scale_values, GGen_Scaling_Filter filter);
 		
 		/**
 		 * Scales values in the map to fit a new value range.
@@ -248,6 +443,75 @@ class GGen_Data_2D{
 		 **/
 		GGen_Height Max();
 
+		/**
+		 * Returns both the minimum and the maximum of all values in the map (in one pass). The results are cached until
+		 * the map is modified, so repeated calls on an unchanged map don't scan it again.
+		 * @param min Pointer to store the minimum to.
+		 * @param max Pointer to store the maximum to.
+		 **/
+		void MinMax(GGen_Height* min, GGen_Height* max);
+
+		/**
+		 * @internal Evaluates all deferred operations. Every method reading the map calls this, code reading the data array
+		 * directly has to call it too.
+		 **/
+		void FlushOperations();
+
+		/**
+		 * @internal Evaluates deferred operations of the map and of all maps reading it and discards the cached
+		 * statistics. Every method modifying the map calls this, code writing into the data array directly has to call it
+		 * too.
+		 **/
+		void PrepareWrite();
+
+		/**
+		 * @internal Like PrepareWrite, but the data array might stay shared with other maps. For methods which only read
+		 * the array and then replace it with a new one.
+		 **/
+		void PrepareReplace();
+
+		/**
+		 * @internal Enables or disables deferred evaluation. In deferred mode, elementwise operations (Fill, Add, AddMap,
+		 * Multiply, Invert, Abs, Clamp, CropValues, ReplaceValue, Monochrome, SelectValue and ScaleValuesTo) are only
+		 * recorded and evaluated together in one pass once the map is read or modified otherwise.
+		 * @param enabled True to enable deferred evaluation.
+		 **/
+		static void SetDeferredEvaluation(bool enabled);
+
+		/**
+		 * @internal Returns true if deferred evaluation is enabled.
+		 **/
+		static bool GetDeferredEvaluation();
+
+		/**
+		 * Counts tiles of each value.
+		 * @param counts Array of GGEN_HISTOGRAM_SIZE counts. The count of value v is stored at index v - GGEN_INVALID_HEIGHT.
+		 **/
+		void CountValues(GGen_Index* counts);
+
+		/**
+		 * Returns histogram of the map values from an interval. Each bin holds share of the map tiles falling into it (GGEN_MAX_HEIGHT means the whole map).
+		 * @param min The lowest value counted into the first bin.
+		 * @param max The highest value counted into the last bin.
+		 * @param bin_count Number of bins (length of the returned array).
+		 * @return The histogram.
+		 **/
+		GGen_Data_1D* Histogram(GGen_Height min, GGen_Height max, GGen_Size bin_count);
+
+		/**
+		 * Returns the value with given rank (the value which would be at given position if the map values were sorted from the lowest).
+		 * @param rank Position in the sorted values (0 = the minimum, length - 1 = the maximum).
+		 * @return The value.
+		 **/
+		GGen_Height ValueAtRank(GGen_Index rank);
+
+		/**
+		 * Returns the value which is higher than or equal to given share of the map values.
+		 * @param percentile The share of the map (0 = the minimum, 0.5 = the median, 1 = the maximum).
+		 * @return The value.
+		 **/
+		GGen_Height Percentile(double percentile);
+
 		/**
 		 * Performs a set intersection of the map graphs (higher of two respective values is applied).
 		 * @param victim The intersection map. This map will be scaled to match the original map.
@@ -286,6 +550,42 @@ class GGen_Data_2D{
 		 **/
 		void Combine(GGen_Data_2D* victim, GGen_Data_2D* mask, bool relative);
 
+		/**
+		 * Sets all tiles selected in a mask to a value.
+		 * @param value Value to use.
+		 * @param mask The mask (of the same size as the map).
+		 **/
+		void FillWhere(GGen_Height value, GGen_Mask_2D* mask);
+
+		/**
+		 * Adds an integer to all tiles selected in a mask.
+		 * @param value Value to be added.
+		 * @param mask The mask (of the same size as the map).
+		 **/
+		void AddWhere(GGen_Height value, GGen_Mask_2D* mask);
+
+		/**
+		 * Adds another map to all tiles selected in a mask.
+		 * @param addend Map to be added (of the same size as the map).
+		 * @param mask The mask (of the same size as the map).
+		 **/
+		void AddMapWhere(GGen_Data_2D* addend, GGen_Mask_2D* mask);
+
+		/**
+		 * Combines the current map with another map, tiles selected in a mask keep the current value, other tiles are taken from the other map.
+		 * @param victim The second map (of the same size as the map).
+		 * @param mask The mask (of the same size as the map).
+		 **/
+		void CombineWhere(GGen_Data_2D* victim, GGen_Mask_2D* mask);
+
+		/**
+		 * Replaces each value with result of an expression evaluated for the tile. The expression may use the current value (v), tile coordinates (x, y), map size (width, height), values of the same tile in the other maps (m0, m1...), decimal constants, pi, operators + - * / % < <= > >= == != && || ! ?: and functions min, max, clamp, abs, sqrt, floor, pow, sin and cos.
+		 * @param expression The expression, for example "v > 0 ? v * m0 / 100 : -abs(v)".
+		 * @param maps The other maps. All maps must have the same size as the current map.
+		 * @note The expression is calculated with real numbers. Comparisons and logical operators return 1 or 0, division by zero returns 0. The result is rounded towards zero and clamped to the valid value range.
+		 **/
+		void Evaluate(const GGen_String& expression, const vector<GGen_Data_2D*>& maps);
+
 		/**
 		 * Replaces all occurrences of a value with a different value.
 		 * @param needle The replaced value.
@@ -376,6 +676,17 @@ class GGen_Data_2D{
 		 **/
 		void Noise(GGen_Size min_feature_size, GGen_Size max_feature_size, GGen_Amplitudes* amplitudes);
 
+		/**
+		 * Fills the array with a window of unbounded fractal noise. The noise is defined by the seed only and the map
+		 * shows its part starting at given world coordinates, so adjacent windows generated separately match exactly.
+		 * @param offset_x World X coordinate of the left border of the map.
+		 * @param offset_y World Y coordinate of the top border of the map.
+		 * @param min_feature_size Minimum wave length for amplitude to be used.
+		 * @param max_feature_size Maximum wave length for amplitude to be used.
+		 * @param amplitudes GGen_Amplitudes object.
+		 **/
+		void NoiseWindow(GGen_CoordOffset offset_x, GGen_CoordOffset offset_y, GGen_Size min_feature_size, GGen_Size max_feature_size, GGen_Amplitudes* amplitudes);
+
 		/**
 		 * Fills the array with random voronoi noise.
 		 * @param cell_size Size of one cell (cells are considered to be squares).
@@ -386,6 +697,17 @@ class GGen_Data_2D{
 		 **/
 		void VoronoiNoise(GGen_Size cell_size, uint8 points_per_cell, GGen_Voronoi_Noise_Mode mode);
 
+		/**
+		 * Fills this array and another array with two different modes of the same random voronoi noise (for example GGEN_F1
+		 * and GGEN_CELL_ID), which is faster than two separate noises and keeps the cells identical.
+		 * @param cell_size Size of one cell (cells are considered to be squares).
+		 * @param points_per_cell Number of points randomly placed in each cell.
+		 * @param mode The noise mode for this array (see GGen_Voronoi_Noise_Mode).
+		 * @param second_map The second array. Must be of the same size as this array.
+		 * @param second_mode The noise mode for the second array.
+		 **/
+		void VoronoiNoisePair(GGen_Size cell_size, uint8 points_per_cell, GGen_Voronoi_Noise_Mode mode, GGen_Data_2D* second_map, GGen_Voronoi_Noise_Mode second_mode);
+
 		/**
 		 * Blurs the map in one direction. Uses linear smoothing algorithm.
 		 * @param radius The smoothing kernel radius.
@@ -398,6 +720,12 @@ class GGen_Data_2D{
 		 * @param radius The smoothing kernel radius.
 		 **/
 		void Smooth(GGen_Distance radius);
+
+		/**
+		 * Blurs the map with gaussian kernel. Uses recursive filtering, so the speed doesn't depend on sigma.
+		 * @param sigma Standard deviation of the kernel (in tiles). Must be at least 0.5.
+		 **/
+		void GaussianBlur(double sigma);
 		
 		/**
 		 * Changes the values so only given percentage of values is higher than 0.
@@ -466,16 +794,36 @@ class GGen_Data_2D{
 		 * @param a22 Matrix element (2,2).
 		 * @pre The matrix must be invertible (a11 * a22 - a12 * a21 != 0).
 		 * @param preserve_size If set to true, the result will be cropped/expanded to match its original boundaries.
-		 * @note Do not use this function to scale the map, it uses a low-quality nearest neighbor interpolation.
+		 * @note Do not use this function to scale the map, it uses a low-quality nearest neighbor interpolation (see TransformFiltered).
 		 **/
 		void Transform(double a11, double a12, double a21, double a22, bool preserve_size);
 
+		/**
+		 * Applies a linear transformation matrix onto the map using given resampling filter.
+		 * @param a11 Matrix element (1,1).
+		 * @param a12 Matrix element (1,2).
+		 * @param a21 Matrix element (2,1).
+		 * @param a22 Matrix element (2,2).
+		 * @pre The matrix must be invertible (a11 * a22 - a12 * a21 != 0).
+		 * @param preserve_size If set to true, the result will be cropped/expanded to match its original boundaries.
+		 * @param filter GGEN_BOX (nearest neighbor) or GGEN_BILINEAR.
+		 **/
+		void TransformFiltered(double a11, double a12, double a21, double a22, bool preserve_size, GGen_Scaling_Filter filter);
+
 		/**
 		 * Rotates the map by an angle counter-clockwise.
 		 * @param angle The angle in degrees.
 		 * @param preserve_size If set to true, the result will be cropped to match its original boundaries.
 		 **/
 		void Rotate(int32 angle, bool preserve_size);
+
+		/**
+		 * Rotates the map by an angle counter-clockwise using given resampling filter.
+		 * @param angle The angle in degrees.
+		 * @param preserve_size If set to true, the result will be cropped to match its original boundaries.
+		 * @param filter GGEN_BOX (nearest neighbor) or GGEN_BILINEAR.
+		 **/
+		void RotateFiltered(int32 angle, bool preserve_size, GGen_Scaling_Filter filter);
 		
 		/**
 		 * Shears the map vertically and/or horizontally.
@@ -585,6 +933,36 @@ class GGen_Data_2D{
 		 **/
 		void Shrink(GGen_Distance distance);
 
+		/**
+		 * Computes squared euclidean distance from each tile to the nearest tile matching a simple arithmetic condition. Uses exact linear time distance transform.
+		 * @param mode Arithmetic operator to be used in the condition.
+		 * @param threshold Value to be compared against.
+		 * @param squared_distances Array of the same size as the map. Tiles which have no matching tile at all get 0xFFFFFFFFFFFFFFFF.
+		 **/
+		void DistanceTransform(GGen_Comparison_Mode mode, GGen_Height threshold, uint64* squared_distances);
+
+		/**
+		 * Replaces each value with (rounded) euclidean distance to the nearest tile matching a simple arithmetic condition. Matching tiles will be set to 0.
+		 * @param mode Arithmetic operator to be used in the condition.
+		 * @param threshold Value to be compared against.
+		 * @note If no tile matches the condition, the whole map will be filled with the maximum height.
+		 **/
+		void DistanceMap(GGen_Comparison_Mode mode, GGen_Height threshold);
+
+		/**
+		 * Fills all areas within a distance (in euclidean metric) from any value greater than 0 with 1. The rest of the map will be filled with 0.
+		 * @param distance The distance in euclidean metric.
+		 * @note Unlike Expand, the speed doesn't depend on the distance.
+		 **/
+		void ExpandCircular(GGen_Distance distance);
+
+		/**
+		 * Fills all areas within a distance (in euclidean metric) from any value lower than or equal to 0 with 0. The rest of the map will be filled with 1.
+		 * @param distance The distance in euclidean metric.
+		 * @note Unlike Shrink, the speed doesn't depend on the distance.
+		 **/
+		void ShrinkCircular(GGen_Distance distance);
+
 		/**
 		 * Draws a border (made of value 1) around an area matching a condition. The non-border areas are filled with 0.
 		 * @param mode Condition operator.
@@ -652,6 +1030,11 @@ class GGen_Data_2D{
 		void Erosion(double duration, double thermalWeatheringAmount, double waterAmount);
 
 		static void FreeAllInstances(){
+			/* Nothing will read the maps anymore, so their waiting operations don't need to be evaluated */
+			for (set<GGen_Data_2D*>::iterator i = GGen_Data_2D::instances.begin(); i != GGen_Data_2D::instances.end(); i++) {
+				(*i)->DiscardOperations();
+			}
+
 			while(GGen_Data_2D::instances.begin() != GGen_Data_2D::instances.end()){
 				delete (*GGen_Data_2D::instances.begin());
 			}
@@ -27,8 +27,9 @@
 #include "ggen_erosionsimulator.h"
 #include "ggen.h"
 
-GGen_ErosionSimulator::GGen_ErosionSimulator(GGen_Size width, GGen_Size height)
-	:width(width), height(height), length(width * height)
+template <class T>
+GGen_ErosionSimulator<T>::GGen_ErosionSimulator(GGen_Size width, GGen_Size height)
+	:width(width), height(height), length((GGen_TotalSize) width * height)
 {
     this->deltaT = 0.005;
 	this->pipeLength = 1;
@@ -50,9 +51,12 @@ struct GGen_ErosionPointData{
 };
 
 
-double* GGen_ErosionSimulator::ImportHeightMap( GGen_Data_2D& heightMap)
+template <class T>
+T* GGen_ErosionSimulator<T>::ImportHeightMap( GGen_Data_2D& heightMap)
 {
-	double* returnData = new double[this->length];
+	T* returnData = new T[this->length];
+
+	heightMap.FlushOperations();
 
 	for(GGen_Index i = 0; i < this->length; i++){
         if(heightMap.data[i] < 0) {
@@ -65,7 +69,8 @@ double* GGen_ErosionSimulator::ImportHeightMap( GGen_Data_2D& heightMap)
 	return returnData;
 }
 
-double GGen_ErosionSimulator::ExportHeightMap( double* heightMap, GGen_Data_2D& ggenHeightMap )
+template <class T>
+double GGen_ErosionSimulator<T>::ExportHeightMap( T* heightMap, GGen_Data_2D& ggenHeightMap )
 {
 	double max = 0;
 	double min = 1000000000;
@@ -77,6 +82,8 @@ double GGen_ErosionSimulator::ExportHeightMap( double* heightMap, GGen_Data_2D&
 
 	//cout << "Min << " << min << "  ---- MAX: " << max << endl;
 
+    ggenHeightMap.PrepareWrite();
+
 	for(GGen_Index i = 0; i < this->length; i++){
 		ggenHeightMap.data[i] = (GGen_Height) (heightMap[i] * GGEN_MAX_HEIGHT / max);
 
@@ -88,33 +95,36 @@ double GGen_ErosionSimulator::ExportHeightMap( double* heightMap, GGen_Data_2D&
     return GGEN_MAX_HEIGHT / max;
 }
 
-void GGen_ErosionSimulator::ApplyWaterSources(double* waterMap, double waterAmount)
+template <class T>
+void GGen_ErosionSimulator<T>::ApplyWaterSources(T* waterMap, double waterAmount)
 {
 	for(GGen_Coord y = 0; y < this->height; y++){
 		for(GGen_Coord x = 0; x < this->width; x++){
-            waterMap[x + y * this->width] += waterAmount * this->deltaT;
+            waterMap[x + y * (GGen_Index) this->width] += waterAmount * this->deltaT;
 		}
 	}
 }
 
-void GGen_ErosionSimulator::ApplyEvaporation( double* waterMap )
+template <class T>
+void GGen_ErosionSimulator<T>::ApplyEvaporation( T* waterMap )
 {
 	for(GGen_Coord y = 0; y < this->height; y++){
 		for(GGen_Coord x = 0; x < this->width; x++){			
-			waterMap[x + y * this->width] *= 0.985;
+			waterMap[x + y * (GGen_Index) this->width] *= 0.985;
 		}
 	}
 }
 
-void GGen_ErosionSimulator::ApplyFlowSimulation(double* heightMap, double* waterMap, GGen_OutflowValues* outflowFluxMap, GGen_VelocityVector* velocityVectorMap )
+template <class T>
+void GGen_ErosionSimulator<T>::ApplyFlowSimulation(T* heightMap, T* waterMap, GGen_OutflowValues<T>* outflowFluxMap, GGen_VelocityVector<T>* velocityVectorMap )
 {
-	double* waterMapCopy  = new double[this->length];
-	memcpy(waterMapCopy, waterMap, this->length * sizeof(double));
+	T* waterMapCopy  = new T[this->length];
+	memcpy(waterMapCopy, waterMap, this->length * sizeof(T));
 
 	for(GGen_Coord y = 0; y < this->height; y++){
 		for(GGen_Coord x = 0; x < this->width; x++){
-			GGen_Index currentIndex = x + this->width * y;
-			double currentHeight = heightMap[x + this->width * y];
+			GGen_Index currentIndex = x + (GGen_Index) this->width * y;
+			double currentHeight = heightMap[x + (GGen_Index) this->width * y];
 			
             if(outflowFluxMap[currentIndex].left < 0 || outflowFluxMap[currentIndex].right < 0 || outflowFluxMap[currentIndex].top < 0 || outflowFluxMap[currentIndex].bottom < 0){
                 GGen_Script_Error("Erosion error: Negative outflux value.");
@@ -175,7 +185,7 @@ void GGen_ErosionSimulator::ApplyFlowSimulation(double* heightMap, double* water
 
 	for(GGen_Coord y = 0; y < this->height; y++){
 		for(GGen_Coord x = 0; x < this->width; x++){
-			GGen_Index currentIndex = x + this->width * y;
+			GGen_Index currentIndex = x + (GGen_Index) this->width * y;
 
 			// Update water level using outflow and inflow information from surrounding cells.
 			double sumOutflow = 
@@ -223,26 +233,26 @@ void GGen_ErosionSimulator::ApplyFlowSimulation(double* heightMap, double* water
 				// Left border.
 				velocityVectorMap[currentIndex].x = 
 					(
-						outflowFluxMap[x + this->width * y].right -
-						outflowFluxMap[x + 1 + this->width * y].left
+						outflowFluxMap[x + (GGen_Index) this->width * y].right -
+						outflowFluxMap[x + 1 + (GGen_Index) this->width * y].left
 					);
 			}
 			else if(x + 1 == this->width)	{
 				// Right border.
 				velocityVectorMap[currentIndex].x = 
 					(
-						outflowFluxMap[x - 1 + this->width * y].right -
-						outflowFluxMap[x + this->width * y].left
+						outflowFluxMap[x - 1 + (GGen_Index) this->width * y].right -
+						outflowFluxMap[x + (GGen_Index) this->width * y].left
 					);
 			}
 			else {
 				// The rest.
 				velocityVectorMap[currentIndex].x = 
 					(
-						outflowFluxMap[x - 1 + this->width * y].right -
-						outflowFluxMap[x + this->width * y].left +
-						outflowFluxMap[x + this->width * y].right -
-						outflowFluxMap[x + 1 + this->width * y].left
+						outflowFluxMap[x - 1 + (GGen_Index) this->width * y].right -
+						outflowFluxMap[x + (GGen_Index) this->width * y].left +
+						outflowFluxMap[x + (GGen_Index) this->width * y].right -
+						outflowFluxMap[x + 1 + (GGen_Index) this->width * y].left
 					) / 2;
 			}
 
@@ -251,33 +261,33 @@ void GGen_ErosionSimulator::ApplyFlowSimulation(double* heightMap, double* water
 				// Top border.
 				velocityVectorMap[currentIndex].y = 
 					(
-						outflowFluxMap[x + this->width * y].bottom -
-						outflowFluxMap[x + 1 + this->width * (y + 1)].top
+						outflowFluxMap[x + (GGen_Index) this->width * y].bottom -
+						outflowFluxMap[x + 1 + (GGen_Index) this->width * (y + 1)].top
 					);
 			}
 			else if(y + 1 == this->height)	{
 				// Bottom border.
 				velocityVectorMap[currentIndex].y = 
 					(
-						outflowFluxMap[x + this->width * (y - 1)].bottom -
-						outflowFluxMap[x + this->width * y].top
+						outflowFluxMap[x + (GGen_Index) this->width * (y - 1)].bottom -
+						outflowFluxMap[x + (GGen_Index) this->width * y].top
 					);
 			}
 			else {
 				// The rest.
 				velocityVectorMap[currentIndex].y = 
 					(
-						outflowFluxMap[x + this->width * (y - 1)].bottom -
-						outflowFluxMap[x + this->width * y].top +
-						outflowFluxMap[x + this->width * y].bottom -
-						outflowFluxMap[x + this->width * (y + 1)].top
+						outflowFluxMap[x + (GGen_Index) this->width * (y - 1)].bottom -
+						outflowFluxMap[x + (GGen_Index) this->width * y].top +
+						outflowFluxMap[x + (GGen_Index) this->width * y].bottom -
+						outflowFluxMap[x + (GGen_Index) this->width * (y + 1)].top
 					) / 2;
 			}
 
             ///velocityVectorMap[x + width * y].x /= waterAverage * this->pipeLength;
             //velocityVectorMap[x + width * y].y /= waterAverage * this->pipeLength;
 
-            if(velocityVectorMap[x + width * y].x * this->deltaT > 1 || velocityVectorMap[x + width * y].y * this->deltaT > 1){
+            if(velocityVectorMap[x + (GGen_Index) width * y].x * this->deltaT > 1 || velocityVectorMap[x + (GGen_Index) width * y].y * this->deltaT > 1){
                 GGen_Script_Error("Erosion error: Too long velocity vector.");
             }
 		}
@@ -286,18 +296,19 @@ void GGen_ErosionSimulator::ApplyFlowSimulation(double* heightMap, double* water
 	delete [] waterMapCopy;
 }
 
-void GGen_ErosionSimulator::ApplyErosion( double* heightMap, double* waterMap, GGen_VelocityVector* velocityVectorMap, double* sedimentMap )
+template <class T>
+void GGen_ErosionSimulator<T>::ApplyErosion( T* heightMap, T* waterMap, GGen_VelocityVector<T>* velocityVectorMap, T* sedimentMap )
 {
-	double* sedimentToMoveMap = new double[this->length];
+	T* sedimentToMoveMap = new T[this->length];
     
 	// Update sediment amount carried by water in the current tile	
 	for(GGen_Coord y = 0; y < this->height; y++){
 		for(GGen_Coord x = 0; x < this->width; x++){
-			GGen_Index currentIndex = x + this->width * y;
+			GGen_Index currentIndex = x + (GGen_Index) this->width * y;
 
             sedimentToMoveMap[currentIndex] = 0;
 
-            GGen_VelocityVector currentVelocityVector = velocityVectorMap[currentIndex];
+            GGen_VelocityVector<T> currentVelocityVector = velocityVectorMap[currentIndex];
 
             //currentVelocityVector.x *= -1;
 			//currentVelocityVector.y *= -1;
@@ -406,7 +417,7 @@ void GGen_ErosionSimulator::ApplyErosion( double* heightMap, double* waterMap, G
 
 			double originalHeight = heightMap[currentIndex];
 
-			if(sedimentMap[x + this->width * y] < 0){
+			if(sedimentMap[x + (GGen_Index) this->width * y] < 0){
 				GGen_Script_Error("Erosion error: Negative sediment bef1ore update.");
 			}
 
@@ -451,8 +462,8 @@ void GGen_ErosionSimulator::ApplyErosion( double* heightMap, double* waterMap, G
 
 	for(GGen_Coord y = 0; y < this->height; y++){
 		for(GGen_Coord x = 0; x < this->width; x++){
-			GGen_Index currentIndex = x + this->width * y;
-			GGen_VelocityVector currentVelocityVector = velocityVectorMap[currentIndex];
+			GGen_Index currentIndex = x + (GGen_Index) this->width * y;
+			GGen_VelocityVector<T> currentVelocityVector = velocityVectorMap[currentIndex];
 
 			// Move the sediment according to the velocity field map
 			if(sedimentToMoveMap[currentIndex] == 0) continue;			
@@ -535,16 +546,17 @@ void GGen_ErosionSimulator::ApplyErosion( double* heightMap, double* waterMap, G
 	delete [] sedimentToMoveMap;
 }
 
-void GGen_ErosionSimulator::ApplyThermalWeathering(double* heightMap, double powerMultiplier){
+template <class T>
+void GGen_ErosionSimulator<T>::ApplyThermalWeathering(T* heightMap, double powerMultiplier){
     //GGen_ThermalWeatheringValues* weatheringData = new GGen_ThermalWeatheringValues[this->length];
     //memset(weatheringData, 0, this->length * sizeof(GGen_ThermalWeatheringValues));
 
-    double* heightMapCopy = new double[this->length];
-    memcpy(heightMapCopy, heightMap, this->length * sizeof(double));
+    T* heightMapCopy = new T[this->length];
+    memcpy(heightMapCopy, heightMap, this->length * sizeof(T));
 
     for(GGen_Coord y = 0; y < this->height; y++){
 		for(GGen_Coord x = 0; x < this->width; x++){
-			GGen_Index currentIndex = x + this->width * y;
+			GGen_Index currentIndex = x + (GGen_Index) this->width * y;
             double currentHeight = heightMap[currentIndex];
 
             double heightDiffTopLeft = 0;
@@ -678,3 +690,102 @@ void GGen_ErosionSimulator::ApplyThermalWeathering(double* heightMap, double pow
     //delete [] weatheringData;
     delete [] heightMapCopy;
 }
+
+template <class T>
+void GGen_ErosionSimulator<T>::FlowMap(T* heightMap, T* waterMap, double duration, double waterAmount){
+    memset(waterMap, 0, this->length * sizeof(T));
+
+    GGen_OutflowValues<T>* outflowFluxMap = new GGen_OutflowValues<T>[this->length];
+
+    memset(outflowFluxMap, 0, this->length * sizeof(GGen_OutflowValues<T>));
+
+    for(double tRemaining = duration; tRemaining > 0; tRemaining -= this->deltaT){
+        this->ApplyWaterSources(waterMap, waterAmount);
+        this->ApplyFlowSimulation(heightMap, waterMap, outflowFluxMap, NULL);
+        this->ApplyEvaporation(waterMap);
+    }
+
+    for(GGen_Index i = 0; i < this->length; i++){
+        if(heightMap[i] <= 0){
+            waterMap[i] = 0;
+        }
+    }
+
+    delete [] outflowFluxMap;
+}
+
+template <class T>
+void GGen_ErosionSimulator<T>::ThermalWeathering(T* heightMap, double duration, double talusAngle){
+    this->talusAngle = talusAngle;
+
+    this->deltaT = 0.1;
+
+    for(double tRemaining = duration; tRemaining > 0; tRemaining -= this->deltaT){
+        this->ApplyThermalWeathering(heightMap, 4);
+    }
+}
+
+template <class T>
+void GGen_ErosionSimulator<T>::Erosion(T* heightMap, double duration, double thermalWeatheringAmount, double waterAmount){
+	T* waterMap = new T[this->length];
+	T* sedimentMap = new T[this->length];
+	GGen_OutflowValues<T>* outflowFluxMap = new GGen_OutflowValues<T>[this->length];
+    GGen_VelocityVector<T>* velocityVectorMap = new GGen_VelocityVector<T>[this->length];
+
+	// Initialize values in maps to zero where necessary
+	for(GGen_Coord y = 0; y < this->height; y++){
+		for(GGen_Coord x = 0; x < this->width; x++){
+			GGen_Index currentIndex = x + y * (GGen_Index) this->width;
+
+			waterMap[currentIndex] = 0;
+			outflowFluxMap[currentIndex].left = 0;
+			outflowFluxMap[currentIndex].right = 0;
+			outflowFluxMap[currentIndex].top = 0;
+			outflowFluxMap[currentIndex].bottom = 0;
+			sedimentMap[currentIndex] = 0;
+		}
+	}
+
+    GGen::GetInstance()->ThrowMessage(GGen_Const_String("Starting erosion..."), GGEN_MESSAGE);
+
+	for(double tRemaining = duration; tRemaining > 0; tRemaining -= this->deltaT){
+		if(tRemaining >= this->deltaT){
+            GGen_StringStream ss;
+            ss << GGen_Const_String("Erosion time remaining: ");
+            ss << tRemaining;
+            GGen::GetInstance()->ThrowMessage(ss.str(), GGEN_MESSAGE);
+        }
+
+		this->ApplyWaterSources(waterMap, 0.05 * waterAmount);
+
+		this->ApplyFlowSimulation(heightMap, waterMap, outflowFluxMap, velocityVectorMap);
+
+        this->ApplyErosion(heightMap, waterMap, velocityVectorMap, sedimentMap);
+
+        this->ApplyThermalWeathering(heightMap, thermalWeatheringAmount);
+
+		this->ApplyEvaporation(waterMap);
+
+        double maxLength = 0;
+        for(GGen_Index i = 0; i < this->length; i++){
+            double length = sqrt((double) velocityVectorMap[i].x * velocityVectorMap[i].x + (double) velocityVectorMap[i].y * velocityVectorMap[i].y);
+            if(length > maxLength){
+                maxLength = length;
+            }
+        }
+
+        this->deltaT = 1 / (1.5 * maxLength);
+        this->deltaT = MIN(this->deltaT, 0.05);
+	}
+
+    GGen::GetInstance()->ThrowMessage(GGen_Const_String("Finished erosion..."), GGEN_MESSAGE);
+
+	delete [] waterMap;
+	delete [] sedimentMap;
+	delete [] outflowFluxMap;
+    delete [] velocityVectorMap;
+}
+
+/* GGen_Data_2D simulates in doubles, GGen_Float_2D directly in its own array */
+template class GGen_ErosionSimulator<double>;
+template class GGen_ErosionSimulator<float>;
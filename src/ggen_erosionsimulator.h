@@ -28,16 +28,18 @@
 #include "ggen_data_2d.h"
 #include <list>
 
+template <class T>
 struct GGen_VelocityVector{
-	double x;
-	double y;
+	T x;
+	T y;
 };
 
+template <class T>
 struct GGen_OutflowValues{
-	double left;
-	double right;
-	double top;
-	double bottom;
+	T left;
+	T right;
+	T top;
+	T bottom;
 };
 
 struct GGen_ThermalWeatheringValues{
@@ -51,6 +53,12 @@ struct GGen_ThermalWeatheringValues{
     double left;
 };
 
+/**
+ * Simulates erosion over arrays of type T, in which heights are stored in range (-100, 100). GGen_Data_2D imports its
+ * values into a double array, GGen_Float_2D simulates directly in its float array (the computations themselves are
+ * done in double precision in both cases).
+ **/
+template <class T>
 class GGen_ErosionSimulator{
 	public:
 		GGen_Size width;
@@ -67,13 +75,39 @@ class GGen_ErosionSimulator{
         double talusAngle;
 	
 		GGen_ErosionSimulator(GGen_Size width, GGen_Size height);
-		double* ImportHeightMap(GGen_Data_2D& heightMap);
-		double GetSurfaceTilt(double* heightMap, GGen_Coord x, GGen_Coord y );
-		double ExportHeightMap(double* heightMap, GGen_Data_2D& ggenHeightMap);
-		void ExportVelocityVectorMap(GGen_VelocityVector* velocityVectorMap, GGen_Data_2D& ggenHeightMap);		
-		void ApplyWaterSources(double* waterMap, double waterAmount);
-		void ApplyEvaporation(double* waterMap);
-		void ApplyFlowSimulation(double* heightMap, double* waterMap, GGen_OutflowValues* outflowFluxMap, GGen_VelocityVector* velocityVectorMap );
-		void ApplyErosion(double* heightMap, double* waterMap, GGen_VelocityVector* velocityVectorMap, double* sedimentMap);
-        void ApplyThermalWeathering(double* heightMap, double powerMultiplier = 1);
+		T* ImportHeightMap(GGen_Data_2D& heightMap);
+		double GetSurfaceTilt(T* heightMap, GGen_Coord x, GGen_Coord y );
+		double ExportHeightMap(T* heightMap, GGen_Data_2D& ggenHeightMap);
+		void ExportVelocityVectorMap(GGen_VelocityVector<T>* velocityVectorMap, GGen_Data_2D& ggenHeightMap);		
+		void ApplyWaterSources(T* waterMap, double waterAmount);
+		void ApplyEvaporation(T* waterMap);
+		void ApplyFlowSimulation(T* heightMap, T* waterMap, GGen_OutflowValues<T>* outflowFluxMap, GGen_VelocityVector<T>* velocityVectorMap );
+		void ApplyErosion(T* heightMap, T* waterMap, GGen_VelocityVector<T>* velocityVectorMap, T* sedimentMap);
+        void ApplyThermalWeathering(T* heightMap, double powerMultiplier = 1);
+
+		/**
+		 * Simulates water flowing over the height map.
+		 * @param heightMap The height map (it is not modified).
+		 * @param waterMap Array the final depth of water is stored to (zero in tiles below or at the sea level).
+		 * @param duration Duration of the simulation.
+		 * @param waterAmount Water amount multiplier in (0, 10) range.
+		 **/
+		void FlowMap(T* heightMap, T* waterMap, double duration, double waterAmount);
+
+		/**
+		 * Applies thermal erosion onto the height map.
+		 * @param heightMap The height map.
+		 * @param duration Duration of the simulation.
+		 * @param talusAngle Angle towards which will all slopes be eroded.
+		 **/
+		void ThermalWeathering(T* heightMap, double duration, double talusAngle);
+
+		/**
+		 * Applies hydraulic and thermal erosion onto the height map.
+		 * @param heightMap The height map.
+		 * @param duration Duration of the simulation.
+		 * @param thermalWeatheringAmount Thermal weathering effect multiplier.
+		 * @param waterAmount Water amount multiplier in (0, 10) range.
+		 **/
+		void Erosion(T* heightMap, double duration, double thermalWeatheringAmount, double waterAmount);
 };
\ No newline at end of file
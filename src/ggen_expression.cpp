@@ -0,0 +1,586 @@
+/*
+
+    This file is part of GeoGen.
+
+    GeoGen is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    GeoGen is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GeoGen.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <cmath>
+
+#include "ggen.h"
+#include "ggen_support.h"
+#include "ggen_expression.h"
+
+GGen_Expression::GGen_Expression(const GGen_String& expression, uint16 map_count, GGen_Size width, GGen_Size height)
+: stack_depth(0), source(&expression), position(0), map_count(map_count), width(width), height(height), current_depth(0), nesting_depth(0)
+{
+	this->ParseConditional();
+
+	this->SkipWhitespace();
+
+	if (this->position < this->source->size()) {
+		this->Error(GGen_Const_String("unexpected character"));
+	}
+
+	this->source = NULL;
+}
+
+void GGen_Expression::Error(const GGen_Char* message)
+{
+	GGen_StringStream ss;
+	ss << GGen_Const_String("Expression error at character ") << (this->position + 1) << GGen_Const_String(": ") << message;
+
+	GGen::GetInstance()->ThrowMessage(ss.str(), GGEN_ERROR, -1);
+	throw GGen_ScriptAssertException();
+}
+
+void GGen_Expression::EnterNesting()
+{
+	if (this->nesting_depth >= GGEN_EXPRESSION_MAX_NESTING) {
+		this->Error(GGen_Const_String("expression is too complex"));
+	}
+
+	this->nesting_depth++;
+}
+
+void GGen_Expression::SkipWhitespace()
+{
+	while (this->position < this->source->size()) {
+		GGen_Char current = (*this->source)[this->position];
+
+		if (current != GGen_Const_String(' ') && current != GGen_Const_String('\t') && current != GGen_Const_String('\r') && current != GGen_Const_String('\n')) break;
+
+		this->position++;
+	}
+}
+
+bool GGen_Expression::Accept(const GGen_Char* token)
+{
+	this->SkipWhitespace();
+
+	size_t length = GGen_Strlen(token);
+
+	if (this->source->compare(this->position, length, token) != 0) return false;
+
+	this->position += length;
+
+	return true;
+}
+
+void GGen_Expression::Expect(const GGen_Char* token)
+{
+	if (!this->Accept(token)) {
+		GGen_String message = GGen_Const_String("expected ");
+		message += token;
+
+		this->Error(message.c_str());
+	}
+}
+
+double GGen_Expression::ParseNumber()
+{
+	double value = 0;
+	bool has_digits = false;
+
+	while (this->position < this->source->size() && (*this->source)[this->position] >= GGen_Const_String('0') && (*this->source)[this->position] <= GGen_Const_String('9')) {
+		value = value * 10 + ((*this->source)[this->position] - GGen_Const_String('0'));
+		has_digits = true;
+		this->position++;
+	}
+
+	if (this->position < this->source->size() && (*this->source)[this->position] == GGen_Const_String('.')) {
+		this->position++;
+
+		double scale = 1;
+
+		while (this->position < this->source->size() && (*this->source)[this->position] >= GGen_Const_String('0') && (*this->source)[this->position] <= GGen_Const_String('9')) {
+			scale /= 10;
+			value += scale * ((*this->source)[this->position] - GGen_Const_String('0'));
+			has_digits = true;
+			this->position++;
+		}
+	}
+
+	if (!has_digits) {
+		this->Error(GGen_Const_String("number expected"));
+	}
+
+	return value;
+}
+
+GGen_String GGen_Expression::ParseIdentifier()
+{
+	size_t start = this->position;
+
+	while (this->position < this->source->size()) {
+		GGen_Char current = (*this->source)[this->position];
+
+		if (!(current >= GGen_Const_String('a') && current <= GGen_Const_String('z')) &&
+			!(current >= GGen_Const_String('A') && current <= GGen_Const_String('Z')) &&
+			!(current >= GGen_Const_String('0') && current <= GGen_Const_String('9')) &&
+			current != GGen_Const_String('_')) break;
+
+		this->position++;
+	}
+
+	return this->source->substr(start, this->position - start);
+}
+
+void GGen_Expression::ParseConditional()
+{
+	this->ParseOr();
+
+	if (this->Accept(GGen_Const_String("?"))) {
+		this->EnterNesting();
+
+		this->ParseConditional();
+		this->Expect(GGen_Const_String(":"));
+		this->ParseConditional();
+
+		this->nesting_depth--;
+
+		this->Emit(GGEN_EXPRESSION_SELECT);
+	}
+}
+
+void GGen_Expression::ParseOr()
+{
+	this->ParseAnd();
+
+	while (this->Accept(GGen_Const_String("||"))) {
+		this->ParseAnd();
+		this->Emit(GGEN_EXPRESSION_OR);
+	}
+}
+
+void GGen_Expression::ParseAnd()
+{
+	this->ParseEquality();
+
+	while (this->Accept(GGen_Const_String("&&"))) {
+		this->ParseEquality();
+		this->Emit(GGEN_EXPRESSION_AND);
+	}
+}
+
+void GGen_Expression::ParseEquality()
+{
+	this->ParseRelational();
+
+	while (true) {
+		if (this->Accept(GGen_Const_String("=="))) {
+			this->ParseRelational();
+			this->Emit(GGEN_EXPRESSION_EQUAL_TO);
+		} else if (this->Accept(GGen_Const_String("!="))) {
+			this->ParseRelational();
+			this->Emit(GGEN_EXPRESSION_NOT_EQUAL_TO);
+		} else {
+			break;
+		}
+	}
+}
+
+void GGen_Expression::ParseRelational()
+{
+	this->ParseAdditive();
+
+	while (true) {
+		/* The two character operators must be tried first */
+		if (this->Accept(GGen_Const_String("<="))) {
+			this->ParseAdditive();
+			this->Emit(GGEN_EXPRESSION_LESS_THAN_OR_EQUAL_TO);
+		} else if (this->Accept(GGen_Const_String("<"))) {
+			this->ParseAdditive();
+			this->Emit(GGEN_EXPRESSION_LESS_THAN);
+		} else if (this->Accept(GGen_Const_String(">="))) {
+			this->ParseAdditive();
+			this->Emit(GGEN_EXPRESSION_GREATER_THAN_OR_EQUAL_TO);
+		} else if (this->Accept(GGen_Const_String(">"))) {
+			this->ParseAdditive();
+			this->Emit(GGEN_EXPRESSION_GREATER_THAN);
+		} else {
+			break;
+		}
+	}
+}
+
+void GGen_Expression::ParseAdditive()
+{
+	this->ParseMultiplicative();
+
+	while (true) {
+		if (this->Accept(GGen_Const_String("+"))) {
+			this->ParseMultiplicative();
+			this->Emit(GGEN_EXPRESSION_ADD);
+		} else if (this->Accept(GGen_Const_String("-"))) {
+			this->ParseMultiplicative();
+			this->Emit(GGEN_EXPRESSION_SUBTRACT);
+		} else {
+			break;
+		}
+	}
+}
+
+void GGen_Expression::ParseMultiplicative()
+{
+	this->ParseUnary();
+
+	while (true) {
+		if (this->Accept(GGen_Const_String("*"))) {
+			this->ParseUnary();
+			this->Emit(GGEN_EXPRESSION_MULTIPLY);
+		} else if (this->Accept(GGen_Const_String("/"))) {
+			this->ParseUnary();
+			this->Emit(GGEN_EXPRESSION_DIVIDE);
+		} else if (this->Accept(GGen_Const_String("%"))) {
+			this->ParseUnary();
+			this->Emit(GGEN_EXPRESSION_MODULO);
+		} else {
+			break;
+		}
+	}
+}
+
+void GGen_Expression::ParseUnary()
+{
+	if (this->Accept(GGen_Const_String("-"))) {
+		this->EnterNesting();
+		this->ParseUnary();
+		this->nesting_depth--;
+		this->Emit(GGEN_EXPRESSION_NEGATE);
+	} else if (this->Accept(GGen_Const_String("+"))) {
+		this->EnterNesting();
+		this->ParseUnary();
+		this->nesting_depth--;
+	} else if (this->Accept(GGen_Const_String("!"))) {
+		this->EnterNesting();
+		this->ParseUnary();
+		this->nesting_depth--;
+		this->Emit(GGEN_EXPRESSION_NOT);
+	} else {
+		this->ParsePrimary();
+	}
+}
+
+void GGen_Expression::ParsePrimary()
+{
+	this->SkipWhitespace();
+
+	if (this->position >= this->source->size()) {
+		this->Error(GGen_Const_String("value expected"));
+	}
+
+	GGen_Char current = (*this->source)[this->position];
+
+	if ((current >= GGen_Const_String('0') && current <= GGen_Const_String('9')) || current == GGen_Const_String('.')) {
+		this->Emit(GGEN_EXPRESSION_CONSTANT, this->ParseNumber());
+		return;
+	}
+
+	if (this->Accept(GGen_Const_String("("))) {
+		this->EnterNesting();
+		this->ParseConditional();
+		this->Expect(GGen_Const_String(")"));
+		this->nesting_depth--;
+		return;
+	}
+
+	size_t start = this->position;
+	GGen_String name = this->ParseIdentifier();
+
+	if (name.empty()) {
+		this->Error(GGen_Const_String("value expected"));
+	}
+
+	/* Function call */
+	if (this->Accept(GGen_Const_String("("))) {
+		this->EnterNesting();
+
+		if (name == GGen_Const_String("clamp")) {
+			/* clamp(value, min, max) = min(max(value, min), max) */
+			this->ParseConditional();
+			this->Expect(GGen_Const_String(","));
+			this->ParseConditional();
+			this->Emit(GGEN_EXPRESSION_MAX);
+			this->Expect(GGen_Const_String(","));
+			this->ParseConditional();
+			this->Emit(GGEN_EXPRESSION_MIN);
+			this->Expect(GGen_Const_String(")"));
+			this->nesting_depth--;
+			return;
+		}
+
+		GGen_Expression_Opcode opcode = GGEN_EXPRESSION_ABS;
+		uint16 argument_count = 1;
+
+		if (name == GGen_Const_String("min")) { opcode = GGEN_EXPRESSION_MIN; argument_count = 2; }
+		else if (name == GGen_Const_String("max")) { opcode = GGEN_EXPRESSION_MAX; argument_count = 2; }
+		else if (name == GGen_Const_String("pow")) { opcode = GGEN_EXPRESSION_POWER; argument_count = 2; }
+		else if (name == GGen_Const_String("abs")) opcode = GGEN_EXPRESSION_ABS;
+		else if (name == GGen_Const_String("sqrt")) opcode = GGEN_EXPRESSION_SQRT;
+		else if (name == GGen_Const_String("floor")) opcode = GGEN_EXPRESSION_FLOOR;
+		else if (name == GGen_Const_String("sin")) opcode = GGEN_EXPRESSION_SIN;
+		else if (name == GGen_Const_String("cos")) opcode = GGEN_EXPRESSION_COS;
+		else {
+			this->position = start;
+			this->Error(GGen_Const_String("unknown function"));
+		}
+
+		for (uint16 i = 0; i < argument_count; i++) {
+			if (i > 0) this->Expect(GGen_Const_String(","));
+
+			this->ParseConditional();
+		}
+
+		this->Expect(GGen_Const_String(")"));
+		this->nesting_depth--;
+
+		this->Emit(opcode);
+		return;
+	}
+
+	if (name == GGen_Const_String("v")) this->Emit(GGEN_EXPRESSION_VALUE);
+	else if (name == GGen_Const_String("x")) this->Emit(GGEN_EXPRESSION_X);
+	else if (name == GGen_Const_String("y")) this->Emit(GGEN_EXPRESSION_Y);
+	else if (name == GGen_Const_String("width")) this->Emit(GGEN_EXPRESSION_CONSTANT, this->width);
+	else if (name == GGen_Const_String("height")) this->Emit(GGEN_EXPRESSION_CONSTANT, this->height);
+	else if (name == GGen_Const_String("pi")) this->Emit(GGEN_EXPRESSION_CONSTANT, 3.14159265358979);
+	else if (name.size() > 1 && name[0] == GGen_Const_String('m') && name.find_first_not_of(GGen_Const_String("0123456789"), 1) == GGen_String::npos) {
+		/* Map reference (m0, m1...) */
+		uint32 index = 0;
+
+		for (size_t i = 1; i < name.size() && index < this->map_count; i++) {
+			index = index * 10 + (name[i] - GGen_Const_String('0'));
+		}
+
+		if (index >= this->map_count) {
+			this->position = start;
+			this->Error(GGen_Const_String("map index out of range"));
+		}
+
+		this->Emit(GGEN_EXPRESSION_MAP, 0, (uint16) index);
+	}
+	else {
+		this->position = start;
+		this->Error(GGen_Const_String("unknown identifier"));
+	}
+}
+
+uint16 GGen_Expression::GetOperandCount(GGen_Expression_Opcode opcode)
+{
+	switch (opcode) {
+		case GGEN_EXPRESSION_CONSTANT:
+		case GGEN_EXPRESSION_VALUE:
+		case GGEN_EXPRESSION_MAP:
+		case GGEN_EXPRESSION_X:
+		case GGEN_EXPRESSION_Y:
+			return 0;
+		case GGEN_EXPRESSION_NEGATE:
+		case GGEN_EXPRESSION_NOT:
+		case GGEN_EXPRESSION_ABS:
+		case GGEN_EXPRESSION_SQRT:
+		case GGEN_EXPRESSION_FLOOR:
+		case GGEN_EXPRESSION_SIN:
+		case GGEN_EXPRESSION_COS:
+			return 1;
+		case GGEN_EXPRESSION_SELECT:
+			return 3;
+		default:
+			return 2;
+	}
+}
+
+void GGen_Expression::Emit(GGen_Expression_Opcode opcode, double constant, uint16 map)
+{
+	uint16 operand_count = GGen_Expression::GetOperandCount(opcode);
+
+	/* Operations with constant operands are evaluated right away */
+	if (operand_count > 0 && this->instructions.size() >= operand_count) {
+		bool constant_operands = true;
+
+		for (size_t i = this->instructions.size() - operand_count; i < this->instructions.size(); i++) {
+			constant_operands = constant_operands && this->instructions[i].opcode == GGEN_EXPRESSION_CONSTANT;
+		}
+
+		if (constant_operands) {
+			double operands[3];
+
+			for (uint16 i = 0; i < operand_count; i++) {
+				operands[i] = this->instructions[this->instructions.size() - operand_count + i].constant;
+			}
+
+			GGen_Expression::ExecuteOperation(opcode, &operands[0], &operands[1], &operands[2], 1);
+
+			this->instructions.resize(this->instructions.size() - operand_count + 1);
+			this->instructions.back().constant = operands[0];
+			this->current_depth -= operand_count - 1;
+			return;
+		}
+	}
+
+	GGen_Expression_Instruction instruction;
+	instruction.opcode = opcode;
+	instruction.constant = constant;
+	instruction.map = map;
+
+	this->instructions.push_back(instruction);
+
+	if (operand_count == 0) {
+		if (this->current_depth >= GGEN_EXPRESSION_MAX_DEPTH) {
+			this->Error(GGen_Const_String("expression is too complex"));
+		}
+
+		this->current_depth++;
+		this->stack_depth = MAX(this->stack_depth, this->current_depth);
+	} else {
+		this->current_depth -= operand_count - 1;
+	}
+}
+
+void GGen_Expression::ExecuteOperation(GGen_Expression_Opcode opcode, double* a, const double* b, const double* c, uint16 count)
+{
+	switch (opcode) {
+		case GGEN_EXPRESSION_NEGATE:
+			for (uint16 i = 0; i < count; i++) a[i] = -a[i];
+			break;
+		case GGEN_EXPRESSION_NOT:
+			for (uint16 i = 0; i < count; i++) a[i] = a[i] == 0 ? 1 : 0;
+			break;
+		case GGEN_EXPRESSION_ABS:
+			for (uint16 i = 0; i < count; i++) a[i] = fabs(a[i]);
+			break;
+		case GGEN_EXPRESSION_SQRT:
+			for (uint16 i = 0; i < count; i++) a[i] = a[i] > 0 ? sqrt(a[i]) : 0;
+			break;
+		case GGEN_EXPRESSION_FLOOR:
+			for (uint16 i = 0; i < count; i++) a[i] = floor(a[i]);
+			break;
+		case GGEN_EXPRESSION_SIN:
+			for (uint16 i = 0; i < count; i++) a[i] = sin(a[i]);
+			break;
+		case GGEN_EXPRESSION_COS:
+			for (uint16 i = 0; i < count; i++) a[i] = cos(a[i]);
+			break;
+		case GGEN_EXPRESSION_ADD:
+			for (uint16 i = 0; i < count; i++) a[i] = a[i] + b[i];
+			break;
+		case GGEN_EXPRESSION_SUBTRACT:
+			for (uint16 i = 0; i < count; i++) a[i] = a[i] - b[i];
+			break;
+		case GGEN_EXPRESSION_MULTIPLY:
+			for (uint16 i = 0; i < count; i++) a[i] = a[i] * b[i];
+			break;
+		case GGEN_EXPRESSION_DIVIDE:
+			for (uint16 i = 0; i < count; i++) a[i] = b[i] != 0 ? a[i] / b[i] : 0;
+			break;
+		case GGEN_EXPRESSION_MODULO:
+			for (uint16 i = 0; i < count; i++) a[i] = b[i] != 0 ? fmod(a[i], b[i]) : 0;
+			break;
+		case GGEN_EXPRESSION_POWER:
+			for (uint16 i = 0; i < count; i++) a[i] = pow(a[i], b[i]);
+			break;
+		case GGEN_EXPRESSION_MIN:
+			for (uint16 i = 0; i < count; i++) a[i] = MIN(a[i], b[i]);
+			break;
+		case GGEN_EXPRESSION_MAX:
+			for (uint16 i = 0; i < count; i++) a[i] = MAX(a[i], b[i]);
+			break;
+		case GGEN_EXPRESSION_LESS_THAN:
+			for (uint16 i = 0; i < count; i++) a[i] = a[i] < b[i] ? 1 : 0;
+			break;
+		case GGEN_EXPRESSION_LESS_THAN_OR_EQUAL_TO:
+			for (uint16 i = 0; i < count; i++) a[i] = a[i] <= b[i] ? 1 : 0;
+			break;
+		case GGEN_EXPRESSION_GREATER_THAN:
+			for (uint16 i = 0; i < count; i++) a[i] = a[i] > b[i] ? 1 : 0;
+			break;
+		case GGEN_EXPRESSION_GREATER_THAN_OR_EQUAL_TO:
+			for (uint16 i = 0; i < count; i++) a[i] = a[i] >= b[i] ? 1 : 0;
+			break;
+		case GGEN_EXPRESSION_EQUAL_TO:
+			for (uint16 i = 0; i < count; i++) a[i] = a[i] == b[i] ? 1 : 0;
+			break;
+		case GGEN_EXPRESSION_NOT_EQUAL_TO:
+			for (uint16 i = 0; i < count; i++) a[i] = a[i] != b[i] ? 1 : 0;
+			break;
+		case GGEN_EXPRESSION_AND:
+			for (uint16 i = 0; i < count; i++) a[i] = a[i] != 0 && b[i] != 0 ? 1 : 0;
+			break;
+		case GGEN_EXPRESSION_OR:
+			for (uint16 i = 0; i < count; i++) a[i] = a[i] != 0 || b[i] != 0 ? 1 : 0;
+			break;
+		case GGEN_EXPRESSION_SELECT:
+			/* Both branches are already evaluated, so the selection is branch-free */
+			for (uint16 i = 0; i < count; i++) a[i] = a[i] != 0 ? b[i] : c[i];
+			break;
+		default:
+			break;
+	}
+}
+
+void GGen_Expression::Evaluate(GGen_Coord x, GGen_Coord y, uint16 count, const GGen_Height* values, const GGen_Height* const* maps, double* stack, GGen_Height* output) const
+{
+	double* top = stack;
+
+	for (size_t j = 0; j < this->instructions.size(); j++) {
+		const GGen_Expression_Instruction& instruction = this->instructions[j];
+
+		switch (instruction.opcode) {
+			case GGEN_EXPRESSION_CONSTANT:
+				for (uint16 i = 0; i < count; i++) top[i] = instruction.constant;
+				top += GGEN_EXPRESSION_BLOCK_SIZE;
+				break;
+			case GGEN_EXPRESSION_VALUE:
+				for (uint16 i = 0; i < count; i++) top[i] = values[i];
+				top += GGEN_EXPRESSION_BLOCK_SIZE;
+				break;
+			case GGEN_EXPRESSION_MAP: {
+				const GGen_Height* map = maps[instruction.map];
+				for (uint16 i = 0; i < count; i++) top[i] = map[i];
+				top += GGEN_EXPRESSION_BLOCK_SIZE;
+				break;
+			}
+			case GGEN_EXPRESSION_X:
+				for (uint16 i = 0; i < count; i++) top[i] = x + i;
+				top += GGEN_EXPRESSION_BLOCK_SIZE;
+				break;
+			case GGEN_EXPRESSION_Y:
+				for (uint16 i = 0; i < count; i++) top[i] = y;
+				top += GGEN_EXPRESSION_BLOCK_SIZE;
+				break;
+			default: {
+				uint16 operand_count = GGen_Expression::GetOperandCount(instruction.opcode);
+
+				/* The result replaces the first operand */
+				top -= operand_count * GGEN_EXPRESSION_BLOCK_SIZE;
+				GGen_Expression::ExecuteOperation(instruction.opcode, top, top + GGEN_EXPRESSION_BLOCK_SIZE, top + 2 * GGEN_EXPRESSION_BLOCK_SIZE, count);
+				top += GGEN_EXPRESSION_BLOCK_SIZE;
+				break;
+			}
+		}
+	}
+
+	for (uint16 i = 0; i < count; i++) {
+		/* Undefined results (NaN) become zero */
+		double result = stack[i] == stack[i] ? MIN(MAX(stack[i], (double) GGEN_MIN_HEIGHT), (double) GGEN_MAX_HEIGHT) : 0;
+
+		output[i] = (GGen_Height) result;
+	}
+}
+
+uint16 GGen_Expression::GetStackDepth() const
+{
+	return this->stack_depth;
+}
@@ -0,0 +1,182 @@
+/*
+
+    This file is part of GeoGen.
+
+    GeoGen is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    GeoGen is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GeoGen.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/**
+ * @file ggen_expression.h GGen_Expression compiles per-tile formulas used by GGen_Data_2D::Evaluate.
+ **/
+
+#pragma once
+
+#include <vector>
+
+#include "ggen_support.h"
+
+using namespace std;
+
+/* Number of tiles each instruction is executed on at once */
+#define GGEN_EXPRESSION_BLOCK_SIZE 256
+
+/* Maximum number of intermediate results an expression may need at once */
+#define GGEN_EXPRESSION_MAX_DEPTH 64
+
+/* Maximum nesting of parentheses, function calls, prefix operators and conditionals (the parser is recursive) */
+#define GGEN_EXPRESSION_MAX_NESTING 256
+
+/**
+ * @internal Instructions of the compiled expression. The operands are taken from the top of the stack and replaced
+ * with the result.
+ **/
+enum GGen_Expression_Opcode{
+	GGEN_EXPRESSION_CONSTANT,
+	GGEN_EXPRESSION_VALUE,
+	GGEN_EXPRESSION_MAP,
+	GGEN_EXPRESSION_X,
+	GGEN_EXPRESSION_Y,
+	GGEN_EXPRESSION_NEGATE,
+	GGEN_EXPRESSION_NOT,
+	GGEN_EXPRESSION_ABS,
+	GGEN_EXPRESSION_SQRT,
+	GGEN_EXPRESSION_FLOOR,
+	GGEN_EXPRESSION_SIN,
+	GGEN_EXPRESSION_COS,
+	GGEN_EXPRESSION_ADD,
+	GGEN_EXPRESSION_SUBTRACT,
+	GGEN_EXPRESSION_MULTIPLY,
+	GGEN_EXPRESSION_DIVIDE,
+	GGEN_EXPRESSION_MODULO,
+	GGEN_EXPRESSION_POWER,
+	GGEN_EXPRESSION_MIN,
+	GGEN_EXPRESSION_MAX,
+	GGEN_EXPRESSION_LESS_THAN,
+	GGEN_EXPRESSION_LESS_THAN_OR_EQUAL_TO,
+	GGEN_EXPRESSION_GREATER_THAN,
+	GGEN_EXPRESSION_GREATER_THAN_OR_EQUAL_TO,
+	GGEN_EXPRESSION_EQUAL_TO,
+	GGEN_EXPRESSION_NOT_EQUAL_TO,
+	GGEN_EXPRESSION_AND,
+	GGEN_EXPRESSION_OR,
+	GGEN_EXPRESSION_SELECT
+};
+
+/**
+ * @internal One instruction of the compiled expression.
+ **/
+struct GGen_Expression_Instruction{
+	GGen_Expression_Opcode opcode;
+
+	/* Value pushed by GGEN_EXPRESSION_CONSTANT */
+	double constant;
+
+	/* Map read by GGEN_EXPRESSION_MAP */
+	uint16 map;
+};
+
+/**
+ * @internal Per-tile expression compiled into a sequence of stack machine instructions. Each instruction is executed
+ * on a whole block of tiles before the next one, so the inner loops are short and simple enough to be vectorized.
+ *
+ * The expression works with real numbers. It can use:
+ * - the current value of the tile (v), its coordinates (x, y) and the map size (width, height),
+ * - values of the same tile in the other maps (m0, m1...),
+ * - decimal constants,
+ * - operators + - * / % (arithmetic), < <= > >= == != (comparison), && || ! (logical) and ?: (conditional),
+ * - functions min(a, b), max(a, b), clamp(value, min, max), abs(a), sqrt(a), floor(a), pow(a, b), sin(a) and cos(a).
+ *
+ * Comparisons and logical operators return 1 for true and 0 for false. Division or modulo by zero returns 0.
+ **/
+class GGen_Expression{
+	protected:
+		vector<GGen_Expression_Instruction> instructions;
+		uint16 stack_depth;
+
+		/* Parser state */
+		const GGen_String* source;
+		size_t position;
+		uint16 map_count;
+		GGen_Size width;
+		GGen_Size height;
+		uint16 current_depth;
+		uint16 nesting_depth;
+
+		void Error(const GGen_Char* message);
+
+		/**
+		 * Enters one more nesting level of the parser. Throws a script error if the expression is nested too deep.
+		 **/
+		void EnterNesting();
+
+		void SkipWhitespace();
+		bool Accept(const GGen_Char* token);
+		void Expect(const GGen_Char* token);
+		double ParseNumber();
+		GGen_String ParseIdentifier();
+
+		void ParseConditional();
+		void ParseOr();
+		void ParseAnd();
+		void ParseEquality();
+		void ParseRelational();
+		void ParseAdditive();
+		void ParseMultiplicative();
+		void ParseUnary();
+		void ParsePrimary();
+
+		/**
+		 * Appends an instruction and keeps track of the needed stack depth. Operations with constant operands are
+		 * evaluated right away.
+		 **/
+		void Emit(GGen_Expression_Opcode opcode, double constant = 0, uint16 map = 0);
+
+		/**
+		 * Returns number of stack items taken by the instruction.
+		 **/
+		static uint16 GetOperandCount(GGen_Expression_Opcode opcode);
+
+		/**
+		 * Executes one operation on count tiles. The operands are arrays of count items.
+		 **/
+		static void ExecuteOperation(GGen_Expression_Opcode opcode, double* a, const double* b, const double* c, uint16 count);
+
+	public:
+		/**
+		 * Compiles the expression. Throws a script error if it is not valid.
+		 * @param expression The expression.
+		 * @param map_count Number of the other maps the expression may read.
+		 * @param width Width of the evaluated map.
+		 * @param height Height of the evaluated map.
+		 **/
+		GGen_Expression(const GGen_String& expression, uint16 map_count, GGen_Size width, GGen_Size height);
+
+		/**
+		 * Evaluates the expression for a run of tiles in one row.
+		 * @param x X coordinate of the first tile.
+		 * @param y Y coordinate of the tiles.
+		 * @param count Number of the tiles (at most GGEN_EXPRESSION_BLOCK_SIZE).
+		 * @param values Current values of the tiles.
+		 * @param maps Values of the tiles in the other maps.
+		 * @param stack Work area of GGEN_EXPRESSION_BLOCK_SIZE * GetStackDepth() items.
+		 * @param output The results (clamped to the valid height range). May be the same array as values.
+		 **/
+		void Evaluate(GGen_Coord x, GGen_Coord y, uint16 count, const GGen_Height* values, const GGen_Height* const* maps, double* stack, GGen_Height* output) const;
+
+		/**
+		 * Returns number of intermediate results the expression needs at once.
+		 **/
+		uint16 GetStackDepth() const;
+};
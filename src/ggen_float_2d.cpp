@@ -0,0 +1,312 @@
+/*
+
+    This file is part of GeoGen.
+
+    GeoGen is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    GeoGen is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GeoGen.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <cstring>
+#include <math.h>
+#include <assert.h>
+
+#include "ggen.h"
+#include "ggen_support.h"
+#include "ggen_data_2d.h"
+#include "ggen_float_2d.h"
+#include "ggen_erosionsimulator.h"
+#include "ggen_threadpool.h"
+
+uint16 GGen_Float_2D::num_instances = 0;
+set<GGen_Float_2D*> GGen_Float_2D::instances;
+
+GGen_Float_2D::GGen_Float_2D(GGen_Size width, GGen_Size height, double value)
+{
+	GGen_Script_Assert(GGen::GetInstance()->GetStatus() != GGEN_LOADING_MAP_INFO);
+
+	GGen_Script_Assert(width > 1 && height > 1);
+	GGen_Script_Assert(width < GGen::GetMaxMapSize());
+	GGen_Script_Assert(height < GGen::GetMaxMapSize());
+
+	GGen_Script_Assert(GGen_Float_2D::num_instances < GGen::GetMaxMapCount());
+	GGen_Float_2D::num_instances++;
+
+	GGen_Float_2D::instances.insert(this);
+
+	this->length = (GGen_Index) width * height;
+	this->width = width;
+	this->height = height;
+
+	/* Allocate the array */
+	this->data = new float[(size_t) this->length];
+
+	GGen_Script_Assert(this->data != NULL);
+
+	this->Fill(value);
+}
+
+GGen_Float_2D::~GGen_Float_2D()
+{
+	assert(GGen_Float_2D::instances.find(this) != GGen_Float_2D::instances.end());
+
+	GGen_Float_2D::num_instances--;
+	GGen_Float_2D::instances.erase(this);
+
+	delete [] this->data;
+}
+
+GGen_Float_2D* GGen_Float_2D::Clone()
+{
+	GGen_Float_2D* victim = new GGen_Float_2D(this->width, this->height, 0);
+
+	memcpy(victim->data, this->data, sizeof(float) * this->length);
+
+	return victim;
+}
+
+GGen_Size GGen_Float_2D::GetWidth()
+{
+	return this->width;
+}
+
+GGen_Size GGen_Float_2D::GetHeight()
+{
+	return this->height;
+}
+
+GGen_Index GGen_Float_2D::GetLength()
+{
+	return this->length;
+}
+
+void GGen_Float_2D::SetValue(GGen_Coord x, GGen_Coord y, double value)
+{
+	GGen_Script_Assert(x < this->width && y < this->height);
+
+	this->data[x + y * (GGen_Index) this->width] = (float) value;
+}
+
+double GGen_Float_2D::GetValue(GGen_Coord x, GGen_Coord y)
+{
+	GGen_Script_Assert(x < this->width && y < this->height);
+
+	return this->data[x + y * (GGen_Index) this->width];
+}
+
+void GGen_Float_2D::Fill(double value)
+{
+	float fill_value = (float) value;
+
+	GGen_ParallelFor(0, this->length, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			this->data[i] = fill_value;
+		}
+	});
+}
+
+void GGen_Float_2D::FromMap(GGen_Data_2D* map)
+{
+	GGen_Script_Assert(map != NULL);
+	GGen_Script_Assert(map->width == this->width && map->height == this->height);
+
+	map->FlushOperations();
+
+	GGen_ParallelFor(0, this->length, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			this->data[i] = map->data[i];
+		}
+	});
+}
+
+void GGen_Float_2D::ToMap(GGen_Data_2D* map)
+{
+	GGen_Script_Assert(map != NULL);
+	GGen_Script_Assert(map->width == this->width && map->height == this->height);
+
+	map->PrepareWrite();
+
+	GGen_ParallelFor(0, this->length, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			double value = floor((double) this->data[i] + 0.5);
+
+			map->data[i] = (GGen_Height) MAX(GGEN_MIN_HEIGHT, MIN(GGEN_MAX_HEIGHT, value));
+		}
+	});
+}
+
+void GGen_Float_2D::Add(double value)
+{
+	GGen_ParallelFor(0, this->length, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			this->data[i] = (float) (this->data[i] + value);
+		}
+	});
+}
+
+void GGen_Float_2D::AddMap(GGen_Float_2D* addend)
+{
+	GGen_Script_Assert(addend != NULL);
+	GGen_Script_Assert(addend->width == this->width && addend->height == this->height);
+
+	GGen_ParallelFor(0, this->length, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			this->data[i] += addend->data[i];
+		}
+	});
+}
+
+void GGen_Float_2D::Multiply(double factor)
+{
+	GGen_ParallelFor(0, this->length, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			this->data[i] = (float) (this->data[i] * factor);
+		}
+	});
+}
+
+void GGen_Float_2D::MultiplyMap(GGen_Float_2D* factor)
+{
+	GGen_Script_Assert(factor != NULL);
+	GGen_Script_Assert(factor->width == this->width && factor->height == this->height);
+
+	GGen_ParallelFor(0, this->length, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			this->data[i] *= factor->data[i];
+		}
+	});
+}
+
+void GGen_Float_2D::Invert()
+{
+	GGen_ParallelFor(0, this->length, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			this->data[i] = -this->data[i];
+		}
+	});
+}
+
+void GGen_Float_2D::Abs()
+{
+	GGen_ParallelFor(0, this->length, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			this->data[i] = fabs(this->data[i]);
+		}
+	});
+}
+
+void GGen_Float_2D::Clamp(double min, double max)
+{
+	GGen_Script_Assert(max > min);
+
+	float min_value = (float) min;
+	float max_value = (float) max;
+
+	GGen_ParallelFor(0, this->length, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			this->data[i] = MAX(min_value, MIN(max_value, this->data[i]));
+		}
+	});
+}
+
+double GGen_Float_2D::Min()
+{
+	float min = this->data[0];
+
+	for (GGen_Index i = 1; i < this->length; i++) {
+		min = MIN(min, this->data[i]);
+	}
+
+	return min;
+}
+
+double GGen_Float_2D::Max()
+{
+	float max = this->data[0];
+
+	for (GGen_Index i = 1; i < this->length; i++) {
+		max = MAX(max, this->data[i]);
+	}
+
+	return max;
+}
+
+void GGen_Float_2D::ScaleValuesTo(double new_min, double new_max)
+{
+	GGen_Script_Assert(new_max > new_min);
+
+	double old_min = this->Min();
+	double old_max = this->Max();
+
+	if (old_max == old_min) return;
+
+	double ratio = (new_max - new_min) / (old_max - old_min);
+
+	GGen_ParallelFor(0, this->length, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			this->data[i] = (float) (new_min + (this->data[i] - old_min) * ratio);
+		}
+	});
+}
+
+void GGen_Float_2D::FlowMap(double duration, double waterAmount)
+{
+	GGen_Script_Assert(duration > 0);
+	GGen_Script_Assert(waterAmount > 0);
+	GGen_Script_Assert(waterAmount < 10);
+
+	GGen_ErosionSimulator<float> simulator(this->width, this->height);
+
+	/* The simulator works with heights in range (-100, 100) */
+	this->Multiply(100. / (double) GGEN_MAX_HEIGHT);
+
+	float* waterMap = new float[(size_t) this->length];
+
+	simulator.FlowMap(this->data, waterMap, duration, waterAmount);
+
+	delete [] this->data;
+	this->data = waterMap;
+
+	this->Multiply((double) GGEN_MAX_HEIGHT / 100.);
+}
+
+void GGen_Float_2D::ThermalWeathering(double duration, double talusAngle)
+{
+	GGen_Script_Assert(duration > 0);
+	GGen_Script_Assert(talusAngle > 0 && talusAngle < 1);
+
+	GGen_ErosionSimulator<float> simulator(this->width, this->height);
+
+	/* The simulator works with heights in range (-100, 100) */
+	this->Multiply(100. / (double) GGEN_MAX_HEIGHT);
+
+	simulator.ThermalWeathering(this->data, duration, talusAngle);
+
+	this->Multiply((double) GGEN_MAX_HEIGHT / 100.);
+}
+
+void GGen_Float_2D::Erosion(double duration, double thermalWeatheringAmount, double waterAmount)
+{
+	GGen_Script_Assert(duration > 0);
+	GGen_Script_Assert(waterAmount > 0);
+	GGen_Script_Assert(waterAmount < 10);
+
+	GGen_ErosionSimulator<float> simulator(this->width, this->height);
+
+	/* The simulator works with heights in range (-100, 100) */
+	this->Multiply(100. / (double) GGEN_MAX_HEIGHT);
+
+	simulator.Erosion(this->data, duration, thermalWeatheringAmount, waterAmount);
+
+	this->Multiply((double) GGEN_MAX_HEIGHT / 100.);
+}
@@ -0,0 +1,211 @@
+/*
+
+    This file is part of GeoGen.
+
+    GeoGen is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    GeoGen is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GeoGen.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/**
+ * @file ggen_float_2d.h GGen_Float_2D is a 2-dimensional array of real (single precision) height values.
+ **/
+
+#pragma once
+
+#include <set>
+
+#include "ggen_support.h"
+
+using namespace std;
+
+class GGen_Data_2D;
+
+/**
+ * GGen_Float_2D is a 2-dimensional array of real height values, which uses the same units as GGen_Data_2D (32767 is
+ * the highest mountain), but neither rounds the values nor limits them to the height range. Maps are converted with
+ * <a href="#float_frommap">FromMap</a> and <a href="#float_tomap">ToMap</a>. The erosion is simulated directly in the
+ * array of the map, so several erosion steps can be chained without losing precision between them and with half the
+ * memory GGen_Data_2D needs for the simulation.
+ **/
+class GGen_Float_2D{
+	protected:
+		static uint16 num_instances;
+		static set<GGen_Float_2D*> instances;
+
+	public:
+		float* data;
+		GGen_Size width;
+		GGen_Size height;
+		GGen_TotalSize length;
+
+		/**
+		 * Creates new GGen_Float_2D object of given size.
+		 * @param width Width of the map.
+		 * @param height Height of the map.
+		 * @param value Default value for all cells.
+		 **/
+		GGen_Float_2D(GGen_Size width, GGen_Size height, double value);
+
+		~GGen_Float_2D();
+
+		/**
+		 * Creates a 1:1 copy of the current object.
+		 * @return Copy of the object.
+		 **/
+		GGen_Float_2D* Clone();
+
+		/**
+		 * Returns width of the map.
+		 * @return Width of the map.
+		 **/
+		GGen_Size GetWidth();
+
+		/**
+		 * Returns height of the map.
+		 * @return Height of the map.
+		 **/
+		GGen_Size GetHeight();
+
+		/**
+		 * Returns length of the map.
+		 * @return Length of the map.
+		 * @note Length is total number of tiles in the map (= width * height)
+		 **/
+		GGen_Index GetLength();
+
+		/**
+		 * Sets value in one tile.
+		 * @param x X coordinate of the tile.
+		 * @param y Y coordinate of the tile.
+		 * @param value Value to use.
+		 **/
+		void SetValue(GGen_Coord x, GGen_Coord y, double value);
+
+		/**
+		 * Returns one value from the array.
+		 * @param x X coordinate of the tile.
+		 * @param y Y coordinate of the tile.
+		 * @return Value in the tile.
+		 **/
+		double GetValue(GGen_Coord x, GGen_Coord y);
+
+		/**
+		 * Sets all values in the map.
+		 * @param value The fill value.
+		 **/
+		void Fill(double value);
+
+		/**
+		 * Copies values of an integer map into the map.
+		 * @param map The map (of the same size).
+		 **/
+		void FromMap(GGen_Data_2D* map);
+
+		/**
+		 * Copies values of the map into an integer map. The values are rounded and clamped to the height range.
+		 * @param map The map (of the same size).
+		 **/
+		void ToMap(GGen_Data_2D* map);
+
+		/**
+		 * Adds a number to all values in the map.
+		 * @param value Value to be added to values in the map.
+		 **/
+		void Add(double value);
+
+		/**
+		 * Adds another map to the current map.
+		 * @param addend Map to be added (of the same size).
+		 **/
+		void AddMap(GGen_Float_2D* addend);
+
+		/**
+		 * Multiplies each value in the map by a real number.
+		 * @param factor Real number to multiply all values in the map.
+		 **/
+		void Multiply(double factor);
+
+		/**
+		 * Multiplies each value in the map by a corresponding value from factor.
+		 * @param factor Map to be multiplied by (of the same size).
+		 **/
+		void MultiplyMap(GGen_Float_2D* factor);
+
+		/**
+		 * Flips sign of all values in the map.
+		 **/
+		void Invert();
+
+		/**
+		 * Replaces all values with their absolute values.
+		 **/
+		void Abs();
+
+		/**
+		 * Clamps all values to range. All values outside the given range will be set either to min or max, whichever is closer.
+		 * @param min New minimum value.
+		 * @param max New maximum value.
+		 **/
+		void Clamp(double min, double max);
+
+		/**
+		 * Returns the minimum of all values in the map.
+		 * @return The minimum.
+		 **/
+		double Min();
+
+		/**
+		 * Returns the maximum of all values in the map.
+		 * @return The maximum.
+		 **/
+		double Max();
+
+		/**
+		 * Scales values in the map to fit a new value range.
+		 * @param new_min New minimum value.
+		 * @param new_max New maximum value.
+		 **/
+		void ScaleValuesTo(double new_min, double new_max);
+
+		/**
+		 * Replaces the map with depth of water flowing over it (in the same units as the heights).
+		 * @param duration Duration of the simulation, dramatically increases time complexity.
+		 * @param waterAmount Water amount multiplier in (0, 10) range.
+		 * @note Unlike GGen_Data_2D::FlowMap, the depth is not scaled to the height range.
+		 **/
+		void FlowMap(double duration, double waterAmount);
+
+		/**
+		 * Applies thermal erosion onto the height map.
+		 * @param duration Duration of the simulation, dramatically increases time complexity.
+		 * @param talusAngle Angle towards which will all slopes be eroded.
+		 * @note Unlike GGen_Data_2D::ThermalWeathering, the result is not scaled to the height range.
+		 **/
+		void ThermalWeathering(double duration, double talusAngle);
+
+		/**
+		 * Applies hydraulic and thermal erosion onto the height map.
+		 * @param duration Duration of the simulation, dramatically increases time complexity.
+		 * @param thermalWeatheringAmount Thermal weathering effect multiplier.
+		 * @param waterAmount Water amount multiplier in (0, 10) range.
+		 * @note Unlike GGen_Data_2D::Erosion, the result is not scaled to the height range.
+		 **/
+		void Erosion(double duration, double thermalWeatheringAmount, double waterAmount);
+
+		static void FreeAllInstances(){
+			while(GGen_Float_2D::instances.begin() != GGen_Float_2D::instances.end()){
+				delete (*GGen_Float_2D::instances.begin());
+			}
+		};
+};
@@ -0,0 +1,594 @@
+/*
+
+    This file is part of GeoGen.
+
+    GeoGen is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    GeoGen is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GeoGen.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <cstring>
+#include <stack>
+#include <vector>
+#include <assert.h>
+
+#include "ggen.h"
+#include "ggen_support.h"
+#include "ggen_data_2d.h"
+#include "ggen_mask_2d.h"
+#include "ggen_point.h"
+#include "ggen_random.h"
+#include "ggen_threadpool.h"
+
+uint16 GGen_Mask_2D::num_instances = 0;
+set<GGen_Mask_2D*> GGen_Mask_2D::instances;
+
+/* Bits of the last word of a row which belong to tiles of the row */
+static uint64 GGen_Mask_2D_LastWordBits(GGen_Size width){
+	return width % 64 == 0 ? ~0ULL : (1ULL << (width % 64)) - 1;
+}
+
+/* Number of set bits in a word */
+static inline GGen_Index GGen_Mask_2D_PopCount(uint64 word){
+	word = word - ((word >> 1) & 0x5555555555555555ULL);
+	word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+	word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+
+	return (word * 0x0101010101010101ULL) >> 56;
+}
+
+/* Sets or clears bits from (inclusive) to to (exclusive) of a row, whole words at once where possible. */
+static void GGen_Mask_2D_SetRange(uint64* row, GGen_Coord from, GGen_Coord to, bool value){
+	while (from < to) {
+		GGen_Coord word_end = MIN(to, (from / 64 + 1) * 64);
+		uint64 bits = word_end - from == 64 ? ~0ULL : ((1ULL << (word_end - from)) - 1) << (from % 64);
+
+		if (value) {
+			row[from / 64] |= bits;
+		}
+		else {
+			row[from / 64] &= ~bits;
+		}
+
+		from = word_end;
+	}
+}
+
+/* Moves tiles of a row towards higher x (output[x] = row[x - offset]), tiles coming from outside are not selected. */
+static void GGen_Mask_2D_ShiftRowRight(const uint64* row, uint64* output, GGen_Size words, GGen_Distance offset){
+	GGen_Distance word_offset = offset / 64;
+	unsigned bit_offset = (unsigned) (offset % 64);
+
+	for (GGen_Size i = 0; i < words; i++) {
+		uint64 value = 0;
+
+		if (i >= word_offset) {
+			value = row[i - word_offset] << bit_offset;
+
+			if (bit_offset != 0 && i > word_offset) value |= row[i - word_offset - 1] >> (64 - bit_offset);
+		}
+
+		output[i] = value;
+	}
+}
+
+/* Moves tiles of a row towards lower x (output[x] = row[x + offset]), tiles coming from outside are not selected. */
+static void GGen_Mask_2D_ShiftRowLeft(const uint64* row, uint64* output, GGen_Size words, GGen_Distance offset){
+	GGen_Distance word_offset = offset / 64;
+	unsigned bit_offset = (unsigned) (offset % 64);
+
+	for (GGen_Size i = 0; i < words; i++) {
+		uint64 value = 0;
+
+		if (i + word_offset < words) {
+			value = row[i + word_offset] >> bit_offset;
+
+			if (bit_offset != 0 && i + word_offset + 1 < words) value |= row[i + word_offset + 1] << (64 - bit_offset);
+		}
+
+		output[i] = value;
+	}
+}
+
+template <GGen_Comparison_Mode mode>
+static inline bool GGen_Mask_2D_Matches(GGen_Height value, GGen_Height threshold){
+	switch (mode) {
+		case GGEN_EQUAL_TO: return value == threshold;
+		case GGEN_NOT_EQUAL_TO: return value != threshold;
+		case GGEN_LESS_THAN: return value < threshold;
+		case GGEN_GREATER_THAN: return value > threshold;
+		case GGEN_LESS_THAN_OR_EQUAL_TO: return value <= threshold;
+		case GGEN_GREATER_THAN_OR_EQUAL_TO: return value >= threshold;
+	}
+
+	return false;
+}
+
+/* Packs the comparison results of the map values into the mask, 64 tiles per word. */
+template <GGen_Comparison_Mode mode>
+static void GGen_Mask_2D_Select(GGen_Mask_2D* mask, const GGen_Height* data, GGen_Height threshold){
+	GGen_ParallelFor(0, mask->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			const GGen_Height* row = data + y * (GGen_Index) mask->width;
+			uint64* bits = mask->data + y * (GGen_Index) mask->row_words;
+
+			for (GGen_Size i = 0; i < mask->row_words; i++) {
+				GGen_Coord x = i * 64;
+				unsigned count = (unsigned) MIN(64, mask->width - x);
+				uint64 word = 0;
+
+				for (unsigned bit = 0; bit < count; bit++) {
+					word |= (uint64) GGen_Mask_2D_Matches<mode>(row[x + bit], threshold) << bit;
+				}
+
+				bits[i] = word;
+			}
+		}
+	});
+}
+
+/* Scanline flood fill, which uses the mask itself to mark the filled tiles. */
+template <GGen_Comparison_Mode mode>
+static void GGen_Mask_2D_FloodSelect(GGen_Mask_2D* mask, const GGen_Height* data, GGen_Coord start_x, GGen_Coord start_y, GGen_Height threshold){
+	GGen_Size width = mask->width;
+	GGen_Size height = mask->height;
+
+	#define FLOODSELECT_SELECTABLE(x, y) (!((mask->data[(x) / 64 + (y) * (GGen_Index) mask->row_words] >> ((x) % 64)) & 1) && GGen_Mask_2D_Matches<mode>(data[(x) + (y) * (GGen_Index) width], threshold))
+
+	/* One seed tile for each span waiting to be selected */
+	stack<GGen_Point> seeds;
+
+	seeds.push(GGen_Point(start_x, start_y));
+
+	while (!seeds.empty()) {
+		GGen_Point seed = seeds.top();
+		seeds.pop();
+
+		GGen_Coord y = (GGen_Coord) seed.y;
+
+		/* The span might have been selected from another seed meanwhile */
+		if (!FLOODSELECT_SELECTABLE((GGen_Coord) seed.x, y)) continue;
+
+		/* Find ends of the span */
+		GGen_Coord left = (GGen_Coord) seed.x;
+		GGen_Coord right = (GGen_Coord) seed.x;
+
+		while (left > 0 && FLOODSELECT_SELECTABLE(left - 1, y)) left--;
+		while (right + 1 < width && FLOODSELECT_SELECTABLE(right + 1, y)) right++;
+
+		GGen_Mask_2D_SetRange(mask->data + y * (GGen_Index) mask->row_words, left, right + 1, true);
+
+		/* Add one seed for each selectable span touching the current span from above or below */
+		for (int direction = -1; direction <= 1; direction += 2) {
+			if ((direction < 0 && y == 0) || (direction > 0 && y + 1 >= height)) continue;
+
+			GGen_Coord neighbor_y = (GGen_Coord) (y + direction);
+			bool in_span = false;
+
+			for (GGen_Coord x = left; x <= right; x++) {
+				bool selectable = FLOODSELECT_SELECTABLE(x, neighbor_y);
+
+				if (selectable && !in_span) {
+					seeds.push(GGen_Point(x, neighbor_y));
+				}
+
+				in_span = selectable;
+			}
+		}
+	}
+
+	#undef FLOODSELECT_SELECTABLE
+}
+
+GGen_Mask_2D::GGen_Mask_2D(GGen_Size width, GGen_Size height, bool value)
+{
+	GGen_Script_Assert(GGen::GetInstance()->GetStatus() != GGEN_LOADING_MAP_INFO);
+
+	GGen_Script_Assert(width > 1 && height > 1);
+	GGen_Script_Assert(width < GGen::GetMaxMapSize());
+	GGen_Script_Assert(height < GGen::GetMaxMapSize());
+
+	GGen_Script_Assert(GGen_Mask_2D::num_instances < GGen::GetMaxMapCount());
+	GGen_Mask_2D::num_instances++;
+
+	GGen_Mask_2D::instances.insert(this);
+
+	this->length = (GGen_Index) width * height;
+	this->width = width;
+	this->height = height;
+	this->row_words = (width + 63) / 64;
+
+	/* Allocate the array */
+	this->data = new uint64[(size_t) ((GGen_Index) this->row_words * height)];
+
+	GGen_Script_Assert(this->data != NULL);
+
+	this->Fill(value);
+}
+
+GGen_Mask_2D::~GGen_Mask_2D()
+{
+	assert(GGen_Mask_2D::instances.find(this) != GGen_Mask_2D::instances.end());
+
+	GGen_Mask_2D::num_instances--;
+	GGen_Mask_2D::instances.erase(this);
+
+	delete [] this->data;
+}
+
+GGen_Mask_2D* GGen_Mask_2D::Clone()
+{
+	GGen_Mask_2D* victim = new GGen_Mask_2D(this->width, this->height, false);
+
+	memcpy(victim->data, this->data, sizeof(uint64) * (GGen_Index) this->row_words * this->height);
+
+	return victim;
+}
+
+GGen_Size GGen_Mask_2D::GetWidth()
+{
+	return this->width;
+}
+
+GGen_Size GGen_Mask_2D::GetHeight()
+{
+	return this->height;
+}
+
+GGen_Index GGen_Mask_2D::GetLength()
+{
+	return this->length;
+}
+
+void GGen_Mask_2D::ClearPadding()
+{
+	uint64 last_word_bits = GGen_Mask_2D_LastWordBits(this->width);
+
+	if (last_word_bits == ~0ULL) return;
+
+	for (GGen_Coord y = 0; y < this->height; y++) {
+		this->data[(y + 1) * (GGen_Index) this->row_words - 1] &= last_word_bits;
+	}
+}
+
+void GGen_Mask_2D::SetValue(GGen_Coord x, GGen_Coord y, bool value)
+{
+	GGen_Script_Assert(x < this->width && y < this->height);
+
+	uint64* word = this->data + x / 64 + y * (GGen_Index) this->row_words;
+
+	if (value) {
+		*word |= 1ULL << (x % 64);
+	}
+	else {
+		*word &= ~(1ULL << (x % 64));
+	}
+}
+
+void GGen_Mask_2D::SetValueInRect(GGen_Coord x1, GGen_Coord y1, GGen_Coord x2, GGen_Coord y2, bool value)
+{
+	GGen_Script_Assert(x2 < this->width && y2 < this->height);
+	GGen_Script_Assert(x1 <= x2 && y1 <= y2);
+
+	for (GGen_Coord y = y1; y <= y2; y++) {
+		GGen_Mask_2D_SetRange(this->data + y * (GGen_Index) this->row_words, x1, x2 + 1, value);
+	}
+}
+
+bool GGen_Mask_2D::GetValue(GGen_Coord x, GGen_Coord y)
+{
+	GGen_Script_Assert(x < this->width && y < this->height);
+
+	return (this->data[x / 64 + y * (GGen_Index) this->row_words] >> (x % 64)) & 1;
+}
+
+void GGen_Mask_2D::Fill(bool value)
+{
+	memset(this->data, value ? 0xFF : 0, sizeof(uint64) * (GGen_Index) this->row_words * this->height);
+
+	this->ClearPadding();
+}
+
+void GGen_Mask_2D::Select(GGen_Data_2D* map, GGen_Comparison_Mode mode, GGen_Height threshold)
+{
+	GGen_Script_Assert(map != NULL);
+	GGen_Script_Assert(map->width == this->width && map->height == this->height);
+
+	map->FlushOperations();
+
+	switch (mode) {
+		case GGEN_EQUAL_TO: GGen_Mask_2D_Select<GGEN_EQUAL_TO>(this, map->data, threshold); break;
+		case GGEN_NOT_EQUAL_TO: GGen_Mask_2D_Select<GGEN_NOT_EQUAL_TO>(this, map->data, threshold); break;
+		case GGEN_LESS_THAN: GGen_Mask_2D_Select<GGEN_LESS_THAN>(this, map->data, threshold); break;
+		case GGEN_GREATER_THAN: GGen_Mask_2D_Select<GGEN_GREATER_THAN>(this, map->data, threshold); break;
+		case GGEN_LESS_THAN_OR_EQUAL_TO: GGen_Mask_2D_Select<GGEN_LESS_THAN_OR_EQUAL_TO>(this, map->data, threshold); break;
+		case GGEN_GREATER_THAN_OR_EQUAL_TO: GGen_Mask_2D_Select<GGEN_GREATER_THAN_OR_EQUAL_TO>(this, map->data, threshold); break;
+	}
+}
+
+void GGen_Mask_2D::Monochrome(GGen_Data_2D* map, GGen_Height threshold)
+{
+	this->Select(map, GGEN_GREATER_THAN, threshold);
+}
+
+void GGen_Mask_2D::SelectValue(GGen_Data_2D* map, GGen_Height value)
+{
+	this->Select(map, GGEN_EQUAL_TO, value);
+}
+
+void GGen_Mask_2D::Scatter(GGen_Data_2D* map, bool relative)
+{
+	GGen_Script_Assert(map != NULL);
+	GGen_Script_Assert(map->width == this->width && map->height == this->height);
+
+	GGen_Height max = GGEN_UNRELATIVE_CAP;
+
+	if(relative){
+		max = map->Max();
+	}
+
+	map->FlushOperations();
+
+	/* Same random values as GGen_Data_2D::Scatter, so both select the same tiles */
+	GGen_RandomStream random = GGen_RandomStream::ForOperation();
+
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			const GGen_Height* row = map->data + y * (GGen_Index) this->width;
+			uint64* bits = this->data + y * (GGen_Index) this->row_words;
+
+			for (GGen_Size i = 0; i < this->row_words; i++) {
+				GGen_Coord x = i * 64;
+				unsigned count = (unsigned) MIN(64, this->width - x);
+				uint64 word = 0;
+
+				for (unsigned bit = 0; bit < count; bit++) {
+					word |= (uint64) (random.At<GGen_Height>(0, max, x + bit, y) <= row[x + bit]) << bit;
+				}
+
+				bits[i] = word;
+			}
+		}
+	});
+}
+
+void GGen_Mask_2D::FloodSelect(GGen_Data_2D* map, GGen_Coord start_x, GGen_Coord start_y, GGen_Comparison_Mode mode, GGen_Height threshold)
+{
+	GGen_Script_Assert(map != NULL);
+	GGen_Script_Assert(map->width == this->width && map->height == this->height);
+	GGen_Script_Assert(start_x < this->width);
+	GGen_Script_Assert(start_y < this->height);
+
+	map->FlushOperations();
+
+	this->Fill(false);
+
+	switch (mode) {
+		case GGEN_EQUAL_TO: GGen_Mask_2D_FloodSelect<GGEN_EQUAL_TO>(this, map->data, start_x, start_y, threshold); break;
+		case GGEN_NOT_EQUAL_TO: GGen_Mask_2D_FloodSelect<GGEN_NOT_EQUAL_TO>(this, map->data, start_x, start_y, threshold); break;
+		case GGEN_LESS_THAN: GGen_Mask_2D_FloodSelect<GGEN_LESS_THAN>(this, map->data, start_x, start_y, threshold); break;
+		case GGEN_GREATER_THAN: GGen_Mask_2D_FloodSelect<GGEN_GREATER_THAN>(this, map->data, start_x, start_y, threshold); break;
+		case GGEN_LESS_THAN_OR_EQUAL_TO: GGen_Mask_2D_FloodSelect<GGEN_LESS_THAN_OR_EQUAL_TO>(this, map->data, start_x, start_y, threshold); break;
+		case GGEN_GREATER_THAN_OR_EQUAL_TO: GGen_Mask_2D_FloodSelect<GGEN_GREATER_THAN_OR_EQUAL_TO>(this, map->data, start_x, start_y, threshold); break;
+	}
+}
+
+void GGen_Mask_2D::And(GGen_Mask_2D* operand)
+{
+	GGen_Script_Assert(operand != NULL);
+	GGen_Script_Assert(operand->width == this->width && operand->height == this->height);
+
+	GGen_ParallelFor(0, (GGen_Index) this->row_words * this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			this->data[i] &= operand->data[i];
+		}
+	});
+}
+
+void GGen_Mask_2D::Or(GGen_Mask_2D* operand)
+{
+	GGen_Script_Assert(operand != NULL);
+	GGen_Script_Assert(operand->width == this->width && operand->height == this->height);
+
+	GGen_ParallelFor(0, (GGen_Index) this->row_words * this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			this->data[i] |= operand->data[i];
+		}
+	});
+}
+
+void GGen_Mask_2D::Xor(GGen_Mask_2D* operand)
+{
+	GGen_Script_Assert(operand != NULL);
+	GGen_Script_Assert(operand->width == this->width && operand->height == this->height);
+
+	GGen_ParallelFor(0, (GGen_Index) this->row_words * this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			this->data[i] ^= operand->data[i];
+		}
+	});
+}
+
+void GGen_Mask_2D::Not()
+{
+	GGen_ParallelFor(0, (GGen_Index) this->row_words * this->height, [&](GGen_Index from, GGen_Index to){
+		for (GGen_Index i = from; i < to; i++) {
+			this->data[i] = ~this->data[i];
+		}
+	});
+
+	this->ClearPadding();
+}
+
+GGen_Index GGen_Mask_2D::Count()
+{
+	GGen_Index count = 0;
+	GGen_Index words = (GGen_Index) this->row_words * this->height;
+
+	for (GGen_Index i = 0; i < words; i++) {
+		count += GGen_Mask_2D_PopCount(this->data[i]);
+	}
+
+	return count;
+}
+
+void GGen_Mask_2D::ExpandDirectionBase(GGen_Distance distance, GGen_Direction direction)
+{
+	/* The window grows by doubling, so only log2(distance) passes are needed: a window of radius r ORed with copies of
+	itself shifted by r + 1 in both directions becomes a window of radius 2r + 1. */
+	if (direction == GGEN_HORIZONTAL) {
+		uint64 last_word_bits = GGen_Mask_2D_LastWordBits(this->width);
+
+		GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+			vector<uint64> shifted_right(this->row_words);
+			vector<uint64> shifted_left(this->row_words);
+
+			for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+				uint64* row = this->data + y * (GGen_Index) this->row_words;
+
+				for (GGen_Distance radius = 0; radius < distance;) {
+					GGen_Distance step = MIN(radius + 1, distance - radius);
+
+					GGen_Mask_2D_ShiftRowRight(row, &shifted_right[0], this->row_words, step);
+					GGen_Mask_2D_ShiftRowLeft(row, &shifted_left[0], this->row_words, step);
+
+					for (GGen_Size i = 0; i < this->row_words; i++) {
+						row[i] |= shifted_right[i] | shifted_left[i];
+					}
+
+					/* Tiles shifted past the right border must not come back in the next pass */
+					row[this->row_words - 1] &= last_word_bits;
+
+					radius += step;
+				}
+			}
+		});
+	}
+	else {
+		GGen_Index words = (GGen_Index) this->row_words * this->height;
+		uint64* previous = new uint64[(size_t) words];
+
+		GGen_Script_Assert(previous != NULL);
+
+		for (GGen_Distance radius = 0; radius < distance;) {
+			GGen_Distance step = MIN(radius + 1, distance - radius);
+
+			memcpy(previous, this->data, sizeof(uint64) * words);
+
+			GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+				for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+					uint64* row = this->data + y * (GGen_Index) this->row_words;
+					const uint64* above = y >= step ? previous + (y - step) * (GGen_Index) this->row_words : NULL;
+					const uint64* below = y + step < this->height ? previous + (y + step) * (GGen_Index) this->row_words : NULL;
+
+					for (GGen_Size i = 0; i < this->row_words; i++) {
+						if (above != NULL) row[i] |= above[i];
+						if (below != NULL) row[i] |= below[i];
+					}
+				}
+			});
+
+			radius += step;
+		}
+
+		delete [] previous;
+	}
+}
+
+void GGen_Mask_2D::ExpandDirection(GGen_Distance distance, GGen_Direction direction)
+{
+	GGen_Script_Assert(distance > 0);
+	GGen_Script_Assert(direction == GGEN_VERTICAL || distance < this->width);
+	GGen_Script_Assert(direction == GGEN_HORIZONTAL || distance < this->height);
+
+	this->ExpandDirectionBase(distance, direction);
+}
+
+void GGen_Mask_2D::ShrinkDirection(GGen_Distance distance, GGen_Direction direction)
+{
+	GGen_Script_Assert(distance > 0);
+	GGen_Script_Assert(direction == GGEN_VERTICAL || distance < this->width);
+	GGen_Script_Assert(direction == GGEN_HORIZONTAL || distance < this->height);
+
+	/* shrinking = inverse expanding (tiles outside the mask count as not selected in the inverse) */
+	this->Not();
+	this->ExpandDirectionBase(distance, direction);
+	this->Not();
+}
+
+void GGen_Mask_2D::Expand(GGen_Distance distance)
+{
+	GGen_Script_Assert(distance > 0);
+	GGen_Script_Assert(distance < this->width);
+	GGen_Script_Assert(distance < this->height);
+
+	this->ExpandDirectionBase(distance, GGEN_HORIZONTAL);
+	this->ExpandDirectionBase(distance, GGEN_VERTICAL);
+}
+
+void GGen_Mask_2D::Shrink(GGen_Distance distance)
+{
+	GGen_Script_Assert(distance > 0);
+	GGen_Script_Assert(distance < this->width);
+	GGen_Script_Assert(distance < this->height);
+
+	this->Not();
+	this->ExpandDirectionBase(distance, GGEN_HORIZONTAL);
+	this->ExpandDirectionBase(distance, GGEN_VERTICAL);
+	this->Not();
+}
+
+void GGen_Mask_2D::Outline(GGen_Outline_Mode mode)
+{
+	/* Outside border = inside border of the inverse */
+	if (mode == GGEN_OUTSIDE) {
+		this->Not();
+	}
+
+	GGen_Index words = (GGen_Index) this->row_words * this->height;
+	uint64* new_data = new uint64[(size_t) words];
+
+	GGen_Script_Assert(new_data != NULL);
+
+	GGen_ParallelFor(0, this->height, [&](GGen_Index from, GGen_Index to){
+		vector<uint64> left(this->row_words);
+		vector<uint64> right(this->row_words);
+
+		for (GGen_Coord y = (GGen_Coord) from; y < to; y++) {
+			const uint64* row = this->data + y * (GGen_Index) this->row_words;
+			const uint64* above = y > 0 ? row - this->row_words : NULL;
+			const uint64* below = y + 1 < this->height ? row + this->row_words : NULL;
+
+			/* Neighbors of each tile, tiles outside the mask count as selected */
+			GGen_Mask_2D_ShiftRowRight(row, &left[0], this->row_words, 1);
+			GGen_Mask_2D_ShiftRowLeft(row, &right[0], this->row_words, 1);
+
+			left[0] |= 1;
+			right[(this->width - 1) / 64] |= 1ULL << ((this->width - 1) % 64);
+
+			/* A tile is part of the border, if it is selected and at least one of its neighbors isn't. */
+			for (GGen_Size i = 0; i < this->row_words; i++) {
+				uint64 neighbors = left[i] & right[i];
+
+				if (above != NULL) neighbors &= above[i];
+				if (below != NULL) neighbors &= below[i];
+
+				new_data[i + y * (GGen_Index) this->row_words] = row[i] & ~neighbors;
+			}
+		}
+	});
+
+	/* The border of the inverse are the tiles outside of the original selection, so it needs no more inverting */
+	delete [] this->data;
+	this->data = new_data;
+}
@@ -0,0 +1,241 @@
+/*
+
+    This file is part of GeoGen.
+
+    GeoGen is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    GeoGen is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GeoGen.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/**
+ * @file ggen_mask_2d.h GGen_Mask_2D is a 2-dimensional array of yes/no values packed into bits.
+ **/
+
+#pragma once
+
+#include <set>
+
+#include "ggen_support.h"
+
+using namespace std;
+
+class GGen_Data_2D;
+
+/**
+ * GGen_Mask_2D is a 2-dimensional array of yes/no values (tiles are either selected or not). Compared to a GGen_Data_2D of
+ * zeros and ones (as produced by <a href="#2d_monochrome">Monochrome</a>, <a href="#2d_selectvalue">SelectValue</a> or
+ * <a href="#2d_floodselect">FloodSelect</a>), it takes 16 times less memory and the boolean operations process 64 tiles at
+ * once. Masks can be used to limit map operations to the selected tiles (see <a href="#2d_fillwhere">FillWhere</a>,
+ * <a href="#2d_addwhere">AddWhere</a>, <a href="#2d_addmapwhere">AddMapWhere</a> and <a href="#2d_combinewhere">CombineWhere</a>).
+ **/
+class GGen_Mask_2D{
+	protected:
+		static uint16 num_instances;
+		static set<GGen_Mask_2D*> instances;
+
+		/**
+		 * Masks out the unused bits at the end of each row (these must always stay 0).
+		 **/
+		void ClearPadding();
+
+		/**
+		 * Selects tiles within the given distance from a selected tile in one direction.
+		 * @param distance The distance.
+		 * @param direction Direction of the expansion.
+		 **/
+		void ExpandDirectionBase(GGen_Distance distance, GGen_Direction direction);
+
+	public:
+		/* One bit per tile, each row starts at a new word (tile x of row y is bit x % 64 of word x / 64 + y * row_words) */
+		uint64* data;
+		GGen_Size width;
+		GGen_Size height;
+		GGen_TotalSize length;
+
+		/* Number of words in one row */
+		GGen_Size row_words;
+
+		/**
+		 * Creates new GGen_Mask_2D object of given size.
+		 * @param width Width of the mask.
+		 * @param height Height of the mask.
+		 * @param value True to select all tiles.
+		 **/
+		GGen_Mask_2D(GGen_Size width, GGen_Size height, bool value);
+
+		~GGen_Mask_2D();
+
+		/**
+		 * Creates a 1:1 copy of the current object.
+		 * @return Copy of the object.
+		 **/
+		GGen_Mask_2D* Clone();
+
+		/**
+		 * Returns width of the mask.
+		 * @return Width of the mask.
+		 **/
+		GGen_Size GetWidth();
+
+		/**
+		 * Returns height of the mask.
+		 * @return Height of the mask.
+		 **/
+		GGen_Size GetHeight();
+
+		/**
+		 * Returns length of the mask.
+		 * @return Length of the mask.
+		 * @note Length is total number of tiles in the mask (= width * height)
+		 **/
+		GGen_Index GetLength();
+
+		/**
+		 * Selects or deselects one tile.
+		 * @param x X coordinate of the tile.
+		 * @param y Y coordinate of the tile.
+		 * @param value True to select the tile.
+		 **/
+		void SetValue(GGen_Coord x, GGen_Coord y, bool value);
+
+		/**
+		 * Selects or deselects all tiles inside a rectangle (bounds are included).
+		 * @param x1 X coordinate of the left border.
+		 * @param y1 Y coordinate of the top border.
+		 * @param x2 X coordinate of the right border.
+		 * @param y2 Y coordinate of the bottom border.
+		 * @param value True to select the tiles.
+		 **/
+		void SetValueInRect(GGen_Coord x1, GGen_Coord y1, GGen_Coord x2, GGen_Coord y2, bool value);
+
+		/**
+		 * Returns true if a tile is selected.
+		 * @param x X coordinate of the tile.
+		 * @param y Y coordinate of the tile.
+		 * @return True if the tile is selected.
+		 **/
+		bool GetValue(GGen_Coord x, GGen_Coord y);
+
+		/**
+		 * Selects or deselects all tiles.
+		 * @param value True to select all tiles.
+		 **/
+		void Fill(bool value);
+
+		/**
+		 * Selects tiles of a map whose values match a condition (and deselects all other tiles).
+		 * @param map The map (of the same size as the mask).
+		 * @param mode The comparison mode.
+		 * @param threshold Value the map values are compared to.
+		 **/
+		void Select(GGen_Data_2D* map, GGen_Comparison_Mode mode, GGen_Height threshold);
+
+		/**
+		 * Selects tiles of a map with values greater than the threshold (and deselects all other tiles).
+		 * @param map The map (of the same size as the mask).
+		 * @param threshold Values above threshold will be selected.
+		 **/
+		void Monochrome(GGen_Data_2D* map, GGen_Height threshold);
+
+		/**
+		 * Selects tiles of a map equal to a value (and deselects all other tiles).
+		 * @param map The map (of the same size as the mask).
+		 * @param value Value to be selected.
+		 **/
+		void SelectValue(GGen_Data_2D* map, GGen_Height value);
+
+		/**
+		 * Selects tiles randomly, the chance of a tile to be selected depends on the corresponding map value.
+		 * @param map The map (of the same size as the mask).
+		 * @param relative Toggles relative mode. In relative mode, maximum value found in the map means 100% chance, otherwise 32767 means 100%.
+		 **/
+		void Scatter(GGen_Data_2D* map, bool relative);
+
+		/**
+		 * Selects the continuous area of map tiles matching a condition which contains the starting tile (and deselects all other tiles).
+		 * @param map The map (of the same size as the mask).
+		 * @param start_x X coordinate of the starting tile.
+		 * @param start_y Y coordinate of the starting tile.
+		 * @param mode The comparison mode.
+		 * @param threshold Value the map values are compared to.
+		 **/
+		void FloodSelect(GGen_Data_2D* map, GGen_Coord start_x, GGen_Coord start_y, GGen_Comparison_Mode mode, GGen_Height threshold);
+
+		/**
+		 * Keeps only tiles selected in both masks.
+		 * @param operand The other mask (of the same size).
+		 **/
+		void And(GGen_Mask_2D* operand);
+
+		/**
+		 * Selects tiles selected in either mask.
+		 * @param operand The other mask (of the same size).
+		 **/
+		void Or(GGen_Mask_2D* operand);
+
+		/**
+		 * Selects tiles selected in exactly one of the masks.
+		 * @param operand The other mask (of the same size).
+		 **/
+		void Xor(GGen_Mask_2D* operand);
+
+		/**
+		 * Selects all tiles which were not selected and deselects the others.
+		 **/
+		void Not();
+
+		/**
+		 * Returns number of selected tiles.
+		 * @return Number of selected tiles.
+		 **/
+		GGen_Index Count();
+
+		/**
+		 * Selects all tiles within given distance from a selected tile in one direction.
+		 * @param distance The distance.
+		 * @param direction Direction of the expansion.
+		 **/
+		void ExpandDirection(GGen_Distance distance, GGen_Direction direction);
+
+		/**
+		 * Deselects all tiles within given distance from a tile which is not selected in one direction.
+		 * @param distance The distance.
+		 * @param direction Direction of the shrinking.
+		 **/
+		void ShrinkDirection(GGen_Distance distance, GGen_Direction direction);
+
+		/**
+		 * Selects all tiles within given distance (in both directions) from a selected tile.
+		 * @param distance The distance.
+		 **/
+		void Expand(GGen_Distance distance);
+
+		/**
+		 * Deselects all tiles within given distance (in both directions) from a tile which is not selected.
+		 * @param distance The distance.
+		 **/
+		void Shrink(GGen_Distance distance);
+
+		/**
+		 * Keeps only the border of the selected area.
+		 * @param mode GGEN_INSIDE keeps selected tiles next to a tile which is not selected, GGEN_OUTSIDE selects tiles next to a selected tile which were not selected.
+		 * @note Only horizontal and vertical neighbors are considered, tiles outside the mask are ignored.
+		 **/
+		void Outline(GGen_Outline_Mode mode);
+
+		static void FreeAllInstances(){
+			while(GGen_Mask_2D::instances.begin() != GGen_Mask_2D::instances.end()){
+				delete (*GGen_Mask_2D::instances.begin());
+			}
+		};
+};
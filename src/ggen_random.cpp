@@ -0,0 +1,52 @@
+/*
+
+    This file is part of GeoGen.
+
+    GeoGen is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    GeoGen is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GeoGen.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ggen_support.h"
+#include "ggen_random.h"
+
+/* Key all operation streams are derived from */
+static uint64 GGen_RandomStream_seed_key = GGen_Random_Mix(0);
+
+/* Number of operation streams handed out since the seed was set */
+static uint64 GGen_RandomStream_operation = 0;
+
+GGen_RandomStream GGen_RandomStream::sequential(GGen_Random_Mix(~0ULL));
+
+GGen_RandomStream::GGen_RandomStream(uint64 key)
+: key(key), counter(0) {}
+
+void GGen_RandomStream::SetSeed(uint32 seed){
+	GGen_RandomStream_seed_key = GGen_Random_Mix(seed);
+	GGen_RandomStream_operation = 0;
+
+	/* The sequential stream is keyed by the inverted seed, so it doesn't follow any of the operation streams */
+	GGen_RandomStream::sequential = GGen_RandomStream(GGen_Random_Mix(~(uint64) seed));
+}
+
+GGen_RandomStream GGen_RandomStream::ForOperation(){
+	return GGen_RandomStream(GGen_Random_Mix(GGen_RandomStream_seed_key + ++GGen_RandomStream_operation * GGEN_RANDOM_GAMMA));
+}
+
+GGen_RandomStream GGen_RandomStream::ForSeed(){
+	return GGen_RandomStream(GGen_Random_Mix(GGen_RandomStream_seed_key));
+}
+
+GGen_RandomStream& GGen_RandomStream::Sequential(){
+	return GGen_RandomStream::sequential;
+}
@@ -0,0 +1,127 @@
+/*
+
+    This file is part of GeoGen.
+
+    GeoGen is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    GeoGen is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GeoGen.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/**
+ * @file ggen_random.h Counter-based pseudo-random number generator used by the map operations.
+ **/
+
+#pragma once
+
+#include "ggen_support.h"
+
+/* Odd constant used to spread consecutive counter values over the whole 64 bit range (golden ratio * 2^64) */
+#define GGEN_RANDOM_GAMMA 0x9E3779B97F4A7C15ULL
+
+/**
+ * @internal SplitMix64 finalizer. Maps each 64 bit value to a different well mixed 64 bit value.
+ **/
+inline uint64 GGen_Random_Mix(uint64 value){
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+	return value ^ (value >> 31);
+}
+
+/**
+ * @internal Maps 64 random bits to the <min, max> interval. Uses multiply-shift on the upper 32 bits instead of modulo.
+ **/
+template <class T>
+inline T GGen_Random_Range(uint64 bits, int64 min, int64 max){
+	return (T) (min + (int64) (((bits >> 32) * (uint64) (max - min + 1)) >> 32));
+}
+
+/**
+ * Counter-based pseudo-random number stream. Each value is a pure function of the stream key and a counter (or a set
+ * of coordinates), so the values don't depend on the order in which they are drawn nor on the thread drawing them.
+ **/
+class GGen_RandomStream{
+	protected:
+		uint64 key;
+		uint64 counter;
+
+		/* Stream used by GGen_Random */
+		static GGen_RandomStream sequential;
+
+	public:
+		GGen_RandomStream(uint64 key);
+
+		/**
+		 * Resets the generator. All streams returned by ForOperation since then derive from this seed.
+		 * @param seed The seed.
+		 **/
+		static void SetSeed(uint32 seed);
+
+		/**
+		 * Returns a new stream for one map operation. The stream is identified by the seed and number of operations
+		 * which requested a stream since the seed was set, so it is independent of all the other streams.
+		 **/
+		static GGen_RandomStream ForOperation();
+
+		/**
+		 * Returns a stream depending only on the seed. Operations using it generate the same values for the same seed
+		 * no matter how many operations ran before them.
+		 **/
+		static GGen_RandomStream ForSeed();
+
+		/**
+		 * Returns the sequential stream shared by the whole generator.
+		 * @note The sequential stream must not be used from parallel loops.
+		 **/
+		static GGen_RandomStream& Sequential();
+
+		/**
+		 * Returns next 64 random bits of the stream.
+		 **/
+		inline uint64 Next(){
+			return GGen_Random_Mix(this->key + ++this->counter * GGEN_RANDOM_GAMMA);
+		}
+
+		/**
+		 * Returns next random number from the <min, max> interval.
+		 **/
+		template <class T>
+		inline T Next(int64 min, int64 max){
+			return GGen_Random_Range<T>(this->Next(), min, max);
+		}
+
+		/**
+		 * Returns 64 random bits belonging to given coordinates. Doesn't advance the stream, same coordinates always
+		 * produce the same value.
+		 **/
+		inline uint64 At(uint64 a, uint64 b = 0, uint64 c = 0) const{
+			uint64 value = GGen_Random_Mix(this->key ^ (a * GGEN_RANDOM_GAMMA));
+			value = GGen_Random_Mix(value ^ (b * GGEN_RANDOM_GAMMA));
+			return GGen_Random_Mix(value ^ (c * GGEN_RANDOM_GAMMA));
+		}
+
+		/**
+		 * Returns random number from the <min, max> interval belonging to given coordinates.
+		 **/
+		template <class T>
+		inline T At(int64 min, int64 max, uint64 a, uint64 b = 0, uint64 c = 0) const{
+			return GGen_Random_Range<T>(this->At(a, b, c), min, max);
+		}
+};
+
+/**
+ * Returns random number from the <min, max> interval drawn from the sequential stream.
+ **/
+template <class T>
+T GGen_Random(int min, int max){
+	return GGen_RandomStream::Sequential().Next<T>(min, max);
+}
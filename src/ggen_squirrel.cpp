@@ -27,8 +27,11 @@
 #include "ggen_amplitudes.h"
 #include "ggen_data_1d.h"
 #include "ggen_data_2d.h"
+#include "ggen_mask_2d.h"
+#include "ggen_float_2d.h"
 #include "ggen_scriptarg.h"
 #include "ggen_progress.h"
+#include "ggen_bufferpool.h"
 
 #include "ggen_squirrel.h"
 
@@ -39,6 +42,17 @@ DECLARE_ENUM_TYPE(GGen_Message_Level);
 DECLARE_ENUM_TYPE(GGen_Voronoi_Noise_Mode);
 DECLARE_ENUM_TYPE(GGen_Comparison_Mode);
 DECLARE_ENUM_TYPE(GGen_Outline_Mode);
+DECLARE_ENUM_TYPE(GGen_Scaling_Filter);
+
+/* SqPlus handles integers up to 32 bits only, coordinate offsets and distances are passed as 64 bit integers */
+namespace SqPlus {
+	inline bool Match(TypeWrapper<int64>, HSQUIRRELVM v, int idx) { return sq_gettype(v, idx) == OT_INTEGER; }
+	inline bool Match(TypeWrapper<uint64>, HSQUIRRELVM v, int idx) { return sq_gettype(v, idx) == OT_INTEGER; }
+	inline int64 Get(TypeWrapper<int64>, HSQUIRRELVM v, int idx) { SQInteger i; SQPLUS_CHECK_GET(sq_getinteger(v, idx, &i)); return (int64) i; }
+	inline uint64 Get(TypeWrapper<uint64>, HSQUIRRELVM v, int idx) { SQInteger i; SQPLUS_CHECK_GET(sq_getinteger(v, idx, &i)); return (uint64) i; }
+	template<> inline void Push(HSQUIRRELVM v, int64& value) { sq_pushinteger(v, (SQInteger) value); }
+	template<> inline void Push(HSQUIRRELVM v, uint64& value) { sq_pushinteger(v, (SQInteger) value); }
+}
 
 void GGen_ErrorHandler(HSQUIRRELVM,const SQChar * desc,const SQChar * source,SQInteger line,SQInteger column){
 	GGen::GetInstance()->ThrowMessage(desc, GGEN_ERROR, line, column);
@@ -55,6 +69,235 @@ void GGen_PrintHandler(HSQUIRRELVM v,const SQChar * s,...){
 	GGen::GetInstance()->ThrowMessage(temp, GGEN_ERROR);
 }
 
+/* Reads the map the method was called on */
+GGen_Data_2D* GGen_GetMapArgument(HSQUIRRELVM v){
+	GGen_Data_2D* map = GetInstance<GGen_Data_2D, false>(v, 1);
+
+	GGen_Script_Assert(map != NULL);
+
+	return map;
+}
+
+SQInteger GGen_GetIntegerArgument(HSQUIRRELVM v, SQInteger index){
+	SQInteger value = 0;
+
+	GGen_Script_Assert(SQ_SUCCEEDED(sq_getinteger(v, index, &value)));
+
+	return value;
+}
+
+GGen_Coord GGen_GetCoordArgument(HSQUIRRELVM v, SQInteger index){
+	SQInteger value = GGen_GetIntegerArgument(v, index);
+
+	GGen_Script_Assert(value >= 0 && (uint64) value < GGEN_MAX_SIZE);
+
+	return (GGen_Coord) value;
+}
+
+/* Reads count heights from a squirrel array or a blob of 16 bit integers. Blob data are used directly, array items
+ * are converted into the buffer. */
+const GGen_Height* GGen_GetHeightsArgument(HSQUIRRELVM v, SQInteger index, GGen_Index count, vector<GGen_Height>& buffer){
+	SQUserPointer blob = NULL;
+
+	if (SQ_SUCCEEDED(sqstd_getblob(v, index, &blob))) {
+		GGen_Script_Assert(sqstd_getblobsize(v, index) >= (SQInteger) (count * sizeof(GGen_Height)));
+
+		const GGen_Height* values = (const GGen_Height*) blob;
+
+		/* Only -32768 fits into 16 bits, but not into the height range */
+		for (GGen_Index i = 0; i < count; i++) {
+			GGen_Script_Assert(values[i] >= GGEN_MIN_HEIGHT);
+		}
+
+		return values;
+	}
+
+	GGen_Script_Assert(sq_gettype(v, index) == OT_ARRAY);
+	GGen_Script_Assert(sq_getsize(v, index) == (SQInteger) count);
+
+	buffer.resize(count);
+
+	for (GGen_Index i = 0; i < count; i++) {
+		SQInteger value = 0;
+
+		sq_pushinteger(v, i);
+		sq_get(v, index);
+		bool valid = SQ_SUCCEEDED(sq_getinteger(v, -1, &value));
+		sq_pop(v, 1);
+
+		GGen_Script_Assert(valid && value >= GGEN_MIN_HEIGHT && value <= GGEN_MAX_HEIGHT);
+
+		buffer[i] = (GGen_Height) value;
+	}
+
+	return buffer.empty() ? NULL : &buffer[0];
+}
+
+/* Reads coordinates from a squirrel array or a blob of unsigned 32 bit integers */
+void GGen_GetCoordsArgument(HSQUIRRELVM v, SQInteger index, vector<GGen_Coord>& output){
+	SQUserPointer blob = NULL;
+
+	if (SQ_SUCCEEDED(sqstd_getblob(v, index, &blob))) {
+		output.resize(sqstd_getblobsize(v, index) / sizeof(GGen_Coord));
+
+		if (!output.empty()) memcpy(&output[0], blob, output.size() * sizeof(GGen_Coord));
+
+		return;
+	}
+
+	GGen_Script_Assert(sq_gettype(v, index) == OT_ARRAY);
+
+	output.resize(sq_getsize(v, index));
+
+	for (size_t i = 0; i < output.size(); i++) {
+		SQInteger value = 0;
+
+		sq_pushinteger(v, i);
+		sq_get(v, index);
+		bool valid = SQ_SUCCEEDED(sq_getinteger(v, -1, &value));
+		sq_pop(v, 1);
+
+		GGen_Script_Assert(valid && value >= 0 && (uint64) value < GGEN_MAX_SIZE);
+
+		output[i] = (GGen_Coord) value;
+	}
+}
+
+/* Returns a squirrel array, or a blob if the optional argument at the given index is true */
+SQInteger GGen_ReturnHeights(HSQUIRRELVM v, SQInteger as_blob_index, const vector<GGen_Height>& values){
+	SQBool as_blob = SQFalse;
+
+	if (sq_gettop(v) >= as_blob_index) {
+		GGen_Script_Assert(SQ_SUCCEEDED(sq_getbool(v, as_blob_index, &as_blob)));
+	}
+
+	if (as_blob) {
+		SQUserPointer blob = sqstd_createblob(v, values.size() * sizeof(GGen_Height));
+
+		GGen_Script_Assert(blob != NULL);
+
+		if (!values.empty()) memcpy(blob, &values[0], values.size() * sizeof(GGen_Height));
+	} else {
+		sq_newarray(v, 0);
+
+		for (size_t i = 0; i < values.size(); i++) {
+			sq_pushinteger(v, values[i]);
+			sq_arrayappend(v, -2);
+		}
+	}
+
+	return 1;
+}
+
+/* The following methods take or return squirrel arrays, which SqPlus can't convert, so they are bound by hand */
+SQInteger GGen_Data_2D_Evaluate(HSQUIRRELVM v){
+	SQInteger argument_count = sq_gettop(v);
+
+	GGen_Data_2D* map = GGen_GetMapArgument(v);
+	const SQChar* expression = NULL;
+
+	GGen_Script_Assert(argument_count == 2 || argument_count == 3);
+	GGen_Script_Assert(SQ_SUCCEEDED(sq_getstring(v, 2, &expression)));
+
+	vector<GGen_Data_2D*> maps;
+
+	if (argument_count == 3) {
+		GGen_Script_Assert(sq_gettype(v, 3) == OT_ARRAY);
+
+		for (SQInteger i = 0; i < sq_getsize(v, 3); i++) {
+			sq_pushinteger(v, i);
+			sq_get(v, 3);
+
+			GGen_Data_2D* current = GetInstance<GGen_Data_2D, false>(v, -1);
+
+			sq_pop(v, 1);
+
+			GGen_Script_Assert(current != NULL);
+
+			maps.push_back(current);
+		}
+	}
+
+	map->Evaluate(GGen_String(expression), maps);
+
+	return 0;
+}
+
+/* GetRow(y, [as_blob]) */
+SQInteger GGen_Data_2D_GetRow(HSQUIRRELVM v){
+	GGen_Data_2D* map = GGen_GetMapArgument(v);
+	GGen_Coord y = GGen_GetCoordArgument(v, 2);
+
+	vector<GGen_Height> values(map->GetWidth());
+	map->GetRow(y, &values[0]);
+
+	return GGen_ReturnHeights(v, 3, values);
+}
+
+/* SetRow(y, values) */
+SQInteger GGen_Data_2D_SetRow(HSQUIRRELVM v){
+	GGen_Data_2D* map = GGen_GetMapArgument(v);
+	GGen_Coord y = GGen_GetCoordArgument(v, 2);
+
+	vector<GGen_Height> buffer;
+	map->SetRow(y, GGen_GetHeightsArgument(v, 3, map->GetWidth(), buffer));
+
+	return 0;
+}
+
+/* GetRegion(x, y, width, height, [as_blob]) */
+SQInteger GGen_Data_2D_GetRegion(HSQUIRRELVM v){
+	GGen_Data_2D* map = GGen_GetMapArgument(v);
+	GGen_Coord x = GGen_GetCoordArgument(v, 2);
+	GGen_Coord y = GGen_GetCoordArgument(v, 3);
+	GGen_Size width = GGen_GetCoordArgument(v, 4);
+	GGen_Size height = GGen_GetCoordArgument(v, 5);
+
+	/* Check the region before allocating the buffer for it */
+	GGen_Script_Assert((GGen_Index) x + width <= map->GetWidth() && (GGen_Index) y + height <= map->GetHeight());
+
+	vector<GGen_Height> values((GGen_Index) width * height);
+	map->GetRegion(x, y, width, height, values.empty() ? NULL : &values[0]);
+
+	return GGen_ReturnHeights(v, 6, values);
+}
+
+/* SetRegion(x, y, width, height, values) */
+SQInteger GGen_Data_2D_SetRegion(HSQUIRRELVM v){
+	GGen_Data_2D* map = GGen_GetMapArgument(v);
+	GGen_Coord x = GGen_GetCoordArgument(v, 2);
+	GGen_Coord y = GGen_GetCoordArgument(v, 3);
+	GGen_Size width = GGen_GetCoordArgument(v, 4);
+	GGen_Size height = GGen_GetCoordArgument(v, 5);
+
+	GGen_Script_Assert((GGen_Index) x + width <= map->GetWidth() && (GGen_Index) y + height <= map->GetHeight());
+
+	vector<GGen_Height> buffer;
+	map->SetRegion(x, y, width, height, GGen_GetHeightsArgument(v, 6, (GGen_Index) width * height, buffer));
+
+	return 0;
+}
+
+/* GetValues(xs, ys, [as_blob]) */
+SQInteger GGen_Data_2D_GetValues(HSQUIRRELVM v){
+	GGen_Data_2D* map = GGen_GetMapArgument(v);
+
+	vector<GGen_Coord> xs;
+	vector<GGen_Coord> ys;
+	GGen_GetCoordsArgument(v, 2, xs);
+	GGen_GetCoordsArgument(v, 3, ys);
+
+	GGen_Script_Assert(xs.size() == ys.size());
+
+	vector<GGen_Height> values(xs.size());
+
+	if (!values.empty()) {
+		map->GetValues(&xs[0], &ys[0], (GGen_Index) values.size(), &values[0]);
+	}
+
+	return GGen_ReturnHeights(v, 4, values);
+}
+
 GGen_Squirrel::GGen_Squirrel(){
 	
 
@@ -68,7 +311,11 @@ GGen_Squirrel::GGen_Squirrel(){
 
 	//SquirrelVM::Init();
 
+	/* The libraries register their functions into the table on top of the stack */
+	sq_pushroottable(SquirrelVM::GetVMPtr());
 	sqstd_register_mathlib(SquirrelVM::GetVMPtr());
+	sqstd_register_bloblib(SquirrelVM::GetVMPtr());
+	sq_pop(SquirrelVM::GetVMPtr(), 1);
 
 	sq_setprintfunc(SquirrelVM::GetVMPtr(), GGen_PrintHandler);
 	sq_setcompilererrorhandler(SquirrelVM::GetVMPtr(), GGen_ErrorHandler);
@@ -112,6 +359,10 @@ GGen_Squirrel::GGen_Squirrel(){
 	/* Enum: GGen_Vornoi_Noise_Mode */
 	BindConstant(GGEN_BUBBLES, _SC("GGEN_BUBBLES"));
 	BindConstant(GGEN_RIDGES, _SC("GGEN_RIDGES"));
+	BindConstant(GGEN_F1, _SC("GGEN_F1"));
+	BindConstant(GGEN_F2, _SC("GGEN_F2"));
+	BindConstant(GGEN_F2_MINUS_F1, _SC("GGEN_F2_MINUS_F1"));
+	BindConstant(GGEN_CELL_ID, _SC("GGEN_CELL_ID"));
 
 	/* Enum: GGen_Comparison_Mode */
 	BindConstant(GGEN_EQUAL_TO, _SC("GGEN_EQUAL_TO"));
@@ -125,9 +376,15 @@ GGen_Squirrel::GGen_Squirrel(){
 	BindConstant(GGEN_INSIDE, _SC("GGEN_INSIDE"));
 	BindConstant(GGEN_OUTSIDE, _SC("GGEN_OUTSIDE"));
 
+	/* Enum: GGen_Scaling_Filter */
+	BindConstant(GGEN_BOX, _SC("GGEN_BOX"));
+	BindConstant(GGEN_BILINEAR, _SC("GGEN_BILINEAR"));
+	BindConstant(GGEN_BICUBIC, _SC("GGEN_BICUBIC"));
+	BindConstant(GGEN_LANCZOS, _SC("GGEN_LANCZOS"));
+
 	/* Class: GGen_Data_1D */
 	SQClassDefNoConstructor<GGen_Data_1D>(_SC("GGen_Data_1D")).
-		overloadConstructor<GGen_Data_1D(*)(uint16, int16)>().
+		overloadConstructor<GGen_Data_1D(*)(GGen_Size, GGen_Height)>().
 		func(&GGen_Data_1D::Clone, _T("Clone")).
 
 		func(&GGen_Data_1D::GetLength, _T("GetLength")).
@@ -167,7 +424,7 @@ GGen_Squirrel::GGen_Squirrel(){
 
 	/* Class: GGen_Data_2D */
 	SQClassDefNoConstructor<GGen_Data_2D>(_SC("GGen_Data_2D")).
-		overloadConstructor<GGen_Data_2D(*)(uint16, uint16, int16)>().
+		overloadConstructor<GGen_Data_2D(*)(GGen_Size, GGen_Size, GGen_Height)>().
 		func(&GGen_Data_2D::Clone, _T("Clone")).
 		
 		func(&GGen_Data_2D::GetWidth, _T("GetWidth")).
@@ -177,6 +434,11 @@ GGen_Squirrel::GGen_Squirrel(){
 		func(&GGen_Data_2D::SetValueInRect, _T("SetValueInRect")).
 		func(&GGen_Data_2D::GetValue, _T("GetValue")).
 		func(&GGen_Data_2D::GetValueInterpolated, _T("GetValueInterpolated")).
+		staticFuncVarArgs(&GGen_Data_2D_GetRow, _T("GetRow")).
+		staticFuncVarArgs(&GGen_Data_2D_SetRow, _T("SetRow")).
+		staticFuncVarArgs(&GGen_Data_2D_GetRegion, _T("GetRegion")).
+		staticFuncVarArgs(&GGen_Data_2D_SetRegion, _T("SetRegion")).
+		staticFuncVarArgs(&GGen_Data_2D_GetValues, _T("GetValues")).
 		
 		func(&GGen_Data_2D::Add,_T("Add")).
 		func(&GGen_Data_2D::AddMap,_T("AddMap")).
@@ -189,6 +451,7 @@ GGen_Squirrel::GGen_Squirrel(){
 		func(&GGen_Data_2D::Invert,_T("Invert")).
 		func(&GGen_Data_2D::Scale,_T("Scale")).
 		func(&GGen_Data_2D::ScaleTo,_T("ScaleTo")).
+		func(&GGen_Data_2D::ScaleToFiltered,_T("ScaleToFiltered")).
 		func(&GGen_Data_2D::ScaleValuesTo,_T("ScaleValuesTo")).
 		func(&GGen_Data_2D::Fill,_T("Fill")).
 		func(&GGen_Data_2D::ResizeCanvas,_T("ResizeCanvas")).
@@ -196,6 +459,9 @@ GGen_Squirrel::GGen_Squirrel(){
 		func(&GGen_Data_2D::CropValues,_T("CropValues")).
 		func(&GGen_Data_2D::Min,_T("Min")).
 		func(&GGen_Data_2D::Max,_T("Max")).
+		func(&GGen_Data_2D::Histogram,_T("Histogram")).
+		func(&GGen_Data_2D::ValueAtRank,_T("ValueAtRank")).
+		func(&GGen_Data_2D::Percentile,_T("Percentile")).
 		func(&GGen_Data_2D::Flip,_T("Flip")).
 		func(&GGen_Data_2D::Union,_T("Union")).
 		func(&GGen_Data_2D::UnionTo,_T("UnionTo")).
@@ -205,6 +471,11 @@ GGen_Squirrel::GGen_Squirrel(){
 		func(&GGen_Data_2D::ReplaceValue,_T("ReplaceValue")).
 		func(&GGen_Data_2D::Abs,_T("Abs")).
 		func(&GGen_Data_2D::Combine,_T("Combine")).
+		func(&GGen_Data_2D::FillWhere,_T("FillWhere")).
+		func(&GGen_Data_2D::AddWhere,_T("AddWhere")).
+		func(&GGen_Data_2D::AddMapWhere,_T("AddMapWhere")).
+		func(&GGen_Data_2D::CombineWhere,_T("CombineWhere")).
+		staticFuncVarArgs(&GGen_Data_2D_Evaluate,_T("Evaluate")).
 		
 		func(&GGen_Data_2D::Shift,_T("Shift")).
 		func(&GGen_Data_2D::Project,_T("Project")).
@@ -215,9 +486,12 @@ GGen_Squirrel::GGen_Squirrel(){
 		func(&GGen_Data_2D::RadialGradient,_T("RadialGradient")).
 		func(&GGen_Data_2D::RadialGradientFromProfile,_T("RadialGradientFromProfile")).
 		func(&GGen_Data_2D::Smooth,_T("Smooth")).	
+		func(&GGen_Data_2D::GaussianBlur,_T("GaussianBlur")).	
 		func(&GGen_Data_2D::SmoothDirection,_T("SmoothDirection")).	
 		func(&GGen_Data_2D::Noise,_T("Noise")).		
+		func(&GGen_Data_2D::NoiseWindow,_T("NoiseWindow")).		
 		func(&GGen_Data_2D::VoronoiNoise,_T("VoronoiNoise")).		
+		func(&GGen_Data_2D::VoronoiNoisePair,_T("VoronoiNoisePair")).		
 		func(&GGen_Data_2D::Flood,_T("Flood")).
 		func(&GGen_Data_2D::Pattern,_T("Pattern")).
 		func(&GGen_Data_2D::Monochrome,_T("Monochrome")).
@@ -226,7 +500,9 @@ GGen_Squirrel::GGen_Squirrel(){
 		func(&GGen_Data_2D::Scatter,_T("Scatter")).
 		func(&GGen_Data_2D::ReturnAs,_T("ReturnAs")).
 		func(&GGen_Data_2D::Transform,_T("Transform")).
+		func(&GGen_Data_2D::TransformFiltered,_T("TransformFiltered")).
 		func(&GGen_Data_2D::Rotate,_T("Rotate")).
+		func(&GGen_Data_2D::RotateFiltered,_T("RotateFiltered")).
 		func(&GGen_Data_2D::Shear,_T("Shear")).
 		func(&GGen_Data_2D::Normalize,_T("Normalize")).
 		func(&GGen_Data_2D::NormalizeDirection,_T("NormalizeDirection")).
@@ -240,6 +516,9 @@ GGen_Squirrel::GGen_Squirrel(){
 		func(&GGen_Data_2D::Shrink,_T("Shrink")).
 		func(&GGen_Data_2D::ExpandDirection,_T("ExpandDirection")).
 		func(&GGen_Data_2D::ShrinkDirection,_T("ShrinkDirection")).
+		func(&GGen_Data_2D::DistanceMap,_T("DistanceMap")).
+		func(&GGen_Data_2D::ExpandCircular,_T("ExpandCircular")).
+		func(&GGen_Data_2D::ShrinkCircular,_T("ShrinkCircular")).
 		func(&GGen_Data_2D::Outline,_T("Outline")).
 		func(&GGen_Data_2D::ConvexityMap,_T("ConvexityMap")).
 		func(&GGen_Data_2D::Distort,_T("Distort")).
@@ -250,6 +529,67 @@ GGen_Squirrel::GGen_Squirrel(){
         func(&GGen_Data_2D::ThermalWeathering,_T("ThermalWeathering")).
         func(&GGen_Data_2D::Erosion,_T("Erosion"));
 
+	/* Class: GGen_Mask_2D */
+	SQClassDefNoConstructor<GGen_Mask_2D>(_SC("GGen_Mask_2D")).
+		overloadConstructor<GGen_Mask_2D(*)(GGen_Size, GGen_Size, bool)>().
+		func(&GGen_Mask_2D::Clone, _T("Clone")).
+
+		func(&GGen_Mask_2D::GetWidth, _T("GetWidth")).
+		func(&GGen_Mask_2D::GetHeight, _T("GetHeight")).
+		func(&GGen_Mask_2D::GetLength, _T("GetLength")).
+		func(&GGen_Mask_2D::SetValue, _T("SetValue")).
+		func(&GGen_Mask_2D::SetValueInRect, _T("SetValueInRect")).
+		func(&GGen_Mask_2D::GetValue, _T("GetValue")).
+		func(&GGen_Mask_2D::Fill, _T("Fill")).
+
+		func(&GGen_Mask_2D::Select, _T("Select")).
+		func(&GGen_Mask_2D::Monochrome, _T("Monochrome")).
+		func(&GGen_Mask_2D::SelectValue, _T("SelectValue")).
+		func(&GGen_Mask_2D::Scatter, _T("Scatter")).
+		func(&GGen_Mask_2D::FloodSelect, _T("FloodSelect")).
+
+		func(&GGen_Mask_2D::And, _T("And")).
+		func(&GGen_Mask_2D::Or, _T("Or")).
+		func(&GGen_Mask_2D::Xor, _T("Xor")).
+		func(&GGen_Mask_2D::Not, _T("Not")).
+		func(&GGen_Mask_2D::Count, _T("Count")).
+
+		func(&GGen_Mask_2D::Expand, _T("Expand")).
+		func(&GGen_Mask_2D::Shrink, _T("Shrink")).
+		func(&GGen_Mask_2D::ExpandDirection, _T("ExpandDirection")).
+		func(&GGen_Mask_2D::ShrinkDirection, _T("ShrinkDirection")).
+		func(&GGen_Mask_2D::Outline, _T("Outline"));
+
+	/* Class: GGen_Float_2D */
+	SQClassDefNoConstructor<GGen_Float_2D>(_SC("GGen_Float_2D")).
+		overloadConstructor<GGen_Float_2D(*)(GGen_Size, GGen_Size, double)>().
+		func(&GGen_Float_2D::Clone, _T("Clone")).
+
+		func(&GGen_Float_2D::GetWidth, _T("GetWidth")).
+		func(&GGen_Float_2D::GetHeight, _T("GetHeight")).
+		func(&GGen_Float_2D::GetLength, _T("GetLength")).
+		func(&GGen_Float_2D::SetValue, _T("SetValue")).
+		func(&GGen_Float_2D::GetValue, _T("GetValue")).
+		func(&GGen_Float_2D::Fill, _T("Fill")).
+
+		func(&GGen_Float_2D::FromMap, _T("FromMap")).
+		func(&GGen_Float_2D::ToMap, _T("ToMap")).
+
+		func(&GGen_Float_2D::Add, _T("Add")).
+		func(&GGen_Float_2D::AddMap, _T("AddMap")).
+		func(&GGen_Float_2D::Multiply, _T("Multiply")).
+		func(&GGen_Float_2D::MultiplyMap, _T("MultiplyMap")).
+		func(&GGen_Float_2D::Invert, _T("Invert")).
+		func(&GGen_Float_2D::Abs, _T("Abs")).
+		func(&GGen_Float_2D::Clamp, _T("Clamp")).
+		func(&GGen_Float_2D::Min, _T("Min")).
+		func(&GGen_Float_2D::Max, _T("Max")).
+		func(&GGen_Float_2D::ScaleValuesTo, _T("ScaleValuesTo")).
+
+		func(&GGen_Float_2D::FlowMap, _T("FlowMap")).
+		func(&GGen_Float_2D::ThermalWeathering, _T("ThermalWeathering")).
+		func(&GGen_Float_2D::Erosion, _T("Erosion"));
+
 	/* Class: GGen_Amplitudes */
 	SQClassDefNoConstructor<GGen_Amplitudes>(_SC("GGen_Amplitudes")).
 		overloadConstructor<GGen_Amplitudes(*)(uint8)>().
@@ -372,6 +712,8 @@ int GGen_Squirrel::GetInfoInt(const GGen_String& label){
 
 int16* GGen_Squirrel::Generate(){		
 	assert(this->status == GGEN_READY_TO_GENERATE);
+
+	GGen_BufferPool::ResetStats();
 	
 	HSQUIRRELVM v = SquirrelVM::GetVMPtr();
 
@@ -423,27 +765,35 @@ int16* GGen_Squirrel::Generate(){
 
 		assert(data != NULL && data->data != NULL);
 
+		data->FlushOperations();
+
 		output_width = data->width;
 		output_height = data->height;
 
-		return_data = new int16[output_width * output_height];
+		return_data = new int16[(GGen_Index) output_width * output_height];
 
 		assert(return_data != NULL);
 
-		memcpy(return_data, data->data, sizeof(int16) * output_width * output_height);
+		memcpy(return_data, data->data, sizeof(int16) * (GGen_Index) output_width * output_height);
 
 		/* The internal squirrel reference to the returned object is not released until next c++ => squirrel
 		call. So we call the script header with most likely nonexistant identification string to release the 
 		reference held by squirrel.h */
 		this->GetInfoInt(GGen_Const_String("voidCall"));
 
-		/* Free all remaining 2D instances (those created via Clone) */
+		/* Free all remaining 2D instances and masks (those created via Clone) and the arrays they left in the buffer pool */
 		GGen_Data_2D::FreeAllInstances();
+		GGen_Mask_2D::FreeAllInstances();
+		GGen_Float_2D::FreeAllInstances();
+		GGen_BufferPool::Clear();
 
 		return return_data;		
     } 
     catch (SquirrelError &) {		
 		GGen_Data_2D::FreeAllInstances();		
+		GGen_Mask_2D::FreeAllInstances();
+		GGen_Float_2D::FreeAllInstances();
+		GGen_BufferPool::Clear();
 
 		this->status = GGEN_READY_TO_GENERATE;
 
@@ -451,6 +801,9 @@ int16* GGen_Squirrel::Generate(){
     }
 	catch (GGen_ScriptAssertException &) {
 		GGen_Data_2D::FreeAllInstances();
+		GGen_Mask_2D::FreeAllInstances();
+		GGen_Float_2D::FreeAllInstances();
+		GGen_BufferPool::Clear();
 
 		this->status = GGEN_READY_TO_GENERATE;
 
@@ -458,6 +811,9 @@ int16* GGen_Squirrel::Generate(){
     }
     catch (bad_alloc){
 		GGen_Data_2D::FreeAllInstances();
+		GGen_Mask_2D::FreeAllInstances();
+		GGen_Float_2D::FreeAllInstances();
+		GGen_BufferPool::Clear();
 
 		this->status = GGEN_READY_TO_GENERATE;
 		
@@ -32,6 +32,8 @@
 
 #include "ggen_support.h"
 #include "ggen.h"
+#include "ggen_mask_2d.h"
+#include "ggen_float_2d.h"
 
 using namespace SqPlus;
 
@@ -63,6 +65,8 @@ using namespace SqPlus;
 
 DECLARE_INSTANCE_TYPE(GGen_Data_1D)
 DECLARE_INSTANCE_TYPE(GGen_Data_2D)
+DECLARE_INSTANCE_TYPE(GGen_Mask_2D)
+DECLARE_INSTANCE_TYPE(GGen_Float_2D)
 DECLARE_INSTANCE_TYPE(GGen_Amplitudes)
 DECLARE_INSTANCE_TYPE(GGen_Point)
 DECLARE_INSTANCE_TYPE(GGen_Path)
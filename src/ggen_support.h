@@ -70,27 +70,28 @@ typedef int32 GGen_ExtHeight;
 typedef int64 GGen_ExtExtHeight;
 
 /**
- * Size (in one dimension) of a data array or of an coordinate interval. Value range: <0, 65535>.
+ * Size (in one dimension) of a data array or of an coordinate interval. Value range: <0, 4294967295>.
  * @internal Must not allow negative values.
  **/
-typedef uint16 GGen_Size;
+typedef uint32 GGen_Size;
 
 /**
- * @internal Total count of elements in a data array. Must not allow negative values.
+ * @internal Total count of elements in a data array. Must be able to hold GGen_Size * GGen_Size, so products of
+ * a coordinate and a size must be calculated in this type (e.g. x + (GGen_Index) width * y). Must not allow negative values.
  **/
-typedef uint32 GGen_TotalSize; /* Total count of elements in the data array, must be able to hold at least GGen_Size * GGen_Size. Must not allow negative values. */
+typedef uint64 GGen_TotalSize;
 
 /**
  * Coordinate into a data array. Leftmost/topmost element has coordinate 0.
- * @internal Must not allow negative values. Should be the same as GGen_Size.
+ * @internal Must not allow negative values. Should be the same as GGen_Size. Differences of coordinates must be calculated in GGen_CoordOffset.
  **/
-typedef uint16 GGen_Coord;
+typedef uint32 GGen_Coord;
 
 /**
  * Relative coordinate offset. Positive values mean offset to left/bottom, negative values offset to right/top.
  * @internal Must allow negative values.
  **/
-typedef int32 GGen_CoordOffset;
+typedef int64 GGen_CoordOffset;
 
 /**
  * @internal Coordinate in linearized data array. Should be the same as GGen_TotalSize.
@@ -101,7 +102,12 @@ typedef GGen_TotalSize GGen_Index;
  * Value representing euclidean distance between two points.
  * @internal Must hold 2 * GGen_Coord * GGen_Coord.
  **/
-typedef uint32 GGen_Distance;
+typedef uint64 GGen_Distance;
+
+/**
+ * Largest size (in one dimension) of a data array.
+ **/
+#define GGEN_MAX_SIZE 0xFFFFFFFF
 
 /**
  * Value representing invalid tile.
@@ -118,6 +124,11 @@ typedef uint32 GGen_Distance;
  **/
 #define GGEN_MAX_HEIGHT 32767
 
+/**
+ * Number of distinct height values (including the invalid height).
+ **/
+#define GGEN_HISTOGRAM_SIZE 65536
+
 /**
  * Minimum map width/height(/length for 1D).
  **/
@@ -128,6 +139,11 @@ typedef uint32 GGen_Distance;
  **/
 #define GGEN_MAX_PATH_LENGTH 20000
 
+/**
+ * Maximum number of threads used by the map operations.
+ **/
+#define GGEN_MAX_THREAD_COUNT 1024
+
 #define GGEN_UNRELATIVE_CAP GGEN_MAX_HEIGHT
 
 #define MAX(a,b) ((a) > (b) ? (a) : (b)) 
@@ -270,7 +286,11 @@ enum GGen_Arg_Type{
  **/
 enum GGen_Voronoi_Noise_Mode{
 	GGEN_RIDGES, //!< The resulting noise will have appearance of an array of crystals. 
-	GGEN_BUBBLES //!< The resulting noise will have appearance of negative of an array of spherical bubbles.
+	GGEN_BUBBLES, //!< The resulting noise will have appearance of negative of an array of spherical bubbles.
+	GGEN_F1, //!< Distance to the nearest point (cell size = maximum height).
+	GGEN_F2, //!< Distance to the second nearest point (cell size = maximum height).
+	GGEN_F2_MINUS_F1, //!< Difference of distances to the second nearest and the nearest point (zero on the cell borders).
+	GGEN_CELL_ID //!< Each cell is filled with one random value from 0 to maximum height.
 };
 
 /**
@@ -293,6 +313,16 @@ enum GGen_Outline_Mode{
 	GGEN_OUTSIDE //!< The border line will be just outside the bordered area (the first cells not matching the condition while "looking" from inside the bordered area).
 };
 
+/**
+ * Resampling filter used when scaling maps.
+ **/
+enum GGen_Scaling_Filter{
+	GGEN_BOX, //!< Nearest neighbor when enlarging, average of the covered tiles when shrinking.
+	GGEN_BILINEAR, //!< Linear interpolation between the two nearest tiles (triangle filter when shrinking).
+	GGEN_BICUBIC, //!< Catmull-Rom spline through the four nearest tiles. Sharper than bilinear, might slightly overshoot.
+	GGEN_LANCZOS //!< Lanczos filter with radius 3. The sharpest of the filters, might overshoot near steep slopes.
+};
+
 /**
  * Generator status
  */
@@ -304,11 +334,6 @@ enum GGen_Status{
 	GGEN_GENERATING, //!< Script is being executed. All script actions but adding new arguments are allowed.
 };
 
-template <class T>
-T GGen_Random(int min, int max){
-	return min + (rand() % (int)(max - min + 1));
-}
-
 inline int GGen_log2(int x){
 	static double base = log10((double) 2);
 	return (int16) (log10((double) x)/ base);
@@ -0,0 +1,199 @@
+/*
+
+    This file is part of GeoGen.
+
+    GeoGen is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    GeoGen is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GeoGen.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+#include "ggen_support.h"
+#include "ggen_threadpool.h"
+
+/* One parallel loop being executed by the pool. */
+struct GGen_ThreadPool_Job{
+	GGen_ParallelKernel kernel;
+	void* context;
+	GGen_Index from;
+	GGen_Index to;
+	GGen_Index chunk_size;
+	uint32 num_chunks;
+	atomic<uint32> next_chunk;
+	atomic<uint32> finished_chunks;
+	exception_ptr error;
+	mutex error_mutex;
+};
+
+static vector<thread*> GGen_ThreadPool_workers;
+static uint16 GGen_ThreadPool_thread_count = 0;
+static mutex GGen_ThreadPool_mutex;
+static condition_variable GGen_ThreadPool_wake_condition;
+static condition_variable GGen_ThreadPool_done_condition;
+static GGen_ThreadPool_Job* GGen_ThreadPool_current_job = NULL;
+static uint64 GGen_ThreadPool_generation = 0;
+static uint16 GGen_ThreadPool_active_workers = 0;
+static bool GGen_ThreadPool_shutdown = false;
+static atomic<bool> GGen_ThreadPool_running(false);
+
+/* Keeps taking chunks of the job until there are none left. */
+static void GGen_ThreadPool_ProcessChunks(GGen_ThreadPool_Job* job){
+	for (;;) {
+		uint32 chunk = job->next_chunk++;
+
+		if (chunk >= job->num_chunks) break;
+
+		GGen_Index chunk_from = job->from + (GGen_Index) chunk * job->chunk_size;
+		GGen_Index chunk_to = MIN(chunk_from + job->chunk_size, job->to);
+
+		try {
+			job->kernel(job->context, chunk_from, chunk_to);
+		} catch (...) {
+			/* Only the first error is reported, the remaining chunks are still processed (they are cheap to finish
+			 * and the job must not be left half-owned by a worker). */
+			lock_guard<mutex> lock(job->error_mutex);
+			if (!job->error) job->error = current_exception();
+		}
+
+		job->finished_chunks++;
+	}
+}
+
+static void GGen_ThreadPool_WorkerMain(){
+	uint64 seen_generation = 0;
+
+	unique_lock<mutex> lock(GGen_ThreadPool_mutex);
+
+	for (;;) {
+		while (!GGen_ThreadPool_shutdown && GGen_ThreadPool_generation == seen_generation) {
+			GGen_ThreadPool_wake_condition.wait(lock);
+		}
+
+		if (GGen_ThreadPool_shutdown) return;
+
+		seen_generation = GGen_ThreadPool_generation;
+
+		/* The job might have been finished by the other threads before this one woke up */
+		GGen_ThreadPool_Job* job = GGen_ThreadPool_current_job;
+		if (job == NULL) continue;
+
+		GGen_ThreadPool_active_workers++;
+		lock.unlock();
+
+		GGen_ThreadPool_ProcessChunks(job);
+
+		lock.lock();
+		GGen_ThreadPool_active_workers--;
+		GGen_ThreadPool_done_condition.notify_all();
+	}
+}
+
+static void GGen_ThreadPool_StartWorkers(){
+	if (GGen_ThreadPool_thread_count == 0) {
+		GGen_ThreadPool_thread_count = (uint16) MAX(thread::hardware_concurrency(), 1);
+	}
+
+	GGen_ThreadPool_shutdown = false;
+
+	for (uint16 i = 1; i < GGen_ThreadPool_thread_count; i++) {
+		GGen_ThreadPool_workers.push_back(new thread(GGen_ThreadPool_WorkerMain));
+	}
+}
+
+void GGen_ThreadPool::Shutdown(){
+	{
+		lock_guard<mutex> lock(GGen_ThreadPool_mutex);
+		GGen_ThreadPool_shutdown = true;
+	}
+
+	GGen_ThreadPool_wake_condition.notify_all();
+
+	for (vector<thread*>::iterator i = GGen_ThreadPool_workers.begin(); i != GGen_ThreadPool_workers.end(); i++) {
+		(*i)->join();
+		delete *i;
+	}
+
+	GGen_ThreadPool_workers.clear();
+}
+
+void GGen_ThreadPool::SetThreadCount(uint16 count){
+	GGen_ThreadPool::Shutdown();
+
+	GGen_ThreadPool_thread_count = count;
+}
+
+uint16 GGen_ThreadPool::GetThreadCount(){
+	if (GGen_ThreadPool_thread_count == 0) {
+		return (uint16) MAX(thread::hardware_concurrency(), 1);
+	}
+
+	return GGen_ThreadPool_thread_count;
+}
+
+void GGen_ThreadPool::Run(GGen_ParallelKernel kernel, void* context, GGen_Index from, GGen_Index to){
+	if (to <= from) return;
+
+	/* Nested loops (and loops with nothing to split) are executed serially by the calling thread */
+	if (to - from < 2 || GGen_ThreadPool::GetThreadCount() < 2 || GGen_ThreadPool_running.exchange(true)) {
+		kernel(context, from, to);
+		return;
+	}
+
+	if (GGen_ThreadPool_workers.empty()) {
+		GGen_ThreadPool_StartWorkers();
+	}
+
+	/* Several chunks per thread, so one slow chunk doesn't stall the others */
+	GGen_ThreadPool_Job job;
+	job.kernel = kernel;
+	job.context = context;
+	job.from = from;
+	job.to = to;
+	job.num_chunks = (uint32) MIN(to - from, (GGen_Index) GGen_ThreadPool_thread_count * 4);
+	job.chunk_size = (to - from + job.num_chunks - 1) / job.num_chunks;
+	job.num_chunks = (uint32) ((to - from + job.chunk_size - 1) / job.chunk_size);
+	job.next_chunk = 0;
+	job.finished_chunks = 0;
+
+	{
+		lock_guard<mutex> lock(GGen_ThreadPool_mutex);
+		GGen_ThreadPool_current_job = &job;
+		GGen_ThreadPool_generation++;
+	}
+
+	GGen_ThreadPool_wake_condition.notify_all();
+
+	GGen_ThreadPool_ProcessChunks(&job);
+
+	{
+		unique_lock<mutex> lock(GGen_ThreadPool_mutex);
+
+		while (job.finished_chunks < job.num_chunks || GGen_ThreadPool_active_workers > 0) {
+			GGen_ThreadPool_done_condition.wait(lock);
+		}
+
+		GGen_ThreadPool_current_job = NULL;
+	}
+
+	GGen_ThreadPool_running = false;
+
+	if (job.error) {
+		rethrow_exception(job.error);
+	}
+}
@@ -0,0 +1,78 @@
+/*
+
+    This file is part of GeoGen.
+
+    GeoGen is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    GeoGen is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GeoGen.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/**
+ * @file ggen_threadpool.h GGen_ThreadPool is a process-wide pool of worker threads used to run map operations in parallel.
+ **/
+
+#pragma once
+
+#include "ggen_support.h"
+
+/**
+ * @internal Work item executed by the pool. Processes items from (inclusive) to to (exclusive).
+ **/
+typedef void (*GGen_ParallelKernel)(void* context, GGen_Index from, GGen_Index to);
+
+/**
+ * @internal Process-wide pool of worker threads. The calling thread always takes part in the work, so the pool
+ * holds (thread count - 1) workers. Only one parallel loop runs at a time, nested loops run serially.
+ **/
+class GGen_ThreadPool{
+	public:
+		/**
+		 * Sets number of threads used by parallel loops.
+		 * @param count Number of threads (1 = serial execution, 0 = one thread per hardware core).
+		 **/
+		static void SetThreadCount(uint16 count);
+
+		/**
+		 * Returns number of threads used by parallel loops.
+		 **/
+		static uint16 GetThreadCount();
+
+		/**
+		 * Stops all worker threads. They will be started again by the next parallel loop.
+		 **/
+		static void Shutdown();
+
+		/**
+		 * Splits the interval into chunks and runs the kernel on them in all threads. Returns once all chunks are done.
+		 * @param kernel The work item.
+		 * @param context Pointer passed to the kernel.
+		 * @param from First item of the interval.
+		 * @param to Item after the last item of the interval.
+		 * @note Exceptions thrown by the kernel are rethrown in the calling thread.
+		 **/
+		static void Run(GGen_ParallelKernel kernel, void* context, GGen_Index from, GGen_Index to);
+};
+
+template <class T>
+void GGen_ParallelFor_Kernel(void* context, GGen_Index from, GGen_Index to){
+	(*(T*) context)(from, to);
+}
+
+/**
+ * @internal Runs body(chunk_from, chunk_to) on disjoint chunks of the <from, to) interval in parallel. The body must
+ * not write into items outside its chunk (so the results are the same for any thread count).
+ **/
+template <class T>
+void GGen_ParallelFor(GGen_Index from, GGen_Index to, T body){
+	GGen_ThreadPool::Run(&GGen_ParallelFor_Kernel<T>, &body, from, to);
+}
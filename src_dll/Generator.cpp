@@ -18,6 +18,7 @@
 */
 
 #include <math.h>
+#include <limits.h>
 
 #include "ScriptArg.h"
 #include "HeightData.h"
@@ -89,7 +90,8 @@ namespace GeoGen{
 
 			property int MaximumMapSize{
 				int get(){
-					return ggen->GetMaxMapSize();
+					/* The native limit might not fit into int (maps are unlimited by default) */
+					return ggen->GetMaxMapSize() > INT_MAX ? INT_MAX : (int) ggen->GetMaxMapSize();
 				}
 
 				void set(int value){
@@ -115,6 +117,66 @@ namespace GeoGen{
 				}
 			}
 
+			property int ThreadCount{
+				int get(){
+					return ggen->GetThreadCount();
+				}
+
+				void set(int value){
+					if(this->ggen->GetStatus() == GGEN_LOADING_MAP_INFO || this->ggen->GetStatus() == GGEN_GENERATING){
+						throw gcnew InvalidStatusException();
+					}
+
+					if(value < 0 || value > GGEN_MAX_THREAD_COUNT){
+						throw gcnew ArgumentOutOfRangeException("value", String::Format("Thread count must be in range 0 - {0}.", GGEN_MAX_THREAD_COUNT));
+					}
+
+					ggen->SetThreadCount((unsigned short) value);
+				}
+			}
+
+			property bool DeferredEvaluation{
+				bool get(){
+					return ggen->GetDeferredEvaluation();
+				}
+
+				void set(bool value){
+					if(this->ggen->GetStatus() == GGEN_LOADING_MAP_INFO || this->ggen->GetStatus() == GGEN_GENERATING){
+						throw gcnew InvalidStatusException();
+					}
+
+					ggen->SetDeferredEvaluation(value);
+				}
+			}
+
+			property bool BufferPooling{
+				bool get(){
+					return ggen->GetBufferPooling();
+				}
+
+				void set(bool value){
+					if(this->ggen->GetStatus() == GGEN_LOADING_MAP_INFO || this->ggen->GetStatus() == GGEN_GENERATING){
+						throw gcnew InvalidStatusException();
+					}
+
+					ggen->SetBufferPooling(value);
+				}
+			}
+
+			property bool FileBackedMaps{
+				bool get(){
+					return ggen->GetFileBackedMaps();
+				}
+
+				void set(bool value){
+					if(this->ggen->GetStatus() == GGEN_LOADING_MAP_INFO || this->ggen->GetStatus() == GGEN_GENERATING){
+						throw gcnew InvalidStatusException();
+					}
+
+					ggen->SetFileBackedMaps(value);
+				}
+			}
+
 			property unsigned Seed{
 				unsigned get(){
 					return this->seed;